@@ -4,55 +4,131 @@
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
-#include <unistd.h>
 
-#ifdef _WIN32
-#include <io.h>
+#include "core/habit_core.h"
+
+#ifdef G_OS_UNIX
+#include <glib-unix.h>
+#include <signal.h>
 #endif
 
-#define MAX_DAY_COUNT 80
-#define DEFAULT_DAY_COUNT 60
-#define ITEM_COUNT 10
-#define NAME_LEN 64
-
-static const char *default_item_names[ITEM_COUNT] = {
-    "Habit 1",
-    "Habit 2",
-    "Habit 3",
-    "Habit 4",
-    "Habit 5",
-    "Habit 6",
-    "Habit 7",
-    "Habit 8",
-    "Habit 9",
-    "Habit 10",
-};
-
-static char item_names[ITEM_COUNT][NAME_LEN];
-static gboolean day_states[ITEM_COUNT][MAX_DAY_COUNT];
-static int current_day_count = DEFAULT_DAY_COUNT;
+#define STATS_EXPORT_PATH "stats_export.txt"
+#define STATS_EXPORT_STEM "stats_export"
+#define REPORT_DEFAULT_TOP 5
+#define HABIT_ROW_TEXT_LEN (NAME_LEN + 16)
+#define SECONDS_PER_DAY (24 * 60 * 60)
+
+#define GRID_PADDING 8
+#define GRID_SPACING 4
+#define GRID_ROW_NUM_WIDTH 30
+#define GRID_NAME_WIDTH 200
+#define GRID_HEADER_HEIGHT 18
+#define GRID_CELL_SIZE 25
+#define GRID_CELL_STRIDE (GRID_CELL_SIZE + GRID_SPACING)
+#define GRID_CELLS_X (GRID_PADDING + GRID_ROW_NUM_WIDTH + GRID_SPACING + GRID_NAME_WIDTH + GRID_SPACING)
+#define GRID_CELLS_Y (GRID_PADDING + GRID_HEADER_HEIGHT + GRID_SPACING)
+
+#define GRAPH_LEFT 44.0
+#define GRAPH_RIGHT 18.0
+#define GRAPH_TOP 14.0
+#define GRAPH_BOTTOM 28.0
+#define GRAPH_HOVER_BOX_W 220.0
+#define GRAPH_HOVER_BOX_H 80.0
+
+#define HEATMAP_HEIGHT 200
+#define HEATMAP_HEADER_HEIGHT 18
+#define HEATMAP_DEFAULT_ZOOM 2
+#define HEATMAP_MONTH_LABEL_WIDTH 28
+#define HEATMAP_SCROLL_STEP 48.0
+#define HEATMAP_MAX_THREADS 4
+#define HEATMAP_EMPTY_COLOR 0x1b2431
+#define HEATMAP_FULL_COLOR 0x4ea85f
+
+typedef struct {
+    int width;
+    int height;
+    double plot_w;
+    double plot_h;
+} GraphGeometry;
+
+typedef enum {
+    UI_DIRTY_TITLE = 1 << 0,
+    UI_DIRTY_GRID_SIZE = 1 << 1,
+    UI_DIRTY_DAY_ACTION = 1 << 2,
+    UI_DIRTY_PERCENT = 1 << 3,
+    UI_DIRTY_HABIT_LABELS = 1 << 4,
+    UI_DIRTY_STATS = 1 << 5,
+    UI_DIRTY_GRAPH = 1 << 6,
+    UI_DIRTY_CHECKS = UI_DIRTY_PERCENT | UI_DIRTY_HABIT_LABELS | UI_DIRTY_STATS | UI_DIRTY_GRAPH,
+    UI_DIRTY_ALL = (1 << 7) - 1
+} UiDirtyFlags;
+
+static HabitTracker tracker;
 
 static GtkWidget *main_window;
 static GtkWidget *title_label;
 static GtkWidget *complete_label;
-static GtkWidget *grid;
+static GtkWidget *page_scroll;
+static GtkWidget *page_content;
+static GtkWidget *grid_scroll;
+static GtkWidget *habit_grid_area;
 static GtkWidget *day_count_combo;
-static GtkWidget **check_buttons;
-static GtkWidget *day_header_labels[MAX_DAY_COUNT];
-static GtkWidget *habit_name_labels[ITEM_COUNT];
+static GtkWidget *rolling_check;
+static GtkWidget *reset_button;
+static char (*habit_row_text)[HABIT_ROW_TEXT_LEN];
+static int habit_row_count;
 static GtkWidget *stats_summary_label;
 static GtkWidget *weekly_label;
 static GtkWidget *progress_graph_area;
+static GtkWidget *heatmap_area;
 static GtkWidget *rename_combo;
 static GtkWidget *rename_entry;
 static GtkWidget *day_action_display;
 static int day_action_value = 1;
 static int hover_day_index = -1;
+static cairo_surface_t *graph_cache;
+static int graph_cache_width;
+static int graph_cache_height;
+static gboolean graph_cache_valid;
+static PangoLayout *graph_layout;
+static HeatmapView *heatmap_view;
+static HeatmapSnapshot *heatmap_snapshot;
+static int heatmap_zoom = HEATMAP_DEFAULT_ZOOM;
+static double heatmap_scroll_x;
+static double heatmap_scroll_y;
+static gboolean heatmap_follow_end = TRUE;
+static gboolean heatmap_dragging;
+static double heatmap_drag_x;
+static double heatmap_drag_y;
+static int grid_hover_habit = -1;
+static int grid_hover_day = -1;
+static int grid_focus_habit = 0;
+static int grid_focus_day = 0;
+static int grid_drag_habit = -1;
+static int grid_drag_day = -1;
+static int grid_drag_to_habit = -1;
+static int grid_drag_to_day = -1;
+static gboolean grid_drag_value;
+static gint64 startup_span;
+static gint64 interactive_span;
+static gint64 startup_time;
+static ExportJob *export_job;
+static IpcServer *ipc_server;
+static TrackerWatch *tracker_watch;
+static GtkWidget *export_progress_dialog;
+static GtkWidget *export_progress_bar;
+static ImportJob *import_job;
+static GtkWidget *import_progress_dialog;
+static GtkWidget *import_progress_bar;
+static guint ui_dirty;
+static guint ui_refresh_tick;
+static guint midnight_source;
+static guint insights_source;
 
 static void on_export_stats(GtkButton *button, gpointer user_data);
 static void on_reset(GtkButton *button, gpointer user_data);
-static void on_toggle(GtkToggleButton *toggle, gpointer user_data);
-static void refresh_all_ui(void);
+static void toggle_cell(int item, int day);
+static void mark_ui_dirty(guint flags);
 
 static gboolean on_day_action_scroll(GtkWidget *widget, GdkEventScroll *event, gpointer user_data)
 {
@@ -70,8 +146,8 @@ static gboolean on_day_action_scroll(GtkWidget *widget, GdkEventScroll *event, g
 
     if (value < 1)
         value = 1;
-    if (value > current_day_count)
-        value = current_day_count;
+    if (value > tracker.day_count)
+        value = tracker.day_count;
 
     day_action_value = value;
     if (day_action_display) {
@@ -91,8 +167,8 @@ static void step_day_action(int delta)
     value += delta;
     if (value < 1)
         value = 1;
-    if (value > current_day_count)
-        value = current_day_count;
+    if (value > tracker.day_count)
+        value = tracker.day_count;
     day_action_value = value;
 
     gchar *text = g_strdup_printf("%d", day_action_value);
@@ -114,69 +190,55 @@ static void on_day_action_plus(GtkButton *button, gpointer user_data)
     step_day_action(1);
 }
 
+static const int day_count_options[] = { 7, 30, 60, 80 };
+
+/* The preset cycle lengths, plus the full capacity when a tracker file was
+ * saved with room for more days than the largest preset. */
 static int normalize_day_count(int day_count)
 {
-    if (day_count == 7 || day_count == 30 || day_count == 60 || day_count == 80)
+    for (guint i = 0; i < G_N_ELEMENTS(day_count_options); i++) {
+        if (day_count == day_count_options[i] && day_count <= tracker.day_capacity)
+            return day_count;
+    }
+    if (day_count == tracker.day_capacity)
         return day_count;
-    return DEFAULT_DAY_COUNT;
+    return MIN(DEFAULT_DAY_COUNT, tracker.day_capacity);
 }
 
-static void make_label_interactive(GtkWidget *label)
+/* Lists the lengths normalize_day_count accepts, e.g. "7, 30, 60 or 80". */
+static gchar *format_day_count_choices(const char *separator, const char *last_separator)
 {
-    gtk_label_set_selectable(GTK_LABEL(label), TRUE);
-    gtk_widget_set_can_focus(label, FALSE);
+    int choices[G_N_ELEMENTS(day_count_options) + 1];
+    int count = 0;
+    for (guint i = 0; i < G_N_ELEMENTS(day_count_options); i++) {
+        if (day_count_options[i] <= tracker.day_capacity)
+            choices[count++] = day_count_options[i];
+    }
+    if (count == 0 || choices[count - 1] != tracker.day_capacity)
+        choices[count++] = tracker.day_capacity;
+
+    GString *text = g_string_new(NULL);
+    for (int i = 0; i < count; i++) {
+        if (i > 0)
+            g_string_append(text, i == count - 1 ? last_separator : separator);
+        g_string_append_printf(text, "%d", choices[i]);
+    }
+    return g_string_free(text, FALSE);
 }
 
-static void init_default_names(void)
+static void append_day_count_option(int days)
 {
-    for (int i = 0; i < ITEM_COUNT; i++)
-        g_strlcpy(item_names[i], default_item_names[i], NAME_LEN);
+    gchar *id = g_strdup_printf("%d", days);
+    gchar *label = g_strdup_printf("%d Days", days);
+    gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(day_count_combo), id, label);
+    g_free(label);
+    g_free(id);
 }
 
-static gboolean write_atomic_binary(const char *file_path, const void *data, size_t item_size, size_t item_count)
+static void make_label_interactive(GtkWidget *label)
 {
-    gchar *tmp_path = g_strdup_printf("%s.tmp", file_path);
-    FILE *f = fopen(tmp_path, "wb");
-    if (!f) {
-        g_warning("could not open %s for writing: %s", tmp_path, g_strerror(errno));
-        g_free(tmp_path);
-        return FALSE;
-    }
-
-    size_t written = fwrite(data, item_size, item_count, f);
-    gboolean ok = (written == item_count);
-
-    if (ok && fflush(f) != 0)
-        ok = FALSE;
-    int file_descriptor;
-#ifdef _WIN32
-    file_descriptor = _fileno(f);
-    if (ok && _commit(file_descriptor) != 0)
-        ok = FALSE;
-#else
-    file_descriptor = fileno(f);
-    if (ok && fsync(file_descriptor) != 0)
-        ok = FALSE;
-#endif
-    if (fclose(f) != 0)
-        ok = FALSE;
-
-    if (!ok) {
-        g_warning("failed writing %s safely", file_path);
-        remove(tmp_path);
-        g_free(tmp_path);
-        return FALSE;
-    }
-
-    if (rename(tmp_path, file_path) != 0) {
-        g_warning("failed replacing %s atomically: %s", file_path, g_strerror(errno));
-        remove(tmp_path);
-        g_free(tmp_path);
-        return FALSE;
-    }
-
-    g_free(tmp_path);
-    return TRUE;
+    gtk_label_set_selectable(GTK_LABEL(label), TRUE);
+    gtk_widget_set_can_focus(label, FALSE);
 }
 
 static void apply_css(void)
@@ -249,20 +311,7 @@ static void apply_css(void)
         "  background-color: #223044;"
         "  color: #f0f6ff;"
         "}"
-        "#grid-label { color: #96a3b7; font-size: 9pt; }"
-        "#habit-name { color: #e3ebf8; }"
-        "#day-header { color: #7f90a7; font-size: 8pt; }"
-        "separator { color: #2a3444; }"
-        "checkbutton.habit-cell check {"
-        "  background-color: #1b2431;"
-        "  border: 1px solid #3c4a61;"
-        "  border-radius: 5px;"
-        "}"
-        "checkbutton.habit-cell check:hover { border-color: #5e7495; }"
-        "checkbutton.habit-cell check:checked {"
-        "  background-color: #4ea85f;"
-        "  border-color: #4ea85f;"
-        "}";
+        "separator { color: #2a3444; }";
 
     gtk_css_provider_load_from_data(provider, css_data, -1, NULL);
     GdkDisplay *display = gdk_display_get_default();
@@ -273,221 +322,87 @@ static void apply_css(void)
     g_object_unref(provider);
 }
 
-static void save_states(void)
-{
-    write_atomic_binary("states.dat", day_states, sizeof(day_states[0][0]), ITEM_COUNT * MAX_DAY_COUNT);
-}
-
-static void load_states(void)
+static gboolean on_window_key_press(GtkWidget *widget, GdkEventKey *event, gpointer user_data)
 {
-    FILE *f = fopen("states.dat", "rb");
-    if (!f)
-        return;
-
-    size_t expected = ITEM_COUNT * MAX_DAY_COUNT;
-    size_t read_count = fread(day_states, sizeof(day_states[0][0]), expected, f);
-    fclose(f);
-
-    if (read_count < expected) {
-        memset(((gboolean *)day_states) + read_count, 0, (expected - read_count) * sizeof(gboolean));
-    }
-}
+    (void)widget;
+    (void)user_data;
 
-static void save_habit_names(void)
-{
-    write_atomic_binary("habits.dat", item_names, sizeof(item_names[0][0]), ITEM_COUNT * NAME_LEN);
-}
+    gboolean ctrl = (event->state & GDK_CONTROL_MASK) != 0;
+    gboolean shift = (event->state & GDK_SHIFT_MASK) != 0;
 
-static void load_habit_names(void)
-{
-    FILE *f = fopen("habits.dat", "rb");
-    if (!f) {
-        init_default_names();
-        return;
+    if (ctrl && (event->keyval == GDK_KEY_e || event->keyval == GDK_KEY_E)) {
+        on_export_stats(NULL, NULL);
+        return TRUE;
     }
 
-    size_t read_count = fread(item_names, sizeof(item_names[0][0]), ITEM_COUNT * NAME_LEN, f);
-    fclose(f);
-
-    if (read_count != (size_t)(ITEM_COUNT * NAME_LEN))
-        init_default_names();
-
-    for (int i = 0; i < ITEM_COUNT; i++) {
-        item_names[i][NAME_LEN - 1] = '\0';
-        if (item_names[i][0] == '\0')
-            g_strlcpy(item_names[i], default_item_names[i], NAME_LEN);
+    if (ctrl && shift && (event->keyval == GDK_KEY_r || event->keyval == GDK_KEY_R)) {
+        on_reset(NULL, NULL);
+        return TRUE;
     }
-}
-
-static void save_settings(void)
-{
-    write_atomic_binary("settings.dat", &current_day_count, sizeof(current_day_count), 1);
-}
-
-static void load_settings(void)
-{
-    FILE *f = fopen("settings.dat", "rb");
-    if (!f)
-        return;
 
-    int loaded = DEFAULT_DAY_COUNT;
-    if (fread(&loaded, sizeof(loaded), 1, f) == 1)
-        current_day_count = normalize_day_count(loaded);
-    fclose(f);
+    return FALSE;
 }
 
-static int count_checked(void)
+static gboolean graph_geometry(GtkWidget *widget, GraphGeometry *geom)
 {
-    int count = 0;
-    for (int i = 0; i < ITEM_COUNT; i++) {
-        for (int d = 0; d < current_day_count; d++) {
-            if (day_states[i][d])
-                count++;
-        }
-    }
-    return count;
+    geom->width = gtk_widget_get_allocated_width(widget);
+    geom->height = gtk_widget_get_allocated_height(widget);
+    geom->plot_w = geom->width - GRAPH_LEFT - GRAPH_RIGHT;
+    geom->plot_h = geom->height - GRAPH_TOP - GRAPH_BOTTOM;
+    return geom->width > 0 && geom->height > 0 && geom->plot_w > 0 && geom->plot_h > 0;
 }
 
-static int count_checked_for_habit(int item)
+static double graph_day_x(const GraphGeometry *geom, int day)
 {
-    int count = 0;
-    for (int d = 0; d < current_day_count; d++) {
-        if (day_states[item][d])
-            count++;
-    }
-    return count;
+    return (tracker.day_count > 1)
+        ? GRAPH_LEFT + ((double)day / (tracker.day_count - 1)) * geom->plot_w
+        : GRAPH_LEFT + (geom->plot_w * 0.5);
 }
 
-static int count_checked_in_week(int week_index)
+static double graph_percent_y(const GraphGeometry *geom, double percent)
 {
-    int start_day = week_index * 7;
-    int end_day = start_day + 6;
-    if (end_day >= current_day_count)
-        end_day = current_day_count - 1;
-
-    int count = 0;
-    for (int i = 0; i < ITEM_COUNT; i++) {
-        for (int d = start_day; d <= end_day; d++) {
-            if (day_states[i][d])
-                count++;
-        }
-    }
-    return count;
+    return GRAPH_TOP + (100.0 - percent) * (geom->plot_h / 100.0);
 }
 
-static double get_day_completion_percent(int day_index)
+static PangoLayout *get_graph_layout(GtkWidget *widget)
 {
-    if (day_index < 0 || day_index >= current_day_count)
-        return 0.0;
-
-    int day_checked = 0;
-    for (int i = 0; i < ITEM_COUNT; i++) {
-        if (day_states[i][day_index])
-            day_checked++;
+    if (!graph_layout) {
+        graph_layout = gtk_widget_create_pango_layout(widget, NULL);
+        PangoFontDescription *font = pango_font_description_from_string("Sans");
+        pango_font_description_set_absolute_size(font, 10 * PANGO_SCALE);
+        pango_layout_set_font_description(graph_layout, font);
+        pango_font_description_free(font);
     }
-
-    return (100.0 * day_checked) / ITEM_COUNT;
-}
-
-static double get_running_average_percent(int day_index)
-{
-    if (day_index < 0 || day_index >= current_day_count)
-        return 0.0;
-
-    double sum = 0.0;
-    for (int d = 0; d <= day_index; d++)
-        sum += get_day_completion_percent(d);
-
-    return sum / (day_index + 1);
+    return graph_layout;
 }
 
-static gboolean on_progress_graph_motion(GtkWidget *widget, GdkEventMotion *event, gpointer user_data)
+static void draw_graph_text(cairo_t *cr, PangoLayout *layout, const char *text, double x, double baseline)
 {
-    (void)user_data;
-
-    int width = gtk_widget_get_allocated_width(widget);
-    int height = gtk_widget_get_allocated_height(widget);
-
-    const double left = 44.0;
-    const double right = 18.0;
-    const double top = 14.0;
-    const double bottom = 28.0;
-    const double plot_w = width - left - right;
-    const double plot_h = height - top - bottom;
-
-    int new_hover_day = -1;
-
-    if (plot_w > 0 && plot_h > 0 && current_day_count > 0) {
-        if (event->x >= left && event->x <= (left + plot_w) &&
-            event->y >= top && event->y <= (top + plot_h)) {
-            double ratio = (event->x - left) / plot_w;
-            if (ratio < 0.0)
-                ratio = 0.0;
-            if (ratio > 1.0)
-                ratio = 1.0;
-            new_hover_day = (int)(ratio * (current_day_count - 1) + 0.5);
-        }
-    }
-
-    if (new_hover_day != hover_day_index) {
-        hover_day_index = new_hover_day;
-        gtk_widget_queue_draw(widget);
-    }
-
-    return FALSE;
+    pango_layout_set_text(layout, text, -1);
+    cairo_move_to(cr, x, baseline - (double)pango_layout_get_baseline(layout) / PANGO_SCALE);
+    pango_cairo_show_layout(cr, layout);
 }
 
-static gboolean on_progress_graph_leave(GtkWidget *widget, GdkEventCrossing *event, gpointer user_data)
+static void invalidate_graph_cache(void)
 {
-    (void)event;
-    (void)user_data;
-
-    if (hover_day_index != -1) {
-        hover_day_index = -1;
-        gtk_widget_queue_draw(widget);
-    }
-
-    return FALSE;
+    graph_cache_valid = FALSE;
+    if (progress_graph_area)
+        gtk_widget_queue_draw(progress_graph_area);
 }
 
-static gboolean on_window_key_press(GtkWidget *widget, GdkEventKey *event, gpointer user_data)
+static void drop_graph_cache(void)
 {
-    (void)widget;
-    (void)user_data;
-
-    gboolean ctrl = (event->state & GDK_CONTROL_MASK) != 0;
-    gboolean shift = (event->state & GDK_SHIFT_MASK) != 0;
-
-    if (ctrl && (event->keyval == GDK_KEY_e || event->keyval == GDK_KEY_E)) {
-        on_export_stats(NULL, NULL);
-        return TRUE;
-    }
-
-    if (ctrl && shift && (event->keyval == GDK_KEY_r || event->keyval == GDK_KEY_R)) {
-        on_reset(NULL, NULL);
-        return TRUE;
-    }
-
-    return FALSE;
+    g_clear_pointer(&graph_cache, cairo_surface_destroy);
+    g_clear_object(&graph_layout);
+    invalidate_graph_cache();
 }
 
-static gboolean on_draw_progress_graph(GtkWidget *widget, cairo_t *cr, gpointer user_data)
+static void draw_graph_layers(cairo_t *cr, const GraphGeometry *geom, PangoLayout *layout)
 {
-    (void)user_data;
-
-    int width = gtk_widget_get_allocated_width(widget);
-    int height = gtk_widget_get_allocated_height(widget);
-    if (width <= 0 || height <= 0)
-        return FALSE;
-
-    const double left = 44.0;
-    const double right = 18.0;
-    const double top = 14.0;
-    const double bottom = 28.0;
-    const double plot_w = width - left - right;
-    const double plot_h = height - top - bottom;
-    if (plot_w <= 0 || plot_h <= 0)
-        return FALSE;
+    const double left = GRAPH_LEFT;
+    const double top = GRAPH_TOP;
+    const double plot_w = geom->plot_w;
+    const double plot_h = geom->plot_h;
 
     cairo_set_source_rgb(cr, 0.08, 0.11, 0.16);
     cairo_paint(cr);
@@ -496,11 +411,8 @@ static gboolean on_draw_progress_graph(GtkWidget *widget, cairo_t *cr, gpointer
     cairo_rectangle(cr, left, top, plot_w, plot_h);
     cairo_fill(cr);
 
-    cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
-    cairo_set_font_size(cr, 10.0);
-
     for (int pct = 0; pct <= 100; pct += 25) {
-        double y = top + (100.0 - pct) * (plot_h / 100.0);
+        double y = graph_percent_y(geom, pct);
 
         cairo_set_source_rgba(cr, 0.43, 0.51, 0.63, 0.25);
         cairo_set_line_width(cr, 1.0);
@@ -509,20 +421,16 @@ static gboolean on_draw_progress_graph(GtkWidget *widget, cairo_t *cr, gpointer
         cairo_stroke(cr);
 
         cairo_set_source_rgb(cr, 0.65, 0.72, 0.82);
-        cairo_move_to(cr, 8.0, y + 4.0);
         char label[8];
         snprintf(label, sizeof(label), "%d%%", pct);
-        cairo_show_text(cr, label);
+        draw_graph_text(cr, layout, label, 8.0, y + 4.0);
     }
 
     cairo_set_source_rgb(cr, 0.39, 0.48, 0.62);
     cairo_set_line_width(cr, 1.4);
-    for (int d = 0; d < current_day_count; d++) {
-        double x = (current_day_count > 1)
-            ? left + ((double)d / (current_day_count - 1)) * plot_w
-            : left + (plot_w * 0.5);
-        double p = get_day_completion_percent(d);
-        double y = top + (100.0 - p) * (plot_h / 100.0);
+    for (int d = 0; d < tracker.day_count; d++) {
+        double x = graph_day_x(geom, d);
+        double y = graph_percent_y(geom, tracker_day_completion_percent(&tracker, d));
         if (d == 0)
             cairo_move_to(cr, x, y);
         else
@@ -532,12 +440,12 @@ static gboolean on_draw_progress_graph(GtkWidget *widget, cairo_t *cr, gpointer
 
     cairo_set_source_rgb(cr, 0.39, 0.75, 0.51);
     cairo_set_line_width(cr, 2.6);
-    for (int d = 0; d < current_day_count; d++) {
-        double x = (current_day_count > 1)
-            ? left + ((double)d / (current_day_count - 1)) * plot_w
-            : left + (plot_w * 0.5);
-        double p = get_running_average_percent(d);
-        double y = top + (100.0 - p) * (plot_h / 100.0);
+    int running_checked = 0;
+    for (int d = 0; d < tracker.day_count; d++) {
+        double x = graph_day_x(geom, d);
+        running_checked += habit_stats_day(&tracker.stats, d);
+        double p = (100.0 * running_checked) / ((double)tracker.habit_count * (d + 1));
+        double y = graph_percent_y(geom, p);
 
         if (d == 0)
             cairo_move_to(cr, x, y);
@@ -546,13 +454,10 @@ static gboolean on_draw_progress_graph(GtkWidget *widget, cairo_t *cr, gpointer
     }
     cairo_stroke(cr);
 
-    if (current_day_count > 0) {
-        int today_day = current_day_count - 1;
-        double x_today = (current_day_count > 1)
-            ? left + ((double)today_day / (current_day_count - 1)) * plot_w
-            : left + (plot_w * 0.5);
-        double p_today = get_running_average_percent(today_day);
-        double y_today = top + (100.0 - p_today) * (plot_h / 100.0);
+    int today_day = today_day_number() - tracker.history.cycle_start;
+    if (today_day >= 0 && today_day < tracker.day_count) {
+        double x_today = graph_day_x(geom, today_day);
+        double y_today = graph_percent_y(geom, tracker_running_average_percent(&tracker, today_day));
 
         cairo_set_source_rgba(cr, 0.93, 0.78, 0.37, 0.45);
         cairo_set_line_width(cr, 1.1);
@@ -565,16 +470,13 @@ static gboolean on_draw_progress_graph(GtkWidget *widget, cairo_t *cr, gpointer
         cairo_fill(cr);
 
         cairo_set_source_rgb(cr, 0.93, 0.78, 0.37);
-        cairo_move_to(cr, x_today + 6.0, top + 12.0);
-        cairo_show_text(cr, "Today");
+        draw_graph_text(cr, layout, "Today", x_today + 6.0, top + 12.0);
     }
 
-    int marker_count = (current_day_count <= 14) ? current_day_count : 8;
+    int marker_count = (tracker.day_count <= 14) ? tracker.day_count : 8;
     for (int m = 0; m < marker_count; m++) {
-        int day = (marker_count == 1) ? 0 : (m * (current_day_count - 1)) / (marker_count - 1);
-        double x = (current_day_count > 1)
-            ? left + ((double)day / (current_day_count - 1)) * plot_w
-            : left + (plot_w * 0.5);
+        int day = (marker_count == 1) ? 0 : (m * (tracker.day_count - 1)) / (marker_count - 1);
+        double x = graph_day_x(geom, day);
 
         cairo_set_source_rgba(cr, 0.63, 0.71, 0.82, 0.35);
         cairo_set_line_width(cr, 1.0);
@@ -583,10 +485,9 @@ static gboolean on_draw_progress_graph(GtkWidget *widget, cairo_t *cr, gpointer
         cairo_stroke(cr);
 
         cairo_set_source_rgb(cr, 0.65, 0.72, 0.82);
-        cairo_move_to(cr, x - 8.0, top + plot_h + 16.0);
-        char day_text[12];
-        snprintf(day_text, sizeof(day_text), "D%d", day + 1);
-        cairo_show_text(cr, day_text);
+        char day_text[40];
+        format_day_label(tracker.history.cycle_start + day, day_text, sizeof(day_text));
+        draw_graph_text(cr, layout, day_text, x - 14.0, top + plot_h + 16.0);
     }
 
     if (plot_w >= 220.0) {
@@ -604,8 +505,7 @@ static gboolean on_draw_progress_graph(GtkWidget *widget, cairo_t *cr, gpointer
         cairo_stroke(cr);
 
         cairo_set_source_rgb(cr, 0.82, 0.88, 0.95);
-        cairo_move_to(cr, legend_x + 36.0, legend_y + 17.0);
-        cairo_show_text(cr, "Daily");
+        draw_graph_text(cr, layout, "Daily", legend_x + 36.0, legend_y + 17.0);
 
         cairo_set_source_rgba(cr, 0.39, 0.75, 0.51, 1.0);
         cairo_set_line_width(cr, 2.6);
@@ -614,320 +514,1154 @@ static gboolean on_draw_progress_graph(GtkWidget *widget, cairo_t *cr, gpointer
         cairo_stroke(cr);
 
         cairo_set_source_rgb(cr, 0.82, 0.88, 0.95);
-        cairo_move_to(cr, legend_x + 36.0, legend_y + 34.0);
-        cairo_show_text(cr, "Avg");
-    }
-
-    if (hover_day_index >= 0 && hover_day_index < current_day_count) {
-        double x = (current_day_count > 1)
-            ? left + ((double)hover_day_index / (current_day_count - 1)) * plot_w
-            : left + (plot_w * 0.5);
-        double daily = get_day_completion_percent(hover_day_index);
-        double avg = get_running_average_percent(hover_day_index);
-        int day_checked = 0;
-        int total_checked_so_far = 0;
-        for (int i = 0; i < ITEM_COUNT; i++) {
-            if (day_states[i][hover_day_index])
-                day_checked++;
-            for (int d = 0; d <= hover_day_index; d++) {
-                if (day_states[i][d])
-                    total_checked_so_far++;
-            }
-        }
-        int total_possible_so_far = ITEM_COUNT * (hover_day_index + 1);
-        double y_daily = top + (100.0 - daily) * (plot_h / 100.0);
-        double y_avg = top + (100.0 - avg) * (plot_h / 100.0);
-
-        cairo_set_source_rgba(cr, 0.82, 0.88, 0.95, 0.35);
-        cairo_set_line_width(cr, 1.0);
-        cairo_move_to(cr, x, top);
-        cairo_line_to(cr, x, top + plot_h);
-        cairo_stroke(cr);
-
-        cairo_set_source_rgb(cr, 0.39, 0.48, 0.62);
-        cairo_arc(cr, x, y_daily, 3.0, 0, 2 * G_PI);
-        cairo_fill(cr);
-
-        cairo_set_source_rgb(cr, 0.39, 0.75, 0.51);
-        cairo_arc(cr, x, y_avg, 4.0, 0, 2 * G_PI);
-        cairo_fill(cr);
-
-        double box_w = 220.0;
-        double box_h = 64.0;
-        double box_x = x + 10.0;
-        double box_y = y_avg - 58.0;
-
-        if (box_x + box_w > left + plot_w)
-            box_x = x - box_w - 10.0;
-        if (box_y < top + 4.0)
-            box_y = top + 4.0;
-
-        cairo_set_source_rgba(cr, 0.08, 0.12, 0.18, 0.92);
-        cairo_rectangle(cr, box_x, box_y, box_w, box_h);
-        cairo_fill(cr);
-
-        cairo_set_source_rgb(cr, 0.86, 0.91, 0.98);
-        cairo_move_to(cr, box_x + 8.0, box_y + 14.0);
-        char hover_title[24];
-        snprintf(hover_title, sizeof(hover_title), "Day %d", hover_day_index + 1);
-        cairo_show_text(cr, hover_title);
-
-        cairo_move_to(cr, box_x + 8.0, box_y + 30.0);
-        char hover_daily[96];
-        snprintf(hover_daily, sizeof(hover_daily), "Daily: %.2f%% (%d/%d)", daily, day_checked, ITEM_COUNT);
-        cairo_show_text(cr, hover_daily);
-
-        cairo_move_to(cr, box_x + 8.0, box_y + 47.0);
-        char hover_avg[112];
-        snprintf(hover_avg, sizeof(hover_avg), "Avg: %.2f%% (%d/%d)", avg, total_checked_so_far, total_possible_so_far);
-        cairo_show_text(cr, hover_avg);
+        draw_graph_text(cr, layout, "Avg", legend_x + 36.0, legend_y + 34.0);
     }
-
-    return FALSE;
-}
-
-static void update_tracker_title(void)
-{
-    gchar *title_text = g_strdup_printf("%d Day Tracker", current_day_count);
-    gtk_label_set_text(GTK_LABEL(title_label), title_text);
-    gtk_window_set_title(GTK_WINDOW(main_window), title_text);
-    g_free(title_text);
 }
 
-static void update_day_column_visibility(void)
+static void update_graph_cache(GtkWidget *widget, const GraphGeometry *geom)
 {
-    for (int d = 0; d < MAX_DAY_COUNT; d++) {
-        gboolean visible = (d < current_day_count);
-        gtk_widget_set_visible(day_header_labels[d], visible);
+    gboolean resized = graph_cache_width != geom->width || graph_cache_height != geom->height;
+    if (graph_cache && graph_cache_valid && !resized)
+        return;
 
-        for (int i = 0; i < ITEM_COUNT; i++) {
-            int idx = i * MAX_DAY_COUNT + d;
-            gtk_widget_set_visible(check_buttons[idx], visible);
-        }
+    gint64 span = trace_begin();
+    if (!graph_cache || resized) {
+        g_clear_pointer(&graph_cache, cairo_surface_destroy);
+        graph_cache = gdk_window_create_similar_surface(gtk_widget_get_window(widget), CAIRO_CONTENT_COLOR,
+                                                        geom->width, geom->height);
+        graph_cache_width = geom->width;
+        graph_cache_height = geom->height;
     }
-}
-
-static void update_percentage(void)
-{
-    int total = ITEM_COUNT * current_day_count;
-    int checked = count_checked();
-    int percent = (total > 0) ? (checked * 100) / total : 0;
-    gchar *text = g_strdup_printf("%d%%", percent);
-    gtk_label_set_text(GTK_LABEL(complete_label), text);
-    g_free(text);
-}
 
-static void update_habit_row_labels(void)
-{
-    for (int i = 0; i < ITEM_COUNT; i++) {
-        int checked = count_checked_for_habit(i);
-        int percent = (current_day_count > 0) ? (checked * 100) / current_day_count : 0;
-        gchar *text = g_strdup_printf("%s (%d%%)", item_names[i], percent);
-        gtk_label_set_text(GTK_LABEL(habit_name_labels[i]), text);
-        g_free(text);
-    }
+    cairo_t *cache_cr = cairo_create(graph_cache);
+    draw_graph_layers(cache_cr, geom, get_graph_layout(widget));
+    cairo_destroy(cache_cr);
+    graph_cache_valid = TRUE;
+    trace_end("render_graph_cache", span);
 }
 
-static void rebuild_rename_combo(int selected_index)
+static void graph_hover_box(const GraphGeometry *geom, int day, double *x, double *box_x, double *box_y)
 {
-    gtk_combo_box_text_remove_all(GTK_COMBO_BOX_TEXT(rename_combo));
-    for (int i = 0; i < ITEM_COUNT; i++)
-        gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(rename_combo), item_names[i]);
-
-    if (selected_index < 0 || selected_index >= ITEM_COUNT)
-        selected_index = 0;
-    gtk_combo_box_set_active(GTK_COMBO_BOX(rename_combo), selected_index);
+    *x = graph_day_x(geom, day);
+    *box_x = *x + 10.0;
+    *box_y = graph_percent_y(geom, tracker_running_average_percent(&tracker, day)) - 58.0;
+
+    if (*box_x + GRAPH_HOVER_BOX_W > GRAPH_LEFT + geom->plot_w)
+        *box_x = *x - GRAPH_HOVER_BOX_W - 10.0;
+    if (*box_y < GRAPH_TOP + 4.0)
+        *box_y = GRAPH_TOP + 4.0;
 }
 
-static void update_day_action_range(void)
+static void queue_graph_hover_draw(GtkWidget *widget, int day)
 {
-    if (!day_action_display)
+    GraphGeometry geom;
+    if (day < 0 || day >= tracker.day_count || !graph_geometry(widget, &geom))
         return;
 
-    if (day_action_value < 1)
-        day_action_value = 1;
-    if (day_action_value > current_day_count)
-        day_action_value = current_day_count;
+    double x, box_x, box_y;
+    graph_hover_box(&geom, day, &x, &box_x, &box_y);
 
-    gchar *text = g_strdup_printf("%d", day_action_value);
-    gtk_entry_set_text(GTK_ENTRY(day_action_display), text);
-    g_free(text);
+    double x1 = MIN(x - 5.0, box_x) - 2.0;
+    double x2 = MAX(x + 5.0, box_x + GRAPH_HOVER_BOX_W) + 2.0;
+    double y1 = MIN(GRAPH_TOP - 5.0, box_y) - 2.0;
+    double y2 = MAX(GRAPH_TOP + geom.plot_h + 5.0, box_y + GRAPH_HOVER_BOX_H) + 2.0;
+    gtk_widget_queue_draw_area(widget, (int)x1, (int)y1, (int)(x2 - x1) + 1, (int)(y2 - y1) + 1);
 }
 
-static void apply_selected_day_to_all(gboolean value)
+static void draw_graph_hover(cairo_t *cr, const GraphGeometry *geom, PangoLayout *layout)
 {
-    if (!day_action_display)
-        return;
+    int day = hover_day_index;
+    double x, box_x, box_y;
+    graph_hover_box(geom, day, &x, &box_x, &box_y);
+
+    double daily = tracker_day_completion_percent(&tracker, day);
+    double avg = tracker_running_average_percent(&tracker, day);
+    int day_checked = habit_stats_day(&tracker.stats, day);
+    int total_checked_so_far = habit_stats_prefix(&tracker.stats, day);
+    int total_possible_so_far = tracker.habit_count * (day + 1);
+
+    cairo_set_source_rgba(cr, 0.82, 0.88, 0.95, 0.35);
+    cairo_set_line_width(cr, 1.0);
+    cairo_move_to(cr, x, GRAPH_TOP);
+    cairo_line_to(cr, x, GRAPH_TOP + geom->plot_h);
+    cairo_stroke(cr);
 
-    int day_index = day_action_value - 1;
-    if (day_index < 0 || day_index >= current_day_count)
-        return;
+    cairo_set_source_rgb(cr, 0.39, 0.48, 0.62);
+    cairo_arc(cr, x, graph_percent_y(geom, daily), 3.0, 0, 2 * G_PI);
+    cairo_fill(cr);
 
-    for (int item = 0; item < ITEM_COUNT; item++) {
-        int idx = item * MAX_DAY_COUNT + day_index;
-        day_states[item][day_index] = value;
-        g_signal_handlers_block_by_func(check_buttons[idx], on_toggle, NULL);
-        gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(check_buttons[idx]), value);
-        gtk_widget_queue_draw(check_buttons[idx]);
-        g_signal_handlers_unblock_by_func(check_buttons[idx], on_toggle, NULL);
-    }
+    cairo_set_source_rgb(cr, 0.39, 0.75, 0.51);
+    cairo_arc(cr, x, graph_percent_y(geom, avg), 4.0, 0, 2 * G_PI);
+    cairo_fill(cr);
+
+    cairo_set_source_rgba(cr, 0.08, 0.12, 0.18, 0.92);
+    cairo_rectangle(cr, box_x, box_y, GRAPH_HOVER_BOX_W, GRAPH_HOVER_BOX_H);
+    cairo_fill(cr);
 
-    save_states();
-    refresh_all_ui();
+    cairo_set_source_rgb(cr, 0.86, 0.91, 0.98);
+    char date_text[40];
+    char hover_title[64];
+    format_day_label(tracker.history.cycle_start + day, date_text, sizeof(date_text));
+    snprintf(hover_title, sizeof(hover_title), "%s (day %d)", date_text, day + 1);
+    draw_graph_text(cr, layout, hover_title, box_x + 8.0, box_y + 14.0);
+
+    char hover_daily[96];
+    snprintf(hover_daily, sizeof(hover_daily), "Daily: %.2f%% (%d/%d)", daily, day_checked, tracker.habit_count);
+    draw_graph_text(cr, layout, hover_daily, box_x + 8.0, box_y + 30.0);
+
+    char hover_avg[112];
+    snprintf(hover_avg, sizeof(hover_avg), "Avg: %.2f%% (%d/%d)", avg, total_checked_so_far, total_possible_so_far);
+    draw_graph_text(cr, layout, hover_avg, box_x + 8.0, box_y + 47.0);
+
+    int run_habit = -1;
+    int run_length = 0;
+    for (int i = 0; i < tracker.habit_count; i++) {
+        const StreakRun *run = habit_streaks_find(&tracker.streaks, &tracker.history, i, tracker.history.cycle_start + day);
+        if (run && run->length > run_length) {
+            run_length = run->length;
+            run_habit = i;
+        }
+    }
+    char hover_streak[112];
+    if (run_habit >= 0)
+        snprintf(hover_streak, sizeof(hover_streak), "Streak: %d %s (%s)", run_length, day_unit(run_length),
+                 tracker.names[run_habit]);
+    else
+        snprintf(hover_streak, sizeof(hover_streak), "Streak: none");
+    draw_graph_text(cr, layout, hover_streak, box_x + 8.0, box_y + 64.0);
 }
 
-static void on_fill_day(GtkButton *button, gpointer user_data)
+static gboolean on_draw_progress_graph(GtkWidget *widget, cairo_t *cr, gpointer user_data)
 {
-    (void)button;
     (void)user_data;
-    apply_selected_day_to_all(TRUE);
+
+    GraphGeometry geom;
+    if (!graph_geometry(widget, &geom))
+        return FALSE;
+
+    gint64 span = trace_begin();
+    update_graph_cache(widget, &geom);
+    cairo_set_source_surface(cr, graph_cache, 0, 0);
+    cairo_paint(cr);
+
+    if (hover_day_index >= 0 && hover_day_index < tracker.day_count)
+        draw_graph_hover(cr, &geom, get_graph_layout(widget));
+    trace_end("draw_progress_graph", span);
+    return FALSE;
 }
 
-static void on_clear_day(GtkButton *button, gpointer user_data)
+static gboolean on_progress_graph_motion(GtkWidget *widget, GdkEventMotion *event, gpointer user_data)
 {
-    (void)button;
     (void)user_data;
-    apply_selected_day_to_all(FALSE);
-}
 
-static void update_statistics_panel(void)
-{
-    int total = ITEM_COUNT * current_day_count;
-    int checked = count_checked();
-    int percent = (total > 0) ? (checked * 100) / total : 0;
+    GraphGeometry geom;
+    int new_hover_day = -1;
 
-    int best_idx = 0;
-    int worst_idx = 0;
-    int best_percent = -1;
-    int worst_percent = 101;
-
-    for (int i = 0; i < ITEM_COUNT; i++) {
-        int habit_percent = (current_day_count > 0)
-            ? (count_checked_for_habit(i) * 100) / current_day_count
-            : 0;
-        if (habit_percent > best_percent) {
-            best_percent = habit_percent;
-            best_idx = i;
-        }
-        if (habit_percent < worst_percent) {
-            worst_percent = habit_percent;
-            worst_idx = i;
+    if (graph_geometry(widget, &geom) && tracker.day_count > 0) {
+        if (event->x >= GRAPH_LEFT && event->x <= (GRAPH_LEFT + geom.plot_w) &&
+            event->y >= GRAPH_TOP && event->y <= (GRAPH_TOP + geom.plot_h)) {
+            double ratio = (event->x - GRAPH_LEFT) / geom.plot_w;
+            if (ratio < 0.0)
+                ratio = 0.0;
+            if (ratio > 1.0)
+                ratio = 1.0;
+            new_hover_day = (int)(ratio * (tracker.day_count - 1) + 0.5);
         }
     }
 
-    double average_per_habit = (double)checked / ITEM_COUNT;
+    if (new_hover_day != hover_day_index) {
+        queue_graph_hover_draw(widget, hover_day_index);
+        hover_day_index = new_hover_day;
+        queue_graph_hover_draw(widget, hover_day_index);
+    }
 
-    gchar *summary = g_strdup_printf(
-        "• Total complete: %d / %d (%d%%)\n"
-        "• Average per habit: %.1f / %d days\n"
-        "• Best habit: %s (%d%%)\n"
-        "• Needs focus: %s (%d%%)",
-        checked, total, percent,
-        average_per_habit, current_day_count,
-        item_names[best_idx], best_percent,
-        item_names[worst_idx], worst_percent);
+    return FALSE;
+}
 
-    gtk_label_set_text(GTK_LABEL(stats_summary_label), summary);
-    g_free(summary);
+static gboolean on_progress_graph_leave(GtkWidget *widget, GdkEventCrossing *event, gpointer user_data)
+{
+    (void)event;
+    (void)user_data;
 
-    int week_count = (current_day_count + 6) / 7;
-    GString *weekly = g_string_new("");
-    for (int w = 0; w < week_count; w++) {
-        int start_day = (w * 7) + 1;
-        int end_day = start_day + 6;
-        if (end_day > current_day_count)
-            end_day = current_day_count;
-
-        int week_days = end_day - start_day + 1;
-        int week_total = ITEM_COUNT * week_days;
-        int week_checked = count_checked_in_week(w);
-        int week_percent = (week_total > 0) ? (week_checked * 100) / week_total : 0;
-
-        g_string_append_printf(weekly, "W%d (D%d-D%d): %d%%", w + 1, start_day, end_day, week_percent);
-        if (w < week_count - 1) {
-            if ((w + 1) % 3 == 0)
-                g_string_append(weekly, "\n");
-            else
-                g_string_append(weekly, "    ");
-        }
+    if (hover_day_index != -1) {
+        queue_graph_hover_draw(widget, hover_day_index);
+        hover_day_index = -1;
     }
 
-    gtk_label_set_text(GTK_LABEL(weekly_label), weekly->str);
-    g_string_free(weekly, TRUE);
+    return FALSE;
 }
 
-static void refresh_all_ui(void)
+static void on_progress_graph_style_updated(GtkWidget *widget, gpointer user_data)
 {
-    update_tracker_title();
-    update_day_column_visibility();
-    update_day_action_range();
-    update_percentage();
-    update_habit_row_labels();
-    update_statistics_panel();
-    if (progress_graph_area)
-        gtk_widget_queue_draw(progress_graph_area);
+    (void)widget;
+    (void)user_data;
+    drop_graph_cache();
 }
 
-static void on_toggle(GtkToggleButton *toggle, gpointer user_data)
+static void on_progress_graph_scale_changed(GObject *object, GParamSpec *pspec, gpointer user_data)
 {
-    intptr_t idx = (intptr_t)user_data;
-    int item = idx / MAX_DAY_COUNT;
-    int day = idx % MAX_DAY_COUNT;
-    day_states[item][day] = gtk_toggle_button_get_active(toggle);
-    save_states();
-    refresh_all_ui();
-    gtk_widget_queue_draw(GTK_WIDGET(toggle));
+    (void)object;
+    (void)pspec;
+    (void)user_data;
+    drop_graph_cache();
 }
 
-static void on_day_count_changed(GtkComboBox *combo, gpointer user_data)
+static void on_heatmap_ready(gpointer user_data)
 {
     (void)user_data;
-    const gchar *id = gtk_combo_box_get_active_id(combo);
-    if (!id)
-        return;
+    if (heatmap_area)
+        gtk_widget_queue_draw(heatmap_area);
+}
 
-    int new_day_count = normalize_day_count(atoi(id));
-    if (new_day_count == current_day_count)
+static void update_heatmap_snapshot(void)
+{
+    if (!heatmap_view)
         return;
 
-    current_day_count = new_day_count;
-    save_settings();
-    refresh_all_ui();
+    gint64 span = trace_begin();
+    HeatmapSnapshot *snapshot = heatmap_snapshot_new(&tracker);
+    heatmap_view_set_snapshot(heatmap_view, snapshot);
+    heatmap_snapshot_unref(heatmap_snapshot);
+    heatmap_snapshot = snapshot;
+    gtk_widget_queue_draw(heatmap_area);
+    trace_end("heatmap_snapshot", span);
 }
 
-static void perform_full_reset(void)
+static void heatmap_clamp_scroll(GtkWidget *widget)
 {
-    memset(day_states, 0, sizeof(day_states));
-    save_states();
+    int content_w, content_h;
+    heatmap_snapshot_extent(heatmap_snapshot, heatmap_zoom, &content_w, &content_h);
+    double max_x = MAX(0, content_w - gtk_widget_get_allocated_width(widget));
+    double max_y = MAX(0, content_h - (gtk_widget_get_allocated_height(widget) - HEATMAP_HEADER_HEIGHT));
+
+    if (heatmap_follow_end || heatmap_scroll_x > max_x)
+        heatmap_scroll_x = max_x;
+    if (heatmap_scroll_x < 0.0)
+        heatmap_scroll_x = 0.0;
+    heatmap_scroll_y = CLAMP(heatmap_scroll_y, 0.0, max_y);
+    heatmap_follow_end = heatmap_scroll_x >= max_x;
+}
 
-    for (int item = 0; item < ITEM_COUNT; item++) {
-        for (int day = 0; day < MAX_DAY_COUNT; day++) {
-            int idx = item * MAX_DAY_COUNT + day;
-            g_signal_handlers_block_by_func(check_buttons[idx], on_toggle, NULL);
-            gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(check_buttons[idx]), FALSE);
-            gtk_widget_queue_draw(check_buttons[idx]);
-            g_signal_handlers_unblock_by_func(check_buttons[idx], on_toggle, NULL);
-        }
-    }
+/* Labels the columns that hold the first of a month, or only new years when
+ * the cells are too narrow for month names. */
+static void draw_heatmap_labels(cairo_t *cr, PangoLayout *layout, int width)
+{
+    const HeatmapZoom *zooms;
+    heatmap_zoom_levels(&zooms);
+    const HeatmapZoom *z = &zooms[heatmap_zoom];
+    gboolean months = z->days_per_cell * HEATMAP_MONTH_LABEL_WIDTH <= 31 * z->cell_size;
+    int first = (int)(heatmap_scroll_x / z->cell_size);
+    int last = (int)((heatmap_scroll_x + width) / z->cell_size);
+    double free_x = -1.0;
+
+    cairo_set_source_rgb(cr, 0.569, 0.631, 0.722);
+    for (int column = first; column <= last; column++) {
+        GDate date;
+        int end_day = heatmap_snapshot->origin + (column + 1) * z->days_per_cell - 1;
+        g_date_clear(&date, 1);
+        g_date_set_julian(&date, (guint32)end_day);
+        if ((int)g_date_get_day(&date) > z->days_per_cell)
+            continue;
+        if (!months && g_date_get_month(&date) != G_DATE_JANUARY)
+            continue;
+
+        double x = column * z->cell_size - heatmap_scroll_x;
+        if (x < free_x)
+            continue;
+
+        char text[32];
+        if (g_date_get_month(&date) == G_DATE_JANUARY)
+            g_snprintf(text, sizeof(text), "%d", g_date_get_year(&date));
+        else
+            g_date_strftime(text, sizeof(text), "%b", &date);
+        draw_graph_text(cr, layout, text, x, HEATMAP_HEADER_HEIGHT - 5.0);
 
-    refresh_all_ui();
+        int text_w, text_h;
+        pango_layout_get_pixel_size(layout, &text_w, &text_h);
+        free_x = x + text_w + 6.0;
+    }
 }
 
-static void on_reset(GtkButton *button, gpointer user_data)
+/* Paints whatever tiles the view has ready; missing ones fill in as the
+ * workers finish and on_heatmap_ready queues another draw. */
+static gboolean on_draw_heatmap(GtkWidget *widget, cairo_t *cr, gpointer user_data)
+{
+    (void)user_data;
+
+    if (!heatmap_snapshot)
+        return FALSE;
+
+    gint64 span = trace_begin();
+    int width = gtk_widget_get_allocated_width(widget);
+    int height = gtk_widget_get_allocated_height(widget);
+    int content_w, content_h;
+    heatmap_clamp_scroll(widget);
+    heatmap_snapshot_extent(heatmap_snapshot, heatmap_zoom, &content_w, &content_h);
+
+    cairo_save(cr);
+    cairo_rectangle(cr, 0, HEATMAP_HEADER_HEIGHT, width, height - HEATMAP_HEADER_HEIGHT);
+    cairo_clip(cr);
+    int last_x = MIN(content_w, (int)heatmap_scroll_x + width);
+    int last_y = MIN(content_h, (int)heatmap_scroll_y + height - HEATMAP_HEADER_HEIGHT);
+    for (int ty = (int)heatmap_scroll_y / HEATMAP_TILE_SIZE; ty * HEATMAP_TILE_SIZE < last_y; ty++) {
+        for (int tx = (int)heatmap_scroll_x / HEATMAP_TILE_SIZE; tx * HEATMAP_TILE_SIZE < last_x; tx++) {
+            const guint32 *pixels = heatmap_view_tile(heatmap_view, heatmap_zoom, tx, ty);
+            if (!pixels)
+                continue;
+
+            cairo_surface_t *tile = cairo_image_surface_create_for_data((unsigned char *)pixels, CAIRO_FORMAT_ARGB32,
+                                                                        HEATMAP_TILE_SIZE, HEATMAP_TILE_SIZE,
+                                                                        HEATMAP_TILE_SIZE * sizeof(guint32));
+            cairo_set_source_surface(cr, tile, tx * HEATMAP_TILE_SIZE - heatmap_scroll_x,
+                                     HEATMAP_HEADER_HEIGHT + ty * HEATMAP_TILE_SIZE - heatmap_scroll_y);
+            cairo_paint(cr);
+            cairo_surface_destroy(tile);
+        }
+    }
+    cairo_restore(cr);
+
+    draw_heatmap_labels(cr, get_graph_layout(widget), width);
+    trace_end("draw_heatmap", span);
+    return FALSE;
+}
+
+/* Switches zoom level while keeping the day under `anchor_x` in place. */
+static void set_heatmap_zoom(GtkWidget *widget, int zoom, double anchor_x)
+{
+    const HeatmapZoom *zooms;
+    int levels = heatmap_zoom_levels(&zooms);
+    zoom = CLAMP(zoom, 0, levels - 1);
+    if (zoom == heatmap_zoom)
+        return;
+
+    const HeatmapZoom *from = &zooms[heatmap_zoom];
+    const HeatmapZoom *to = &zooms[zoom];
+    double days = (heatmap_scroll_x + anchor_x) / from->cell_size * from->days_per_cell;
+    heatmap_scroll_x = days / to->days_per_cell * to->cell_size - anchor_x;
+    heatmap_scroll_y = heatmap_scroll_y * to->cell_size / from->cell_size;
+    heatmap_zoom = zoom;
+    heatmap_follow_end = FALSE;
+    gtk_widget_queue_draw(widget);
+}
+
+static void scroll_heatmap(GtkWidget *widget, double dx, double dy)
+{
+    heatmap_scroll_x += dx;
+    heatmap_scroll_y += dy;
+    heatmap_follow_end = FALSE;
+    heatmap_clamp_scroll(widget);
+    gtk_widget_queue_draw(widget);
+}
+
+/* Ctrl+wheel zooms around the pointer; the wheel pans through time, or
+ * across habits with Shift held. */
+static gboolean on_heatmap_scroll(GtkWidget *widget, GdkEventScroll *event, gpointer user_data)
+{
+    (void)user_data;
+
+    double delta = event->delta_x + event->delta_y;
+    if (event->direction == GDK_SCROLL_UP || event->direction == GDK_SCROLL_LEFT)
+        delta = -1.0;
+    else if (event->direction == GDK_SCROLL_DOWN || event->direction == GDK_SCROLL_RIGHT)
+        delta = 1.0;
+    if (!heatmap_snapshot || delta == 0.0)
+        return FALSE;
+
+    if (event->state & GDK_CONTROL_MASK)
+        set_heatmap_zoom(widget, heatmap_zoom + (delta > 0 ? 1 : -1), event->x);
+    else if (event->state & GDK_SHIFT_MASK)
+        scroll_heatmap(widget, 0.0, delta * HEATMAP_SCROLL_STEP);
+    else
+        scroll_heatmap(widget, delta * HEATMAP_SCROLL_STEP, 0.0);
+    return TRUE;
+}
+
+static gboolean on_heatmap_button_press(GtkWidget *widget, GdkEventButton *event, gpointer user_data)
+{
+    (void)widget;
+    (void)user_data;
+
+    if (event->type != GDK_BUTTON_PRESS || event->button != GDK_BUTTON_PRIMARY)
+        return FALSE;
+
+    heatmap_dragging = TRUE;
+    heatmap_drag_x = event->x;
+    heatmap_drag_y = event->y;
+    return TRUE;
+}
+
+static gboolean on_heatmap_button_release(GtkWidget *widget, GdkEventButton *event, gpointer user_data)
+{
+    (void)widget;
+    (void)user_data;
+
+    if (event->button != GDK_BUTTON_PRIMARY)
+        return FALSE;
+
+    heatmap_dragging = FALSE;
+    return TRUE;
+}
+
+static gboolean on_heatmap_motion(GtkWidget *widget, GdkEventMotion *event, gpointer user_data)
+{
+    (void)user_data;
+
+    if (!heatmap_dragging || !heatmap_snapshot)
+        return FALSE;
+
+    scroll_heatmap(widget, heatmap_drag_x - event->x, heatmap_drag_y - event->y);
+    heatmap_drag_x = event->x;
+    heatmap_drag_y = event->y;
+    return TRUE;
+}
+
+static gboolean on_heatmap_query_tooltip(GtkWidget *widget, gint x, gint y, gboolean keyboard_mode,
+                                         GtkTooltip *tooltip, gpointer user_data)
+{
+    (void)widget;
+    (void)user_data;
+
+    HeatmapCell cell;
+    if (keyboard_mode || !heatmap_snapshot || y < HEATMAP_HEADER_HEIGHT ||
+        !heatmap_snapshot_cell(heatmap_snapshot, heatmap_zoom, x + (int)heatmap_scroll_x,
+                               y - HEATMAP_HEADER_HEIGHT + (int)heatmap_scroll_y, &cell))
+        return FALSE;
+
+    char first[40];
+    char last[40];
+    int days = cell.end_day - cell.start_day;
+    gchar *text;
+    format_day_label(cell.start_day, first, sizeof(first));
+    if (days == 1) {
+        text = g_strdup_printf("%s, %s\n%s", tracker.names[cell.habit], first, cell.checked ? "Done" : "Not done");
+    } else {
+        format_day_label(cell.end_day - 1, last, sizeof(last));
+        text = g_strdup_printf("%s, %s – %s\nDone %d of %d days", tracker.names[cell.habit], first, last,
+                               cell.checked, days);
+    }
+    gtk_tooltip_set_text(tooltip, text);
+    g_free(text);
+    return TRUE;
+}
+
+static void grid_cell_origin(int habit, int day, double *x, double *y)
+{
+    *x = GRID_CELLS_X + day * GRID_CELL_STRIDE;
+    *y = GRID_CELLS_Y + habit * GRID_CELL_STRIDE;
+}
+
+static gboolean grid_hit_test(double x, double y, int *habit, int *day)
+{
+    if (x < GRID_CELLS_X || y < GRID_CELLS_Y)
+        return FALSE;
+
+    int col = (int)((x - GRID_CELLS_X) / GRID_CELL_STRIDE);
+    int row = (int)((y - GRID_CELLS_Y) / GRID_CELL_STRIDE);
+    if (col >= tracker.day_count || row >= tracker.habit_count)
+        return FALSE;
+
+    double cell_x, cell_y;
+    grid_cell_origin(row, col, &cell_x, &cell_y);
+    if (x - cell_x >= GRID_CELL_SIZE || y - cell_y >= GRID_CELL_SIZE)
+        return FALSE;
+
+    *habit = row;
+    *day = col;
+    return TRUE;
+}
+
+static void queue_grid_cell_draw(int habit, int day)
+{
+    if (!habit_grid_area || habit < 0 || day < 0)
+        return;
+
+    double x, y;
+    grid_cell_origin(habit, day, &x, &y);
+    gtk_widget_queue_draw_area(habit_grid_area, (int)x - 3, (int)y - 3, GRID_CELL_SIZE + 6, GRID_CELL_SIZE + 6);
+}
+
+static void queue_grid_range_draw(int first_habit, int last_habit, int first_day, int last_day)
+{
+    if (!habit_grid_area)
+        return;
+
+    double x, y;
+    grid_cell_origin(first_habit, first_day, &x, &y);
+    gtk_widget_queue_draw_area(habit_grid_area, (int)x - 3, (int)y - 3,
+                               (last_day - first_day) * GRID_CELL_STRIDE + GRID_CELL_SIZE + 6,
+                               (last_habit - first_habit) * GRID_CELL_STRIDE + GRID_CELL_SIZE + 6);
+}
+
+static void grid_selection_bounds(int *first_habit, int *last_habit, int *first_day, int *last_day)
+{
+    *first_habit = MIN(grid_drag_habit, grid_drag_to_habit);
+    *last_habit = MAX(grid_drag_habit, grid_drag_to_habit);
+    *first_day = MIN(grid_drag_day, grid_drag_to_day);
+    *last_day = MAX(grid_drag_day, grid_drag_to_day);
+}
+
+static gboolean grid_cell_selected(int habit, int day)
+{
+    if (grid_drag_habit < 0)
+        return FALSE;
+
+    int first_habit, last_habit, first_day, last_day;
+    grid_selection_bounds(&first_habit, &last_habit, &first_day, &last_day);
+    return habit >= first_habit && habit <= last_habit && day >= first_day && day <= last_day;
+}
+
+static void queue_grid_selection_draw(void)
+{
+    if (grid_drag_habit < 0)
+        return;
+
+    int first_habit, last_habit, first_day, last_day;
+    grid_selection_bounds(&first_habit, &last_habit, &first_day, &last_day);
+    queue_grid_range_draw(first_habit, last_habit, first_day, last_day);
+}
+
+static void queue_grid_names_draw(void)
+{
+    if (!habit_grid_area)
+        return;
+
+    gtk_widget_queue_draw_area(habit_grid_area, 0, GRID_CELLS_Y, GRID_CELLS_X,
+                               tracker.habit_count * GRID_CELL_STRIDE);
+}
+
+static void update_grid_size(void)
+{
+    int width = GRID_CELLS_X + tracker.day_count * GRID_CELL_STRIDE - GRID_SPACING + GRID_PADDING;
+    int height = GRID_CELLS_Y + tracker.habit_count * GRID_CELL_STRIDE - GRID_SPACING + GRID_PADDING;
+    gtk_widget_set_size_request(habit_grid_area, width, height);
+}
+
+static void rounded_rectangle(cairo_t *cr, double x, double y, double w, double h, double r)
+{
+    cairo_new_sub_path(cr);
+    cairo_arc(cr, x + w - r, y + r, r, -G_PI / 2, 0);
+    cairo_arc(cr, x + w - r, y + h - r, r, 0, G_PI / 2);
+    cairo_arc(cr, x + r, y + h - r, r, G_PI / 2, G_PI);
+    cairo_arc(cr, x + r, y + r, r, G_PI, 3 * G_PI / 2);
+    cairo_close_path(cr);
+}
+
+static void draw_grid_text(cairo_t *cr, PangoLayout *layout, const char *text,
+                           double x, double y, double w, double h, gboolean centered)
+{
+    int text_w, text_h;
+    pango_layout_set_text(layout, text, -1);
+    pango_layout_get_pixel_size(layout, &text_w, &text_h);
+
+    double text_x = centered ? x + (w - text_w) / 2.0 : x;
+    cairo_move_to(cr, text_x, y + (h - text_h) / 2.0);
+    pango_cairo_show_layout(cr, layout);
+}
+
+static void draw_grid_cell(cairo_t *cr, int habit, int day, gboolean focused)
+{
+    double x, y;
+    grid_cell_origin(habit, day, &x, &y);
+    gboolean selected = grid_cell_selected(habit, day);
+    gboolean checked = selected ? grid_drag_value : tracker_get_cell(&tracker, habit, day);
+    gboolean hovered = selected || (habit == grid_hover_habit && day == grid_hover_day);
+
+    rounded_rectangle(cr, x + 4.5, y + 4.5, GRID_CELL_SIZE - 9, GRID_CELL_SIZE - 9, 5.0);
+    if (checked)
+        cairo_set_source_rgb(cr, 0.306, 0.659, 0.373);
+    else
+        cairo_set_source_rgb(cr, 0.106, 0.141, 0.192);
+    cairo_fill_preserve(cr);
+
+    if (checked)
+        cairo_set_source_rgb(cr, 0.306, 0.659, 0.373);
+    else if (hovered)
+        cairo_set_source_rgb(cr, 0.369, 0.455, 0.584);
+    else
+        cairo_set_source_rgb(cr, 0.235, 0.290, 0.380);
+    cairo_set_line_width(cr, 1.0);
+    cairo_stroke(cr);
+
+    if (checked) {
+        cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
+        cairo_set_line_width(cr, 2.0);
+        cairo_move_to(cr, x + 8.5, y + 12.5);
+        cairo_line_to(cr, x + 11.5, y + 15.5);
+        cairo_line_to(cr, x + 16.5, y + 9.5);
+        cairo_stroke(cr);
+    }
+
+    if (focused) {
+        rounded_rectangle(cr, x + 1.5, y + 1.5, GRID_CELL_SIZE - 3, GRID_CELL_SIZE - 3, 6.0);
+        cairo_set_source_rgb(cr, 0.424, 0.561, 0.745);
+        cairo_set_line_width(cr, 1.5);
+        cairo_stroke(cr);
+    }
+}
+
+static gboolean on_draw_habit_grid(GtkWidget *widget, cairo_t *cr, gpointer user_data)
+{
+    (void)user_data;
+
+    gint64 span = trace_begin();
+    double clip_x1, clip_y1, clip_x2, clip_y2;
+    cairo_clip_extents(cr, &clip_x1, &clip_y1, &clip_x2, &clip_y2);
+
+    int first_day = MAX(0, (int)((clip_x1 - GRID_CELLS_X) / GRID_CELL_STRIDE));
+    int last_day = MIN(tracker.day_count - 1, (int)((clip_x2 - GRID_CELLS_X) / GRID_CELL_STRIDE));
+    int first_habit = MAX(0, (int)((clip_y1 - GRID_CELLS_Y) / GRID_CELL_STRIDE));
+    int last_habit = MIN(tracker.habit_count - 1, (int)((clip_y2 - GRID_CELLS_Y) / GRID_CELL_STRIDE));
+
+    PangoLayout *layout = gtk_widget_create_pango_layout(widget, NULL);
+    PangoFontDescription *font = pango_font_description_copy(
+        pango_context_get_font_description(gtk_widget_get_pango_context(widget)));
+
+    if (clip_y1 < GRID_CELLS_Y) {
+        pango_font_description_set_size(font, 8 * PANGO_SCALE);
+        pango_layout_set_font_description(layout, font);
+        cairo_set_source_rgb(cr, 0.498, 0.565, 0.655);
+
+        if (clip_x1 < GRID_CELLS_X) {
+            draw_grid_text(cr, layout, "#", GRID_PADDING, GRID_PADDING,
+                           GRID_ROW_NUM_WIDTH, GRID_HEADER_HEIGHT, TRUE);
+            draw_grid_text(cr, layout, "Habits", GRID_PADDING + GRID_ROW_NUM_WIDTH + GRID_SPACING,
+                           GRID_PADDING, GRID_NAME_WIDTH, GRID_HEADER_HEIGHT, FALSE);
+        }
+
+        for (int d = first_day; d <= last_day; d++) {
+            GDate date;
+            char day_text[12];
+            g_date_clear(&date, 1);
+            g_date_set_julian(&date, (guint32)(tracker.history.cycle_start + d));
+            snprintf(day_text, sizeof(day_text), "%d", g_date_get_day(&date));
+            draw_grid_text(cr, layout, day_text, GRID_CELLS_X + d * GRID_CELL_STRIDE, GRID_PADDING,
+                           GRID_CELL_SIZE, GRID_HEADER_HEIGHT, TRUE);
+        }
+    }
+
+    if (clip_x1 < GRID_CELLS_X) {
+        for (int i = first_habit; i <= last_habit; i++) {
+            double row_y = GRID_CELLS_Y + i * GRID_CELL_STRIDE;
+            char row_text[12];
+            snprintf(row_text, sizeof(row_text), "%d", i + 1);
+
+            pango_font_description_set_size(font, 9 * PANGO_SCALE);
+            pango_layout_set_font_description(layout, font);
+            cairo_set_source_rgb(cr, 0.588, 0.639, 0.718);
+            draw_grid_text(cr, layout, row_text, GRID_PADDING, row_y,
+                           GRID_ROW_NUM_WIDTH, GRID_CELL_SIZE, TRUE);
+
+            pango_layout_set_font_description(layout, NULL);
+            pango_layout_set_width(layout, GRID_NAME_WIDTH * PANGO_SCALE);
+            pango_layout_set_ellipsize(layout, PANGO_ELLIPSIZE_END);
+            cairo_set_source_rgb(cr, 0.890, 0.922, 0.973);
+            draw_grid_text(cr, layout, habit_row_text[i], GRID_PADDING + GRID_ROW_NUM_WIDTH + GRID_SPACING,
+                           row_y, GRID_NAME_WIDTH, GRID_CELL_SIZE, FALSE);
+            pango_layout_set_width(layout, -1);
+            pango_layout_set_ellipsize(layout, PANGO_ELLIPSIZE_NONE);
+        }
+    }
+
+    gboolean has_focus = gtk_widget_has_focus(widget);
+    for (int i = first_habit; i <= last_habit; i++) {
+        for (int d = first_day; d <= last_day; d++)
+            draw_grid_cell(cr, i, d, has_focus && i == grid_focus_habit && d == grid_focus_day);
+    }
+
+    pango_font_description_free(font);
+    g_object_unref(layout);
+    trace_end("draw_habit_grid", span);
+
+    if (startup_span) {
+        trace_end("startup_to_first_draw", startup_span);
+        startup_span = 0;
+    }
+    return FALSE;
+}
+
+static void scroll_grid_to_cell(int habit, int day)
+{
+    double x, y;
+    grid_cell_origin(habit, day, &x, &y);
+
+    GtkAdjustment *hadj = gtk_scrolled_window_get_hadjustment(GTK_SCROLLED_WINDOW(grid_scroll));
+    double value = gtk_adjustment_get_value(hadj);
+    double page = gtk_adjustment_get_page_size(hadj);
+
+    if (x - GRID_SPACING < value)
+        gtk_adjustment_set_value(hadj, x - GRID_SPACING);
+    else if (x + GRID_CELL_SIZE + GRID_SPACING > value + page)
+        gtk_adjustment_set_value(hadj, x + GRID_CELL_SIZE + GRID_SPACING - page);
+
+    /* The grid only scrolls sideways; rows below the fold are reached by
+     * scrolling the whole page. */
+    int row_x, row_y;
+    if (!gtk_widget_translate_coordinates(habit_grid_area, page_content, (int)x, (int)y, &row_x, &row_y))
+        return;
+    GtkAdjustment *vadj = gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(page_scroll));
+    value = gtk_adjustment_get_value(vadj);
+    page = gtk_adjustment_get_page_size(vadj);
+    if (row_y - GRID_SPACING < value)
+        gtk_adjustment_set_value(vadj, row_y - GRID_SPACING);
+    else if (row_y + GRID_CELL_SIZE + GRID_SPACING > value + page)
+        gtk_adjustment_set_value(vadj, row_y + GRID_CELL_SIZE + GRID_SPACING - page);
+}
+
+static void move_grid_focus(int habit, int day)
+{
+    habit = CLAMP(habit, 0, tracker.habit_count - 1);
+    day = CLAMP(day, 0, tracker.day_count - 1);
+    if (habit == grid_focus_habit && day == grid_focus_day)
+        return;
+
+    queue_grid_cell_draw(grid_focus_habit, grid_focus_day);
+    grid_focus_habit = habit;
+    grid_focus_day = day;
+    queue_grid_cell_draw(grid_focus_habit, grid_focus_day);
+    scroll_grid_to_cell(grid_focus_habit, grid_focus_day);
+}
+
+static gboolean on_habit_grid_button_press(GtkWidget *widget, GdkEventButton *event, gpointer user_data)
+{
+    (void)user_data;
+
+    if (event->type != GDK_BUTTON_PRESS || event->button != GDK_BUTTON_PRIMARY)
+        return FALSE;
+
+    int habit, day;
+    if (!grid_hit_test(event->x, event->y, &habit, &day))
+        return FALSE;
+
+    gtk_widget_grab_focus(widget);
+    move_grid_focus(habit, day);
+    grid_drag_habit = grid_drag_to_habit = habit;
+    grid_drag_day = grid_drag_to_day = day;
+    grid_drag_value = !tracker_get_cell(&tracker, habit, day);
+    queue_grid_cell_draw(habit, day);
+    return TRUE;
+}
+
+/* A click toggles one cell; a drag sets the whole rectangle it covered to the
+ * opposite of where it started, as a single edit. */
+static gboolean on_habit_grid_button_release(GtkWidget *widget, GdkEventButton *event, gpointer user_data)
+{
+    (void)widget;
+    (void)user_data;
+
+    if (event->button != GDK_BUTTON_PRIMARY || grid_drag_habit < 0)
+        return FALSE;
+
+    gint64 span = trace_begin();
+    int first_habit, last_habit, first_day, last_day;
+    grid_selection_bounds(&first_habit, &last_habit, &first_day, &last_day);
+    grid_drag_habit = -1;
+    if (tracker_set_range(&tracker, first_habit, last_habit, first_day, last_day, grid_drag_value, NULL) > 0) {
+        ipc_server_notify(ipc_server);
+        mark_ui_dirty(UI_DIRTY_CHECKS);
+    }
+    queue_grid_range_draw(first_habit, last_habit, first_day, last_day);
+    trace_end("fill_selection", span);
+    return TRUE;
+}
+
+static gboolean on_habit_grid_motion(GtkWidget *widget, GdkEventMotion *event, gpointer user_data)
+{
+    (void)widget;
+    (void)user_data;
+
+    int habit = -1;
+    int day = -1;
+    if (!grid_hit_test(event->x, event->y, &habit, &day)) {
+        habit = -1;
+        day = -1;
+    }
+
+    if (grid_drag_habit >= 0 && habit >= 0 && (habit != grid_drag_to_habit || day != grid_drag_to_day)) {
+        queue_grid_selection_draw();
+        grid_drag_to_habit = habit;
+        grid_drag_to_day = day;
+        queue_grid_selection_draw();
+    }
+
+    if (habit != grid_hover_habit || day != grid_hover_day) {
+        queue_grid_cell_draw(grid_hover_habit, grid_hover_day);
+        grid_hover_habit = habit;
+        grid_hover_day = day;
+        queue_grid_cell_draw(grid_hover_habit, grid_hover_day);
+    }
+
+    return FALSE;
+}
+
+static gboolean on_habit_grid_query_tooltip(GtkWidget *widget, gint x, gint y, gboolean keyboard_mode,
+                                            GtkTooltip *tooltip, gpointer user_data)
+{
+    (void)widget;
+    (void)user_data;
+
+    int habit = grid_focus_habit;
+    int day = grid_focus_day;
+    if (!keyboard_mode && !grid_hit_test(x, y, &habit, &day))
+        return FALSE;
+
+    double cell_x, cell_y;
+    grid_cell_origin(habit, day, &cell_x, &cell_y);
+    GdkRectangle area = { (int)cell_x, (int)cell_y, GRID_CELL_SIZE, GRID_CELL_SIZE };
+
+    const StreakRun *run = habit_streaks_find(&tracker.streaks, &tracker.history, habit, tracker.history.cycle_start + day);
+    int length = run ? run->length : 0;
+    int current = tracker_current_streak(&tracker, habit);
+    int longest = tracker_longest_streak(&tracker, habit);
+    char date_text[40];
+    format_day_label(tracker.history.cycle_start + day, date_text, sizeof(date_text));
+    gchar *text = g_strdup_printf("%s, %s\nThis streak: %d %s\nCurrent streak: %d %s\nLongest streak: %d %s",
+                                  tracker.names[habit], date_text, length, day_unit(length),
+                                  current, day_unit(current), longest, day_unit(longest));
+    gtk_tooltip_set_text(tooltip, text);
+    gtk_tooltip_set_tip_area(tooltip, &area);
+    g_free(text);
+    return TRUE;
+}
+
+static gboolean on_habit_grid_leave(GtkWidget *widget, GdkEventCrossing *event, gpointer user_data)
+{
+    (void)widget;
+    (void)event;
+    (void)user_data;
+
+    queue_grid_cell_draw(grid_hover_habit, grid_hover_day);
+    grid_hover_habit = -1;
+    grid_hover_day = -1;
+    return FALSE;
+}
+
+static gboolean on_habit_grid_key_press(GtkWidget *widget, GdkEventKey *event, gpointer user_data)
+{
+    (void)widget;
+    (void)user_data;
+
+    switch (event->keyval) {
+    case GDK_KEY_Left:
+        move_grid_focus(grid_focus_habit, grid_focus_day - 1);
+        return TRUE;
+    case GDK_KEY_Right:
+        move_grid_focus(grid_focus_habit, grid_focus_day + 1);
+        return TRUE;
+    case GDK_KEY_Up:
+        move_grid_focus(grid_focus_habit - 1, grid_focus_day);
+        return TRUE;
+    case GDK_KEY_Down:
+        move_grid_focus(grid_focus_habit + 1, grid_focus_day);
+        return TRUE;
+    case GDK_KEY_Home:
+        move_grid_focus(grid_focus_habit, 0);
+        return TRUE;
+    case GDK_KEY_End:
+        move_grid_focus(grid_focus_habit, tracker.day_count - 1);
+        return TRUE;
+    case GDK_KEY_space:
+    case GDK_KEY_Return:
+    case GDK_KEY_KP_Enter:
+        toggle_cell(grid_focus_habit, grid_focus_day);
+        return TRUE;
+    case GDK_KEY_Escape:
+        if (grid_drag_habit < 0)
+            return FALSE;
+        queue_grid_selection_draw();
+        grid_drag_habit = -1;
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+static gboolean on_habit_grid_focus_change(GtkWidget *widget, GdkEventFocus *event, gpointer user_data)
+{
+    (void)widget;
+    (void)event;
+    (void)user_data;
+
+    queue_grid_cell_draw(grid_focus_habit, grid_focus_day);
+    return FALSE;
+}
+
+static void set_label_text(GtkWidget *label, const char *text)
+{
+    if (g_strcmp0(gtk_label_get_text(GTK_LABEL(label)), text) != 0)
+        gtk_label_set_text(GTK_LABEL(label), text);
+}
+
+static void update_tracker_title(void)
+{
+    gchar *title_text = g_strdup_printf("%d Day Tracker", tracker.day_count);
+    set_label_text(title_label, title_text);
+    if (g_strcmp0(gtk_window_get_title(GTK_WINDOW(main_window)), title_text) != 0)
+        gtk_window_set_title(GTK_WINDOW(main_window), title_text);
+    g_free(title_text);
+}
+
+static void update_day_column_visibility(void)
+{
+    if (grid_focus_day >= tracker.day_count)
+        grid_focus_day = tracker.day_count - 1;
+    update_grid_size();
+    gtk_widget_queue_draw(habit_grid_area);
+}
+
+static void update_percentage(void)
+{
+    int total = tracker.habit_count * tracker.day_count;
+    int checked = tracker_count_checked(&tracker);
+    int percent = (total > 0) ? (checked * 100) / total : 0;
+    gchar *text = g_strdup_printf("%d%%", percent);
+    set_label_text(complete_label, text);
+    g_free(text);
+}
+
+/* Habits can be added while the app runs, by the user, an import or
+ * another instance, so the row text grows with the tracker. */
+static void sync_habit_rows(void)
+{
+    if (habit_row_count == tracker.habit_count)
+        return;
+
+    habit_row_text = g_realloc(habit_row_text, (gsize)tracker.habit_count * HABIT_ROW_TEXT_LEN);
+    memset(habit_row_text + habit_row_count, 0, (gsize)(tracker.habit_count - habit_row_count) * HABIT_ROW_TEXT_LEN);
+    habit_row_count = tracker.habit_count;
+    if (habit_grid_area)
+        update_grid_size();
+}
+
+static void update_habit_row_labels(void)
+{
+    gboolean changed = FALSE;
+    for (int i = 0; i < tracker.habit_count; i++) {
+        int checked = tracker_count_checked_for_habit(&tracker, i);
+        int percent = (tracker.day_count > 0) ? (checked * 100) / tracker.day_count : 0;
+        char text[sizeof(habit_row_text[i])];
+        snprintf(text, sizeof(text), "%s (%d%%)", tracker.names[i], percent);
+        if (strcmp(text, habit_row_text[i]) != 0) {
+            memcpy(habit_row_text[i], text, sizeof(text));
+            changed = TRUE;
+        }
+    }
+    if (changed)
+        queue_grid_names_draw();
+}
+
+static void rebuild_rename_combo(int selected_index)
+{
+    gtk_combo_box_text_remove_all(GTK_COMBO_BOX_TEXT(rename_combo));
+    for (int i = 0; i < tracker.habit_count; i++)
+        gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(rename_combo), tracker.names[i]);
+
+    if (selected_index < 0 || selected_index >= tracker.habit_count)
+        selected_index = 0;
+    gtk_combo_box_set_active(GTK_COMBO_BOX(rename_combo), selected_index);
+}
+
+static void update_day_action_range(void)
+{
+    if (!day_action_display)
+        return;
+
+    if (day_action_value < 1)
+        day_action_value = 1;
+    if (day_action_value > tracker.day_count)
+        day_action_value = tracker.day_count;
+
+    gchar *text = g_strdup_printf("%d", day_action_value);
+    if (g_strcmp0(gtk_entry_get_text(GTK_ENTRY(day_action_display)), text) != 0)
+        gtk_entry_set_text(GTK_ENTRY(day_action_display), text);
+    g_free(text);
+}
+
+static void apply_selected_day_to_all(gboolean value)
+{
+    if (!day_action_display)
+        return;
+
+    int day_index = day_action_value - 1;
+    if (day_index < 0 || day_index >= tracker.day_count)
+        return;
+
+    if (tracker_set_range(&tracker, 0, tracker.habit_count - 1, day_index, day_index, value, NULL) == 0)
+        return;
+
+    ipc_server_notify(ipc_server);
+    queue_grid_range_draw(0, tracker.habit_count - 1, day_index, day_index);
+    mark_ui_dirty(UI_DIRTY_CHECKS);
+}
+
+static void on_fill_day(GtkButton *button, gpointer user_data)
+{
+    (void)button;
+    (void)user_data;
+    apply_selected_day_to_all(TRUE);
+}
+
+static void on_clear_day(GtkButton *button, gpointer user_data)
+{
+    (void)button;
+    (void)user_data;
+    apply_selected_day_to_all(FALSE);
+}
+
+static void update_statistics_panel(void)
+{
+    if (!stats_summary_label)
+        return;
+
+    gchar *summary = tracker_format_summary(&tracker);
+    set_label_text(stats_summary_label, summary);
+    g_free(summary);
+
+    gchar *weekly = tracker_format_weekly(&tracker);
+    set_label_text(weekly_label, weekly);
+    g_free(weekly);
+}
+
+static void flush_ui_refresh(void)
+{
+    guint dirty = ui_dirty;
+    ui_dirty = 0;
+    if (!dirty)
+        return;
+
+    gint64 span = trace_begin();
+    if (dirty & UI_DIRTY_TITLE)
+        update_tracker_title();
+    if (dirty & UI_DIRTY_GRID_SIZE)
+        update_day_column_visibility();
+    if (dirty & UI_DIRTY_DAY_ACTION)
+        update_day_action_range();
+    if (dirty & UI_DIRTY_PERCENT)
+        update_percentage();
+    if (dirty & UI_DIRTY_HABIT_LABELS)
+        update_habit_row_labels();
+    if (dirty & UI_DIRTY_STATS)
+        update_statistics_panel();
+    if (dirty & UI_DIRTY_GRAPH) {
+        invalidate_graph_cache();
+        update_heatmap_snapshot();
+    }
+    trace_end("flush_ui_refresh", span);
+}
+
+static gboolean on_ui_refresh_tick(GtkWidget *widget, GdkFrameClock *frame_clock, gpointer user_data)
+{
+    (void)widget;
+    (void)frame_clock;
+    (void)user_data;
+
+    ui_refresh_tick = 0;
+    flush_ui_refresh();
+    return G_SOURCE_REMOVE;
+}
+
+static void mark_ui_dirty(guint flags)
+{
+    ui_dirty |= flags;
+    if (!ui_refresh_tick && main_window)
+        ui_refresh_tick = gtk_widget_add_tick_callback(main_window, on_ui_refresh_tick, NULL, NULL);
+}
+
+static void toggle_cell(int item, int day)
+{
+    gint64 span = trace_begin();
+    tracker_set_cell(&tracker, item, day, !tracker_get_cell(&tracker, item, day));
+    ipc_server_notify(ipc_server);
+    mark_ui_dirty(UI_DIRTY_CHECKS);
+    queue_grid_cell_draw(item, day);
+    trace_end("toggle_cell", span);
+}
+
+static void on_day_count_changed(GtkComboBox *combo, gpointer user_data)
+{
+    (void)user_data;
+    const gchar *id = gtk_combo_box_get_active_id(combo);
+    if (!id)
+        return;
+
+    int new_day_count = normalize_day_count(atoi(id));
+    if (new_day_count == tracker.day_count)
+        return;
+
+    tracker_set_day_count(&tracker, new_day_count);
+    ipc_server_notify(ipc_server);
+    mark_ui_dirty(UI_DIRTY_ALL);
+}
+
+static void update_window_mode(void)
+{
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(rolling_check), tracker.history.rolling);
+    gtk_widget_set_sensitive(reset_button, !tracker.history.rolling);
+}
+
+static void on_rolling_toggled(GtkToggleButton *button, gpointer user_data)
+{
+    (void)user_data;
+    gboolean rolling = gtk_toggle_button_get_active(button);
+    if (rolling == tracker.history.rolling)
+        return;
+
+    tracker_set_rolling(&tracker, rolling);
+    ipc_server_notify(ipc_server);
+    update_window_mode();
+    gtk_widget_queue_draw(habit_grid_area);
+    mark_ui_dirty(UI_DIRTY_ALL);
+}
+
+static void schedule_midnight_rollover(void);
+
+static gboolean on_midnight(gpointer user_data)
+{
+    (void)user_data;
+    midnight_source = 0;
+    if (tracker_roll_to_today(&tracker) && habit_grid_area)
+        gtk_widget_queue_draw(habit_grid_area);
+    /* Today's stats move with the date even when no cells were rolled. */
+    ipc_server_notify(ipc_server);
+    mark_ui_dirty(UI_DIRTY_ALL);
+    schedule_midnight_rollover();
+    return G_SOURCE_REMOVE;
+}
+
+/* Wakes just after the next local midnight. Rolling is idempotent, so an
+ * early wake-up around a DST change simply reschedules. */
+static void schedule_midnight_rollover(void)
+{
+    GDateTime *now = g_date_time_new_now_local();
+    int elapsed = g_date_time_get_hour(now) * 3600 + g_date_time_get_minute(now) * 60 + g_date_time_get_second(now);
+    g_date_time_unref(now);
+    midnight_source = g_timeout_add_seconds((guint)(SECONDS_PER_DAY - elapsed + 1), on_midnight, NULL);
+}
+
+static void perform_full_reset(void)
+{
+    tracker_start_new_cycle(&tracker);
+    ipc_server_notify(ipc_server);
+    gtk_widget_queue_draw(habit_grid_area);
+    mark_ui_dirty(UI_DIRTY_CHECKS);
+}
+
+static void on_reset(GtkButton *button, gpointer user_data)
 {
     (void)button;
     (void)user_data;
+    if (tracker.history.rolling)
+        return;
 
     GtkWidget *dialog = gtk_message_dialog_new(
         GTK_WINDOW(main_window),
         GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
         GTK_MESSAGE_WARNING,
         GTK_BUTTONS_YES_NO,
-        "Reset all habit progress for all days?");
+        "Start a new cycle?");
 
     gtk_message_dialog_format_secondary_text(
         GTK_MESSAGE_DIALOG(dialog),
-        "This clears all checked boxes in the tracker.");
+        "The current cycle is archived in your history and the tracker starts empty.");
 
     int response = gtk_dialog_run(GTK_DIALOG(dialog));
     gtk_widget_destroy(dialog);
@@ -936,296 +1670,750 @@ static void on_reset(GtkButton *button, gpointer user_data)
         perform_full_reset();
 }
 
+static void on_export_progress(double fraction, gpointer user_data)
+{
+    (void)user_data;
+    gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(export_progress_bar), fraction);
+}
+
+static void on_export_done(gboolean ok, gboolean cancelled, gpointer user_data)
+{
+    (void)user_data;
+
+    gchar *path = g_strdup(export_job->path);
+    export_job_free(export_job);
+    export_job = NULL;
+    gtk_widget_destroy(export_progress_dialog);
+    export_progress_dialog = NULL;
+    export_progress_bar = NULL;
+
+    if (!cancelled) {
+        GtkWidget *dialog = gtk_message_dialog_new(
+            GTK_WINDOW(main_window),
+            GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
+            ok ? GTK_MESSAGE_INFO : GTK_MESSAGE_ERROR,
+            GTK_BUTTONS_OK,
+            ok ? "Stats exported successfully." : "Export failed.");
+        gtk_message_dialog_format_secondary_text(
+            GTK_MESSAGE_DIALOG(dialog),
+            ok ? "Saved to %s in your app folder." : "Could not write %s.", path);
+        gtk_dialog_run(GTK_DIALOG(dialog));
+        gtk_widget_destroy(dialog);
+    }
+    g_free(path);
+}
+
+static void on_export_progress_response(GtkDialog *dialog, gint response, gpointer user_data)
+{
+    (void)dialog;
+    (void)response;
+    (void)user_data;
+
+    if (export_job)
+        export_job_cancel(export_job);
+}
+
+static void on_export_format_changed(GtkComboBox *combo, gpointer user_data)
+{
+    gtk_widget_set_sensitive(GTK_WIDGET(user_data), g_strcmp0(gtk_combo_box_get_active_id(combo), "text") != 0);
+}
+
+static gboolean choose_export_options(ExportFormat *format, ExportGranularity *granularity)
+{
+    GtkWidget *dialog = gtk_dialog_new_with_buttons(
+        "Export Stats", GTK_WINDOW(main_window),
+        GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
+        "_Cancel", GTK_RESPONSE_CANCEL,
+        "_Export", GTK_RESPONSE_ACCEPT,
+        NULL);
+
+    GtkWidget *grid = gtk_grid_new();
+    gtk_grid_set_row_spacing(GTK_GRID(grid), 8);
+    gtk_grid_set_column_spacing(GTK_GRID(grid), 12);
+    gtk_container_set_border_width(GTK_CONTAINER(grid), 12);
+    gtk_container_add(GTK_CONTAINER(gtk_dialog_get_content_area(GTK_DIALOG(dialog))), grid);
+
+    GtkWidget *format_combo = gtk_combo_box_text_new();
+    gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(format_combo), "text", "Summary (text)");
+    gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(format_combo), "csv", "CSV");
+    gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(format_combo), "json", "JSON");
+    gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(format_combo), "binary", "Binary");
+
+    GtkWidget *detail_combo = gtk_combo_box_text_new();
+    gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(detail_combo), "cell", "Every check-in");
+    gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(detail_combo), "habit", "Per habit");
+    gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(detail_combo), "day", "Per day");
+    gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(detail_combo), "week", "Per week");
+    gtk_combo_box_set_active_id(GTK_COMBO_BOX(detail_combo), "day");
+
+    g_signal_connect(format_combo, "changed", G_CALLBACK(on_export_format_changed), detail_combo);
+    gtk_combo_box_set_active_id(GTK_COMBO_BOX(format_combo), "text");
+
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Format"), 0, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), format_combo, 1, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Detail"), 0, 1, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), detail_combo, 1, 1, 1, 1);
+    gtk_widget_show_all(grid);
+
+    gboolean accepted = gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT;
+    if (accepted) {
+        export_parse_format(gtk_combo_box_get_active_id(GTK_COMBO_BOX(format_combo)), format);
+        export_parse_granularity(gtk_combo_box_get_active_id(GTK_COMBO_BOX(detail_combo)), granularity);
+    }
+    gtk_widget_destroy(dialog);
+    return accepted;
+}
+
 static void on_export_stats(GtkButton *button, gpointer user_data)
 {
     (void)button;
     (void)user_data;
 
-    FILE *f = fopen("stats_export.txt", "w");
-    if (!f) {
-        g_warning("could not open stats_export.txt for writing");
+    if (export_job) {
+        gtk_window_present(GTK_WINDOW(export_progress_dialog));
         return;
     }
 
-    int total = ITEM_COUNT * current_day_count;
-    int checked = count_checked();
-    int total_percent = (total > 0) ? (checked * 100) / total : 0;
-
-    fprintf(f, "%d-Day Tracker Export\n", current_day_count);
-    fprintf(f, "===================\n\n");
-    fprintf(f, "Overall: %d/%d (%d%%)\n\n", checked, total, total_percent);
-
-    fprintf(f, "Per-habit completion:\n");
-    for (int i = 0; i < ITEM_COUNT; i++) {
-        int habit_checked = count_checked_for_habit(i);
-        int habit_percent = (current_day_count > 0)
-            ? (habit_checked * 100) / current_day_count
-            : 0;
-        fprintf(f, "- %s: %d/%d (%d%%)\n", item_names[i], habit_checked, current_day_count, habit_percent);
-    }
+    ExportFormat format;
+    ExportGranularity granularity;
+    if (!choose_export_options(&format, &granularity))
+        return;
+
+    gchar *path = g_strdup_printf("%s.%s", STATS_EXPORT_STEM, export_format_extension(format));
+    export_job = export_job_new(&tracker, path, format, granularity);
+
+    export_progress_dialog = gtk_dialog_new_with_buttons(
+        "Exporting", GTK_WINDOW(main_window), GTK_DIALOG_DESTROY_WITH_PARENT,
+        "_Cancel", GTK_RESPONSE_CANCEL,
+        NULL);
+    GtkWidget *content = gtk_dialog_get_content_area(GTK_DIALOG(export_progress_dialog));
+    gtk_container_set_border_width(GTK_CONTAINER(content), 12);
+    gchar *message = g_strdup_printf("Writing %s…", path);
+    gtk_box_pack_start(GTK_BOX(content), gtk_label_new(message), FALSE, FALSE, 6);
+    export_progress_bar = gtk_progress_bar_new();
+    gtk_progress_bar_set_show_text(GTK_PROGRESS_BAR(export_progress_bar), TRUE);
+    gtk_box_pack_start(GTK_BOX(content), export_progress_bar, FALSE, FALSE, 6);
+    g_signal_connect(export_progress_dialog, "response", G_CALLBACK(on_export_progress_response), NULL);
+    gtk_widget_show_all(export_progress_dialog);
+    g_free(message);
+    g_free(path);
+
+    export_job_start(export_job, on_export_progress, on_export_done, NULL);
+}
+
+static gchar *format_import_result(const ImportResult *result)
+{
+    return g_strdup_printf("%" G_GINT64_FORMAT " rows: %" G_GINT64_FORMAT " changed, %" G_GINT64_FORMAT
+                           " duplicates, %" G_GINT64_FORMAT " invalid, %d habits added",
+                           result->rows, result->changed, result->duplicates, result->invalid,
+                           result->habits_created);
+}
+
+static void on_import_progress(double fraction, gpointer user_data)
+{
+    (void)user_data;
+    gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(import_progress_bar), fraction);
+}
+
+static void on_import_done(gboolean ok, gboolean cancelled, gpointer user_data)
+{
+    (void)user_data;
 
-    fprintf(f, "\nWeekly breakdown:\n");
-    int week_count = (current_day_count + 6) / 7;
-    for (int w = 0; w < week_count; w++) {
-        int start_day = (w * 7) + 1;
-        int end_day = start_day + 6;
-        if (end_day > current_day_count)
-            end_day = current_day_count;
-
-        int week_days = end_day - start_day + 1;
-        int week_total = ITEM_COUNT * week_days;
-        int week_checked = count_checked_in_week(w);
-        int week_percent = (week_total > 0) ? (week_checked * 100) / week_total : 0;
-
-        fprintf(f, "- Week %d (Day %d-%d): %d/%d (%d%%)\n",
-                w + 1, start_day, end_day, week_checked, week_total, week_percent);
+    import_job_apply(import_job, &tracker);
+    gchar *details = ok ? format_import_result(&import_job->result)
+                        : g_strdup_printf("Could not read %s.", import_job->path);
+    import_job_free(import_job);
+    import_job = NULL;
+    gtk_widget_destroy(import_progress_dialog);
+    import_progress_dialog = NULL;
+    import_progress_bar = NULL;
+
+    if (ok) {
+        sync_habit_rows();
+        ipc_server_notify(ipc_server);
+        rebuild_rename_combo(gtk_combo_box_get_active(GTK_COMBO_BOX(rename_combo)));
+        gtk_widget_queue_draw(habit_grid_area);
+        mark_ui_dirty(UI_DIRTY_ALL);
     }
+    if (!cancelled) {
+        GtkWidget *dialog = gtk_message_dialog_new(
+            GTK_WINDOW(main_window),
+            GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
+            ok ? GTK_MESSAGE_INFO : GTK_MESSAGE_ERROR,
+            GTK_BUTTONS_OK,
+            ok ? "Check-ins imported." : "Import failed.");
+        gtk_message_dialog_format_secondary_text(GTK_MESSAGE_DIALOG(dialog), "%s", details);
+        gtk_dialog_run(GTK_DIALOG(dialog));
+        gtk_widget_destroy(dialog);
+    }
+    g_free(details);
+}
+
+static void on_import_progress_response(GtkDialog *dialog, gint response, gpointer user_data)
+{
+    (void)dialog;
+    (void)response;
+    (void)user_data;
 
-    fclose(f);
+    if (import_job)
+        import_job_cancel(import_job);
+}
 
-    GtkWidget *dialog = gtk_message_dialog_new(
+static void on_import_history(GtkButton *button, gpointer user_data)
+{
+    (void)button;
+    (void)user_data;
+
+    if (import_job) {
+        gtk_window_present(GTK_WINDOW(import_progress_dialog));
+        return;
+    }
+
+    GtkWidget *chooser = gtk_file_chooser_dialog_new(
+        "Import Check-ins",
         GTK_WINDOW(main_window),
-        GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
-        GTK_MESSAGE_INFO,
-        GTK_BUTTONS_OK,
-        "Stats exported successfully.");
-    gtk_message_dialog_format_secondary_text(
-        GTK_MESSAGE_DIALOG(dialog),
-        "Saved to stats_export.txt in your app folder.");
-    gtk_dialog_run(GTK_DIALOG(dialog));
-    gtk_widget_destroy(dialog);
+        GTK_FILE_CHOOSER_ACTION_OPEN,
+        "_Cancel", GTK_RESPONSE_CANCEL,
+        "_Import", GTK_RESPONSE_ACCEPT,
+        NULL);
+    GtkFileFilter *filter = gtk_file_filter_new();
+    gtk_file_filter_set_name(filter, "CSV or JSON");
+    gtk_file_filter_add_pattern(filter, "*.csv");
+    gtk_file_filter_add_pattern(filter, "*.json");
+    gtk_file_chooser_add_filter(GTK_FILE_CHOOSER(chooser), filter);
+
+    gchar *path = NULL;
+    if (gtk_dialog_run(GTK_DIALOG(chooser)) == GTK_RESPONSE_ACCEPT)
+        path = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(chooser));
+    gtk_widget_destroy(chooser);
+    if (!path)
+        return;
+
+    import_job = import_job_new(&tracker, path);
+
+    import_progress_dialog = gtk_dialog_new_with_buttons(
+        "Importing", GTK_WINDOW(main_window), GTK_DIALOG_DESTROY_WITH_PARENT,
+        "_Cancel", GTK_RESPONSE_CANCEL,
+        NULL);
+    GtkWidget *content = gtk_dialog_get_content_area(GTK_DIALOG(import_progress_dialog));
+    gtk_container_set_border_width(GTK_CONTAINER(content), 12);
+    gchar *basename = g_path_get_basename(path);
+    gchar *message = g_strdup_printf("Reading %s…", basename);
+    gtk_box_pack_start(GTK_BOX(content), gtk_label_new(message), FALSE, FALSE, 6);
+    import_progress_bar = gtk_progress_bar_new();
+    gtk_progress_bar_set_show_text(GTK_PROGRESS_BAR(import_progress_bar), TRUE);
+    gtk_box_pack_start(GTK_BOX(content), import_progress_bar, FALSE, FALSE, 6);
+    g_signal_connect(import_progress_dialog, "response", G_CALLBACK(on_import_progress_response), NULL);
+    gtk_widget_show_all(import_progress_dialog);
+    g_free(message);
+    g_free(basename);
+    g_free(path);
+
+    import_job_start(import_job, on_import_progress, on_import_done, NULL);
+}
+
+static void on_rename_habit(GtkButton *button, gpointer user_data)
+{
+    (void)button;
+    (void)user_data;
+
+    int selected = gtk_combo_box_get_active(GTK_COMBO_BOX(rename_combo));
+    const gchar *new_name = gtk_entry_get_text(GTK_ENTRY(rename_entry));
+
+    if (selected < 0 || selected >= tracker.habit_count)
+        return;
+
+    if (!new_name)
+        return;
+
+    gchar *trimmed = g_strstrip(g_strdup(new_name));
+    if (!trimmed || trimmed[0] == '\0') {
+        g_free(trimmed);
+        return;
+    }
+
+    tracker_rename_habit(&tracker, selected, trimmed);
+    g_free(trimmed);
+    ipc_server_notify(ipc_server);
+
+    mark_ui_dirty(UI_DIRTY_HABIT_LABELS | UI_DIRTY_STATS);
+    rebuild_rename_combo(selected);
+    gtk_entry_set_text(GTK_ENTRY(rename_entry), "");
+}
+
+static void on_add_habit(GtkButton *button, gpointer user_data)
+{
+    (void)button;
+    (void)user_data;
+
+    gchar *trimmed = g_strstrip(g_strdup(gtk_entry_get_text(GTK_ENTRY(rename_entry))));
+    int habit = tracker_add_habit(&tracker, trimmed);
+    g_free(trimmed);
+    if (habit < 0)
+        return;
+
+    sync_habit_rows();
+    ipc_server_notify(ipc_server);
+    gtk_widget_queue_draw(habit_grid_area);
+    mark_ui_dirty(UI_DIRTY_CHECKS);
+    rebuild_rename_combo(habit);
+    gtk_entry_set_text(GTK_ENTRY(rename_entry), "");
+}
+
+static void on_clear_habit(GtkButton *button, gpointer user_data)
+{
+    (void)button;
+    (void)user_data;
+
+    int selected = gtk_combo_box_get_active(GTK_COMBO_BOX(rename_combo));
+    if (selected < 0 || selected >= tracker.habit_count)
+        return;
+
+    tracker_clear_habit(&tracker, selected);
+    ipc_server_notify(ipc_server);
+    gtk_widget_queue_draw_area(habit_grid_area, GRID_CELLS_X, GRID_CELLS_Y + selected * GRID_CELL_STRIDE,
+                               tracker.day_count * GRID_CELL_STRIDE, GRID_CELL_SIZE);
+
+    mark_ui_dirty(UI_DIRTY_CHECKS);
+}
+
+static void on_ipc_changed(gpointer user_data)
+{
+    (void)user_data;
+    gtk_widget_queue_draw(habit_grid_area);
+    mark_ui_dirty(UI_DIRTY_CHECKS);
+}
+
+static void on_external_change(const GArray *cells, guint flags, gpointer user_data)
+{
+    (void)user_data;
+    guint dirty = UI_DIRTY_CHECKS;
+
+    sync_habit_rows();
+    if (flags & TRACKER_CHANGED_LAYOUT) {
+        gchar *id = g_strdup_printf("%d", normalize_day_count(tracker.day_count));
+        gtk_combo_box_set_active_id(GTK_COMBO_BOX(day_count_combo), id);
+        g_free(id);
+        update_window_mode();
+        gtk_widget_queue_draw(habit_grid_area);
+        dirty = UI_DIRTY_ALL;
+    } else {
+        for (guint i = 0; i < cells->len; i++) {
+            const CellChange *cell = &g_array_index(cells, CellChange, i);
+            queue_grid_cell_draw(cell->habit, cell->day);
+        }
+    }
+    if ((flags & TRACKER_CHANGED_NAMES) && rename_combo)
+        rebuild_rename_combo(gtk_combo_box_get_active(GTK_COMBO_BOX(rename_combo)));
+    ipc_server_notify(ipc_server);
+    mark_ui_dirty(dirty);
+}
+
+static void start_ipc_server(IpcChangedFunc changed)
+{
+    gchar *path = ipc_default_socket_path();
+    if (path)
+        ipc_server = ipc_server_new(&tracker, path, changed, NULL);
+    g_free(path);
+}
+
+static void on_main_window_destroy(GtkWidget *widget, gpointer user_data)
+{
+    (void)widget;
+    (void)user_data;
+
+    ipc_server_free(ipc_server);
+    ipc_server = NULL;
+    tracker_watch_free(tracker_watch);
+    tracker_watch = NULL;
+    if (midnight_source)
+        g_source_remove(midnight_source);
+    midnight_source = 0;
+    if (insights_source)
+        g_source_remove(insights_source);
+    insights_source = 0;
+    heatmap_view_free(heatmap_view);
+    heatmap_view = NULL;
+    heatmap_snapshot_unref(heatmap_snapshot);
+    heatmap_snapshot = NULL;
+    tracker_stop_persistence(&tracker);
+    gtk_main_quit();
+}
+
+static void print_headless_usage(void)
+{
+    gchar *days = format_day_count_choices("|", "|");
+    g_printerr(
+        "usage: habit-tracker --headless COMMAND [ARGS]\n"
+        "\n"
+        "  stats                       print the statistics panel\n"
+        "  export [FILE|-] [FORMAT [BY]]\n"
+        "                              write an export (default %s); FORMAT is\n"
+        "                              text, csv, json or binary, BY is cell,\n"
+        "                              habit, day (default) or week\n"
+        "  import FILE                 merge dated check-ins from a CSV or JSON file\n"
+        "  set HABIT DAY[-DAY] on|off  check or uncheck days of the current cycle\n"
+        "  clear HABIT                 uncheck every day of a habit\n"
+        "  rename HABIT NAME           rename a habit\n"
+        "  add-habit NAME              add a habit with no check-ins\n"
+        "  days %-22s change the cycle length\n"
+        "  new-cycle                   archive this cycle and start a new one\n"
+        "  rolling on|off              keep the window ending today, moving it\n"
+        "                              forward every midnight\n"
+        "  range HABIT FROM TO         count check-ins between two YYYY-MM-DD dates\n"
+        "  batch                       run one command per line from stdin\n"
+        "  serve                       answer socket clients until interrupted\n"
+        "  report DIR [K] [THREADS]    roll up every tracker under DIR, listing the\n"
+        "                              K (default %d) most and least complete habits\n"
+        "\n"
+        "HABIT is a number from 1 to %d or a habit name.\n",
+        STATS_EXPORT_PATH, days, REPORT_DEFAULT_TOP, tracker.habit_count);
+    g_free(days);
+}
+
+static gboolean parse_habit_arg(const char *arg, int *habit)
+{
+    char *end = NULL;
+    long value = strtol(arg, &end, 10);
+    if (end != arg && *end == '\0' && value >= 1 && value <= tracker.habit_count) {
+        *habit = (int)value - 1;
+        return TRUE;
+    }
+
+    for (int i = 0; i < tracker.habit_count; i++) {
+        if (g_str_equal(tracker.names[i], arg)) {
+            *habit = i;
+            return TRUE;
+        }
+    }
+    g_printerr("unknown habit '%s'\n", arg);
+    return FALSE;
 }
 
-static void on_rename_habit(GtkButton *button, gpointer user_data)
+static gboolean parse_day_range_arg(const char *arg, int *first, int *last)
 {
-    (void)button;
-    (void)user_data;
-
-    int selected = gtk_combo_box_get_active(GTK_COMBO_BOX(rename_combo));
-    const gchar *new_name = gtk_entry_get_text(GTK_ENTRY(rename_entry));
+    char *end = NULL;
+    long start = strtol(arg, &end, 10);
+    long stop = start;
+
+    if (end != arg && *end == '-') {
+        const char *rest = end + 1;
+        stop = strtol(rest, &end, 10);
+        if (end == rest)
+            stop = -1;
+    }
+    if (end == arg || *end != '\0' || start < 1 || stop < start || stop > tracker.day_count) {
+        g_printerr("day '%s' is outside 1-%d\n", arg, tracker.day_count);
+        return FALSE;
+    }
 
-    if (selected < 0 || selected >= ITEM_COUNT)
-        return;
+    *first = (int)start - 1;
+    *last = (int)stop - 1;
+    return TRUE;
+}
 
-    if (!new_name)
-        return;
+static gboolean parse_date_arg(const char *arg, int *day_number)
+{
+    int year, month, day;
+    char extra;
 
-    gchar *trimmed = g_strstrip(g_strdup(new_name));
-    if (!trimmed || trimmed[0] == '\0') {
-        g_free(trimmed);
-        return;
+    if (sscanf(arg, "%d-%d-%d%c", &year, &month, &day, &extra) != 3 ||
+        year < 1 || year > 9999 || month < 1 || month > 12 || day < 1 || day > 31 ||
+        !g_date_valid_dmy((GDateDay)day, (GDateMonth)month, (GDateYear)year)) {
+        g_printerr("expected a YYYY-MM-DD date, got '%s'\n", arg);
+        return FALSE;
     }
 
-    g_strlcpy(item_names[selected], trimmed, NAME_LEN);
-    g_free(trimmed);
-
-    save_habit_names();
-
-    refresh_all_ui();
-    rebuild_rename_combo(selected);
-    gtk_entry_set_text(GTK_ENTRY(rename_entry), "");
+    GDate date;
+    g_date_clear(&date, 1);
+    g_date_set_dmy(&date, (GDateDay)day, (GDateMonth)month, (GDateYear)year);
+    *day_number = (int)g_date_get_julian(&date);
+    return TRUE;
 }
 
-static void on_clear_habit(GtkButton *button, gpointer user_data)
+static void on_serve_external_change(const GArray *cells, guint flags, gpointer user_data)
 {
-    (void)button;
+    (void)cells;
+    (void)flags;
     (void)user_data;
+    ipc_server_notify(ipc_server);
+}
 
-    int selected = gtk_combo_box_get_active(GTK_COMBO_BOX(rename_combo));
-    if (selected < 0 || selected >= ITEM_COUNT)
-        return;
+#ifdef G_OS_UNIX
+static gboolean on_serve_signal(gpointer user_data)
+{
+    g_main_loop_quit(user_data);
+    return G_SOURCE_CONTINUE;
+}
+#endif
 
-    for (int day = 0; day < MAX_DAY_COUNT; day++) {
-        int idx = selected * MAX_DAY_COUNT + day;
-        day_states[selected][day] = FALSE;
-        g_signal_handlers_block_by_func(check_buttons[idx], on_toggle, NULL);
-        gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(check_buttons[idx]), FALSE);
-        gtk_widget_queue_draw(check_buttons[idx]);
-        g_signal_handlers_unblock_by_func(check_buttons[idx], on_toggle, NULL);
-    }
+static gboolean serve_ipc(void)
+{
+    start_ipc_server(NULL);
+    if (!ipc_server)
+        return FALSE;
 
-    save_states();
-    refresh_all_ui();
+    tracker_watch = tracker_watch_new(&tracker, on_serve_external_change, NULL);
+    GMainLoop *loop = g_main_loop_new(NULL, FALSE);
+#ifdef G_OS_UNIX
+    g_unix_signal_add(SIGINT, on_serve_signal, loop);
+    g_unix_signal_add(SIGTERM, on_serve_signal, loop);
+#endif
+    schedule_midnight_rollover();
+    g_main_loop_run(loop);
+    g_main_loop_unref(loop);
+    g_source_remove(midnight_source);
+    midnight_source = 0;
+
+    tracker_watch_free(tracker_watch);
+    tracker_watch = NULL;
+    ipc_server_free(ipc_server);
+    ipc_server = NULL;
+    return TRUE;
 }
 
-int main(int argc, char *argv[])
+static gboolean run_headless_command(int argc, char **argv)
 {
-    gtk_init(&argc, &argv);
-    load_states();
-    load_habit_names();
-    load_settings();
-    apply_css();
+    const char *command = argv[0];
+    int habit, first, last;
+
+    if (g_str_equal(command, "stats") && argc == 1) {
+        gchar *summary = tracker_format_summary(&tracker);
+        gchar *weekly = tracker_format_weekly(&tracker);
+        printf("%d-Day Tracker\n%s\n\n%s\n", tracker.day_count, summary, weekly);
+        g_free(summary);
+        g_free(weekly);
+        return TRUE;
+    }
 
-    main_window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
-    gtk_window_set_default_size(GTK_WINDOW(main_window), 1400, 800);
-    g_signal_connect(main_window, "destroy", G_CALLBACK(gtk_main_quit), NULL);
-    g_signal_connect(main_window, "key-press-event", G_CALLBACK(on_window_key_press), NULL);
+    if (g_str_equal(command, "export") && argc <= 4) {
+        const char *path = (argc >= 2) ? argv[1] : STATS_EXPORT_PATH;
+        ExportFormat format = EXPORT_FORMAT_TEXT;
+        ExportGranularity granularity = EXPORT_BY_DAY;
+        if (argc >= 3 && !export_parse_format(argv[2], &format)) {
+            g_printerr("unknown export format '%s'\n", argv[2]);
+            return FALSE;
+        }
+        if (argc == 4 && !export_parse_granularity(argv[3], &granularity)) {
+            g_printerr("unknown export granularity '%s'\n", argv[3]);
+            return FALSE;
+        }
 
-    GtkWidget *page_scroll = gtk_scrolled_window_new(NULL, NULL);
-    gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(page_scroll),
-                                   GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
-    gtk_scrolled_window_set_shadow_type(GTK_SCROLLED_WINDOW(page_scroll), GTK_SHADOW_NONE);
-    gtk_container_add(GTK_CONTAINER(main_window), page_scroll);
+        ExportJob *job = export_job_new(&tracker, path, format, granularity);
+        gboolean ok = export_job_run(job);
+        export_job_free(job);
+        return ok;
+    }
 
-    GtkWidget *vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 15);
-    gtk_widget_set_name(vbox, "app-root");
-    gtk_container_set_border_width(GTK_CONTAINER(vbox), 20);
-    gtk_container_add(GTK_CONTAINER(page_scroll), vbox);
+    if (g_str_equal(command, "import") && argc == 2) {
+        ImportResult result;
+        if (!tracker_import(&tracker, argv[1], &result))
+            return FALSE;
+        gchar *details = format_import_result(&result);
+        printf("%s\n", details);
+        g_free(details);
+        return TRUE;
+    }
 
-    GtkWidget *header_frame = gtk_frame_new(NULL);
-    gtk_widget_set_name(header_frame, "header-card");
-    gtk_frame_set_shadow_type(GTK_FRAME(header_frame), GTK_SHADOW_NONE);
-    gtk_box_pack_start(GTK_BOX(vbox), header_frame, FALSE, FALSE, 0);
+    if (g_str_equal(command, "serve") && argc == 1)
+        return serve_ipc();
 
-    GtkWidget *header_hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 30);
-    gtk_container_set_border_width(GTK_CONTAINER(header_hbox), 14);
-    gtk_container_add(GTK_CONTAINER(header_frame), header_hbox);
+    if (g_str_equal(command, "set") && argc == 4) {
+        if (!parse_habit_arg(argv[1], &habit) || !parse_day_range_arg(argv[2], &first, &last))
+            return FALSE;
+        if (!g_str_equal(argv[3], "on") && !g_str_equal(argv[3], "off")) {
+            g_printerr("expected on or off, got '%s'\n", argv[3]);
+            return FALSE;
+        }
 
-    GtkWidget *title_vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 8);
-    title_label = gtk_label_new("");
-    gtk_widget_set_name(title_label, "title");
-    make_label_interactive(title_label);
-    gtk_widget_set_halign(title_label, GTK_ALIGN_START);
-    gtk_box_pack_start(GTK_BOX(title_vbox), title_label, FALSE, FALSE, 0);
+        tracker_set_range(&tracker, habit, habit, first, last, g_str_equal(argv[3], "on"), NULL);
+        return TRUE;
+    }
 
-    GtkWidget *subtitle = gtk_label_new("Discipline > Motivation");
-    gtk_widget_set_name(subtitle, "subtitle");
-    make_label_interactive(subtitle);
-    gtk_widget_set_halign(subtitle, GTK_ALIGN_START);
-    gtk_box_pack_start(GTK_BOX(title_vbox), subtitle, FALSE, FALSE, 0);
+    if (g_str_equal(command, "clear") && argc == 2) {
+        if (!parse_habit_arg(argv[1], &habit))
+            return FALSE;
+        tracker_clear_habit(&tracker, habit);
+        return TRUE;
+    }
 
-    GtkWidget *picker_row = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 8);
-    gtk_widget_set_halign(picker_row, GTK_ALIGN_START);
+    if (g_str_equal(command, "rename") && argc == 3) {
+        if (!parse_habit_arg(argv[1], &habit))
+            return FALSE;
 
-    GtkWidget *picker_label = gtk_label_new("Cycle Length:");
-    gtk_widget_set_name(picker_label, "picker-label");
-    make_label_interactive(picker_label);
-    gtk_widget_set_halign(picker_label, GTK_ALIGN_START);
-    gtk_box_pack_start(GTK_BOX(picker_row), picker_label, FALSE, FALSE, 0);
+        gchar *trimmed = g_strstrip(g_strdup(argv[2]));
+        gboolean ok = trimmed[0] != '\0';
+        if (ok)
+            tracker_rename_habit(&tracker, habit, trimmed);
+        else
+            g_printerr("habit names cannot be empty\n");
+        g_free(trimmed);
+        return ok;
+    }
 
-    day_count_combo = gtk_combo_box_text_new();
-    gtk_widget_set_name(day_count_combo, "cycle-combo");
-    gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(day_count_combo), "7", "7 Days");
-    gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(day_count_combo), "30", "30 Days");
-    gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(day_count_combo), "60", "60 Days");
-    gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(day_count_combo), "80", "80 Days");
-    gtk_combo_box_set_active_id(GTK_COMBO_BOX(day_count_combo),
-        (current_day_count == 7) ? "7" :
-        (current_day_count == 30) ? "30" :
-        (current_day_count == 80) ? "80" : "60");
-    g_signal_connect(day_count_combo, "changed", G_CALLBACK(on_day_count_changed), NULL);
-    gtk_widget_set_size_request(day_count_combo, 120, 34);
-    gtk_widget_set_tooltip_text(day_count_combo, "Pick tracker cycle length (7, 30, 60, 80 days)");
-    gtk_box_pack_start(GTK_BOX(picker_row), day_count_combo, FALSE, FALSE, 0);
+    if (g_str_equal(command, "add-habit") && argc == 2) {
+        gchar *trimmed = g_strstrip(g_strdup(argv[1]));
+        gboolean ok = trimmed[0] != '\0';
+        if (!ok) {
+            g_printerr("habit names cannot be empty\n");
+        } else if (tracker_add_habit(&tracker, trimmed) < 0) {
+            g_printerr("a tracker holds at most %d habits\n", MAX_HABIT_COUNT);
+            ok = FALSE;
+        }
+        g_free(trimmed);
+        return ok;
+    }
 
-    gtk_box_pack_start(GTK_BOX(title_vbox), picker_row, FALSE, FALSE, 0);
-    gtk_box_pack_start(GTK_BOX(header_hbox), title_vbox, TRUE, TRUE, 0);
+    if (g_str_equal(command, "days") && argc == 2) {
+        int day_count = atoi(argv[1]);
+        if (normalize_day_count(day_count) != day_count) {
+            gchar *choices = format_day_count_choices(", ", " or ");
+            g_printerr("cycle length must be %s\n", choices);
+            g_free(choices);
+            return FALSE;
+        }
+        tracker_set_day_count(&tracker, day_count);
+        return TRUE;
+    }
 
-    GtkWidget *stats_hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 20);
-    gtk_widget_set_halign(stats_hbox, GTK_ALIGN_END);
+    if (g_str_equal(command, "new-cycle") && argc == 1) {
+        if (tracker.history.rolling) {
+            g_printerr("the window is rolling; run 'rolling off' first\n");
+            return FALSE;
+        }
+        tracker_start_new_cycle(&tracker);
+        return TRUE;
+    }
 
-    GtkWidget *stat_chip = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
-    gtk_widget_set_name(stat_chip, "stat-chip");
-    gtk_widget_set_halign(stat_chip, GTK_ALIGN_END);
+    if (g_str_equal(command, "rolling") && argc == 2) {
+        if (!g_str_equal(argv[1], "on") && !g_str_equal(argv[1], "off")) {
+            g_printerr("expected on or off, got '%s'\n", argv[1]);
+            return FALSE;
+        }
+        tracker_set_rolling(&tracker, g_str_equal(argv[1], "on"));
+        return TRUE;
+    }
 
-    complete_label = gtk_label_new("0%");
-    gtk_widget_set_name(complete_label, "stat-value");
-    make_label_interactive(complete_label);
-    gtk_widget_set_halign(complete_label, GTK_ALIGN_END);
+    if (g_str_equal(command, "range") && argc == 4) {
+        int from, to;
+        if (!parse_habit_arg(argv[1], &habit) || !parse_date_arg(argv[2], &from) || !parse_date_arg(argv[3], &to))
+            return FALSE;
+        if (to < from) {
+            g_printerr("%s is before %s\n", argv[3], argv[2]);
+            return FALSE;
+        }
 
-    GtkWidget *complete_text = gtk_label_new("Complete");
-    gtk_widget_set_name(complete_text, "stat-caption");
-    make_label_interactive(complete_text);
-    gtk_widget_set_halign(complete_text, GTK_ALIGN_END);
+        int days = to - from + 1;
+        int checked = tracker_count_range(&tracker, habit, from, to + 1);
+        printf("%s: %d/%d (%d%%)\n", tracker.names[habit], checked, days, (checked * 100) / days);
+        return TRUE;
+    }
 
-    gtk_box_pack_start(GTK_BOX(stat_chip), complete_label, FALSE, FALSE, 0);
-    gtk_box_pack_start(GTK_BOX(stat_chip), complete_text, FALSE, FALSE, 0);
-    gtk_box_pack_end(GTK_BOX(stats_hbox), stat_chip, FALSE, FALSE, 0);
+    g_printerr("unknown command or wrong arguments: %s\n", command);
+    return FALSE;
+}
 
-    GtkWidget *reset_btn = gtk_button_new_with_label("Reset");
-    gtk_widget_set_name(reset_btn, "reset-btn");
-    gtk_widget_set_tooltip_text(reset_btn, "Reset all progress (Ctrl+Shift+R)");
-    g_signal_connect(reset_btn, "clicked", G_CALLBACK(on_reset), NULL);
-    gtk_box_pack_end(GTK_BOX(stats_hbox), reset_btn, FALSE, FALSE, 0);
+static gboolean run_headless_batch(void)
+{
+    gboolean ok = TRUE;
+    char line[1024];
+    int line_number = 0;
+
+    while (fgets(line, sizeof(line), stdin)) {
+        line_number++;
+        gchar *trimmed = g_strstrip(line);
+        if (trimmed[0] == '\0' || trimmed[0] == '#')
+            continue;
+
+        int command_argc;
+        gchar **command_argv = NULL;
+        GError *error = NULL;
+        if (!g_shell_parse_argv(trimmed, &command_argc, &command_argv, &error)) {
+            g_printerr("line %d: %s\n", line_number, error->message);
+            g_error_free(error);
+            ok = FALSE;
+            continue;
+        }
 
-    gtk_box_pack_start(GTK_BOX(header_hbox), stats_hbox, FALSE, FALSE, 0);
+        if (g_str_equal(command_argv[0], "batch") || !run_headless_command(command_argc, command_argv)) {
+            g_printerr("line %d: '%s' failed\n", line_number, trimmed);
+            ok = FALSE;
+        }
+        g_strfreev(command_argv);
+    }
+    return ok;
+}
 
-    GtkWidget *tracker_frame = gtk_frame_new(NULL);
-    gtk_widget_set_name(tracker_frame, "tracker-card");
-    gtk_frame_set_shadow_type(GTK_FRAME(tracker_frame), GTK_SHADOW_NONE);
-    gtk_box_pack_start(GTK_BOX(vbox), tracker_frame, FALSE, FALSE, 0);
+/* New data starts with ITEM_COUNT habits and MAX_DAY_COUNT days; tracker_load
+ * grows the tracker to whatever a saved file holds. */
+static gboolean open_tracker(void)
+{
+    tracker_init(&tracker, ".", ITEM_COUNT, MAX_DAY_COUNT);
+    gboolean needs_snapshot = tracker_load(&tracker);
+    tracker_set_day_count(&tracker, normalize_day_count(tracker.day_count));
+    sync_habit_rows();
+    return needs_snapshot;
+}
 
-    GtkWidget *scrollwin = gtk_scrolled_window_new(NULL, NULL);
-    gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scrollwin),
-                                   GTK_POLICY_AUTOMATIC, GTK_POLICY_NEVER);
-    gtk_scrolled_window_set_shadow_type(GTK_SCROLLED_WINDOW(scrollwin), GTK_SHADOW_NONE);
-    gtk_container_set_border_width(GTK_CONTAINER(scrollwin), 8);
-    gtk_container_add(GTK_CONTAINER(tracker_frame), scrollwin);
-
-    grid = gtk_grid_new();
-    gtk_grid_set_row_spacing(GTK_GRID(grid), 4);
-    gtk_grid_set_column_spacing(GTK_GRID(grid), 4);
-    gtk_container_set_border_width(GTK_CONTAINER(grid), 8);
-
-    GtkWidget *hash_label = gtk_label_new("#");
-    gtk_widget_set_name(hash_label, "day-header");
-    gtk_widget_set_size_request(hash_label, 30, -1);
-    gtk_grid_attach(GTK_GRID(grid), hash_label, 0, 0, 1, 1);
-
-    GtkWidget *habits_label = gtk_label_new("Habits");
-    gtk_widget_set_name(habits_label, "day-header");
-    make_label_interactive(habits_label);
-    gtk_widget_set_size_request(habits_label, 200, -1);
-    gtk_widget_set_halign(habits_label, GTK_ALIGN_START);
-    gtk_grid_attach(GTK_GRID(grid), habits_label, 1, 0, 1, 1);
-
-    for (int d = 0; d < MAX_DAY_COUNT; d++) {
-        GtkWidget *day_label = gtk_label_new("");
-        gtk_widget_set_name(day_label, "day-header");
-        gchar *day_text = g_strdup_printf("%d", d + 1);
-        gtk_label_set_text(GTK_LABEL(day_label), day_text);
-        g_free(day_text);
-        gtk_widget_set_size_request(day_label, 25, -1);
-        gtk_grid_attach(GTK_GRID(grid), day_label, d + 2, 0, 1, 1);
-        day_header_labels[d] = day_label;
+static int run_headless_report(int argc, char **argv)
+{
+    int k = (argc >= 3) ? atoi(argv[2]) : REPORT_DEFAULT_TOP;
+    int threads = (argc == 4) ? atoi(argv[3]) : 0;
+    if (argc < 2 || argc > 4 || k < 0 || threads < 0) {
+        print_headless_usage();
+        return 2;
     }
 
-    check_buttons = g_malloc(ITEM_COUNT * MAX_DAY_COUNT * sizeof(GtkWidget *));
-
-    for (int i = 0; i < ITEM_COUNT; i++) {
-        GtkWidget *row_num_label = gtk_label_new("");
-        gtk_widget_set_name(row_num_label, "grid-label");
-        gchar *row_text = g_strdup_printf("%d", i + 1);
-        gtk_label_set_text(GTK_LABEL(row_num_label), row_text);
-        g_free(row_text);
-        gtk_widget_set_size_request(row_num_label, 30, -1);
-        gtk_grid_attach(GTK_GRID(grid), row_num_label, 0, i + 1, 1, 1);
-
-        GtkWidget *habit_name = gtk_label_new("");
-        gtk_widget_set_name(habit_name, "habit-name");
-        make_label_interactive(habit_name);
-        gtk_widget_set_size_request(habit_name, 200, -1);
-        gtk_widget_set_halign(habit_name, GTK_ALIGN_START);
-        gtk_grid_attach(GTK_GRID(grid), habit_name, 1, i + 1, 1, 1);
-        habit_name_labels[i] = habit_name;
-
-        for (int d = 0; d < MAX_DAY_COUNT; d++) {
-            GtkWidget *check = gtk_check_button_new();
-            GtkStyleContext *check_ctx = gtk_widget_get_style_context(check);
-            gtk_style_context_add_class(check_ctx, "habit-cell");
-            gtk_widget_set_size_request(check, 25, 25);
-
-            if (day_states[i][d])
-                gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(check), TRUE);
-
-            int idx = i * MAX_DAY_COUNT + d;
-            check_buttons[idx] = check;
-            gtk_grid_attach(GTK_GRID(grid), check, d + 2, i + 1, 1, 1);
-            g_signal_connect(check, "toggled", G_CALLBACK(on_toggle), GINT_TO_POINTER(idx));
-        }
+    TrackerReport report;
+    gint64 span = trace_begin();
+    gboolean ok = tracker_report_run(&report, argv[1], k, threads);
+    trace_end("headless_command", span);
+    if (ok) {
+        gchar *text = tracker_report_format(&report);
+        fputs(text, stdout);
+        g_free(text);
+    }
+    tracker_report_free(&report);
+    trace_shutdown();
+    return ok ? 0 : 1;
+}
+
+static int run_headless(int argc, char **argv)
+{
+    if (argc < 1) {
+        print_headless_usage();
+        return 2;
     }
+    if (g_str_equal(argv[0], "report"))
+        return run_headless_report(argc, argv);
+
+    gboolean needs_snapshot = open_tracker();
+
+    gboolean read_only = g_str_equal(argv[0], "stats") || g_str_equal(argv[0], "export") ||
+                         g_str_equal(argv[0], "range");
+    if (!read_only)
+        tracker_start_persistence(&tracker, needs_snapshot);
+    tracker_roll_to_today(&tracker);
+
+    gint64 span = trace_begin();
+    gboolean ok = (g_str_equal(argv[0], "batch") && argc == 1)
+        ? run_headless_batch()
+        : run_headless_command(argc, argv);
+    trace_end("headless_command", span);
+
+    tracker_free(&tracker);
+    g_free(habit_row_text);
+    trace_shutdown();
+    return ok ? 0 : 1;
+}
 
-    gtk_container_add(GTK_CONTAINER(scrollwin), grid);
+/* Second startup stage: the statistics, graph and action rows sit below the
+ * grid, so they are built from an idle callback once the first frame is on
+ * screen. */
+static gboolean build_insights_card(gpointer user_data)
+{
+    GtkWidget *vbox = user_data;
+    gint64 span = trace_begin();
 
     GtkWidget *graph = gtk_frame_new(NULL);
     gtk_widget_set_name(graph, "graph-card");
@@ -1289,8 +2477,35 @@ int main(int argc, char *argv[])
     g_signal_connect(progress_graph_area, "draw", G_CALLBACK(on_draw_progress_graph), NULL);
     g_signal_connect(progress_graph_area, "motion-notify-event", G_CALLBACK(on_progress_graph_motion), NULL);
     g_signal_connect(progress_graph_area, "leave-notify-event", G_CALLBACK(on_progress_graph_leave), NULL);
+    g_signal_connect(progress_graph_area, "style-updated", G_CALLBACK(on_progress_graph_style_updated), NULL);
+    g_signal_connect(progress_graph_area, "notify::scale-factor", G_CALLBACK(on_progress_graph_scale_changed), NULL);
     gtk_box_pack_start(GTK_BOX(graph_box), progress_graph_area, FALSE, FALSE, 0);
 
+    GtkWidget *sep_heatmap = gtk_separator_new(GTK_ORIENTATION_HORIZONTAL);
+    gtk_box_pack_start(GTK_BOX(graph_box), sep_heatmap, FALSE, FALSE, 0);
+
+    GtkWidget *heatmap_title = gtk_label_new("History");
+    gtk_widget_set_name(heatmap_title, "section-title");
+    make_label_interactive(heatmap_title);
+    gtk_widget_set_halign(heatmap_title, GTK_ALIGN_START);
+    gtk_box_pack_start(GTK_BOX(graph_box), heatmap_title, FALSE, FALSE, 0);
+
+    heatmap_view = heatmap_view_new(CLAMP((int)g_get_num_processors(), 1, HEATMAP_MAX_THREADS),
+                                    HEATMAP_EMPTY_COLOR, HEATMAP_FULL_COLOR, on_heatmap_ready, NULL);
+    heatmap_area = gtk_drawing_area_new();
+    gtk_widget_set_size_request(heatmap_area, -1, HEATMAP_HEIGHT);
+    gtk_widget_set_hexpand(heatmap_area, TRUE);
+    gtk_widget_set_has_tooltip(heatmap_area, TRUE);
+    gtk_widget_add_events(heatmap_area, GDK_SCROLL_MASK | GDK_SMOOTH_SCROLL_MASK | GDK_BUTTON_PRESS_MASK |
+                                            GDK_BUTTON_RELEASE_MASK | GDK_BUTTON1_MOTION_MASK);
+    g_signal_connect(heatmap_area, "draw", G_CALLBACK(on_draw_heatmap), NULL);
+    g_signal_connect(heatmap_area, "scroll-event", G_CALLBACK(on_heatmap_scroll), NULL);
+    g_signal_connect(heatmap_area, "button-press-event", G_CALLBACK(on_heatmap_button_press), NULL);
+    g_signal_connect(heatmap_area, "button-release-event", G_CALLBACK(on_heatmap_button_release), NULL);
+    g_signal_connect(heatmap_area, "motion-notify-event", G_CALLBACK(on_heatmap_motion), NULL);
+    g_signal_connect(heatmap_area, "query-tooltip", G_CALLBACK(on_heatmap_query_tooltip), NULL);
+    gtk_box_pack_start(GTK_BOX(graph_box), heatmap_area, FALSE, FALSE, 0);
+
     GtkWidget *sep_bottom = gtk_separator_new(GTK_ORIENTATION_HORIZONTAL);
     gtk_box_pack_start(GTK_BOX(graph_box), sep_bottom, FALSE, FALSE, 0);
 
@@ -1380,6 +2595,12 @@ int main(int argc, char *argv[])
     g_signal_connect(rename_btn, "clicked", G_CALLBACK(on_rename_habit), NULL);
     gtk_container_add(GTK_CONTAINER(controls_buttons_flow), rename_btn);
 
+    GtkWidget *add_btn = gtk_button_new_with_label("Add Habit");
+    gtk_widget_set_name(add_btn, "action-btn");
+    gtk_widget_set_tooltip_text(add_btn, "Add a habit named after the text box");
+    g_signal_connect(add_btn, "clicked", G_CALLBACK(on_add_habit), NULL);
+    gtk_container_add(GTK_CONTAINER(controls_buttons_flow), add_btn);
+
     GtkWidget *clear_btn = gtk_button_new_with_label("Clear Habit");
     gtk_widget_set_name(clear_btn, "action-btn");
     gtk_widget_set_tooltip_text(clear_btn, "Clear all checked days for selected habit");
@@ -1392,13 +2613,200 @@ int main(int argc, char *argv[])
     g_signal_connect(export_btn, "clicked", G_CALLBACK(on_export_stats), NULL);
     gtk_container_add(GTK_CONTAINER(controls_buttons_flow), export_btn);
 
+    GtkWidget *import_btn = gtk_button_new_with_label("Import Check-ins");
+    gtk_widget_set_name(import_btn, "action-btn");
+    gtk_widget_set_tooltip_text(import_btn, "Merge dated check-ins from a CSV or JSON file");
+    g_signal_connect(import_btn, "clicked", G_CALLBACK(on_import_history), NULL);
+    gtk_container_add(GTK_CONTAINER(controls_buttons_flow), import_btn);
+
     gtk_box_pack_start(GTK_BOX(vbox), graph, TRUE, TRUE, 0);
 
     rebuild_rename_combo(0);
-    refresh_all_ui();
+    gtk_widget_show_all(graph);
+    ui_dirty |= UI_DIRTY_DAY_ACTION | UI_DIRTY_STATS | UI_DIRTY_GRAPH;
+    flush_ui_refresh();
+    insights_source = 0;
+    trace_end("build_insights", span);
+    trace_end("startup_to_interactive", interactive_span);
+    g_debug("time to interactive: %.1f ms", (g_get_monotonic_time() - startup_time) / 1000.0);
+    return G_SOURCE_REMOVE;
+}
+
+int main(int argc, char *argv[])
+{
+    trace_init();
+    if (argc > 1 && g_str_equal(argv[1], "--headless"))
+        return run_headless(argc - 2, argv + 2);
+
+    startup_time = g_get_monotonic_time();
+    startup_span = trace_begin();
+    interactive_span = startup_span;
+    gint64 span = trace_begin();
+    gtk_init(&argc, &argv);
+    trace_end("gtk_init", span);
+
+    span = trace_begin();
+    tracker_start_persistence(&tracker, open_tracker());
+    tracker_roll_to_today(&tracker);
+    trace_end("open_tracker", span);
+
+    span = trace_begin();
+    apply_css();
+    trace_end("apply_css", span);
+
+    span = trace_begin();
+    main_window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+    gtk_window_set_default_size(GTK_WINDOW(main_window), 1400, 800);
+    g_signal_connect(main_window, "destroy", G_CALLBACK(on_main_window_destroy), NULL);
+    g_signal_connect(main_window, "key-press-event", G_CALLBACK(on_window_key_press), NULL);
+
+    page_scroll = gtk_scrolled_window_new(NULL, NULL);
+    gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(page_scroll),
+                                   GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+    gtk_scrolled_window_set_shadow_type(GTK_SCROLLED_WINDOW(page_scroll), GTK_SHADOW_NONE);
+    gtk_container_add(GTK_CONTAINER(main_window), page_scroll);
+
+    GtkWidget *vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 15);
+    gtk_widget_set_name(vbox, "app-root");
+    gtk_container_set_border_width(GTK_CONTAINER(vbox), 20);
+    gtk_container_add(GTK_CONTAINER(page_scroll), vbox);
+    page_content = vbox;
+
+    GtkWidget *header_frame = gtk_frame_new(NULL);
+    gtk_widget_set_name(header_frame, "header-card");
+    gtk_frame_set_shadow_type(GTK_FRAME(header_frame), GTK_SHADOW_NONE);
+    gtk_box_pack_start(GTK_BOX(vbox), header_frame, FALSE, FALSE, 0);
+
+    GtkWidget *header_hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 30);
+    gtk_container_set_border_width(GTK_CONTAINER(header_hbox), 14);
+    gtk_container_add(GTK_CONTAINER(header_frame), header_hbox);
+
+    GtkWidget *title_vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 8);
+    title_label = gtk_label_new("");
+    gtk_widget_set_name(title_label, "title");
+    make_label_interactive(title_label);
+    gtk_widget_set_halign(title_label, GTK_ALIGN_START);
+    gtk_box_pack_start(GTK_BOX(title_vbox), title_label, FALSE, FALSE, 0);
+
+    GtkWidget *subtitle = gtk_label_new("Discipline > Motivation");
+    gtk_widget_set_name(subtitle, "subtitle");
+    make_label_interactive(subtitle);
+    gtk_widget_set_halign(subtitle, GTK_ALIGN_START);
+    gtk_box_pack_start(GTK_BOX(title_vbox), subtitle, FALSE, FALSE, 0);
+
+    GtkWidget *picker_row = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 8);
+    gtk_widget_set_halign(picker_row, GTK_ALIGN_START);
+
+    GtkWidget *picker_label = gtk_label_new("Cycle Length:");
+    gtk_widget_set_name(picker_label, "picker-label");
+    make_label_interactive(picker_label);
+    gtk_widget_set_halign(picker_label, GTK_ALIGN_START);
+    gtk_box_pack_start(GTK_BOX(picker_row), picker_label, FALSE, FALSE, 0);
+
+    day_count_combo = gtk_combo_box_text_new();
+    gtk_widget_set_name(day_count_combo, "cycle-combo");
+    for (guint i = 0; i < G_N_ELEMENTS(day_count_options); i++)
+        append_day_count_option(day_count_options[i]);
+    if (tracker.day_capacity > MAX_DAY_COUNT)
+        append_day_count_option(tracker.day_capacity);
+    gchar *active_id = g_strdup_printf("%d", tracker.day_count);
+    gtk_combo_box_set_active_id(GTK_COMBO_BOX(day_count_combo), active_id);
+    g_free(active_id);
+    g_signal_connect(day_count_combo, "changed", G_CALLBACK(on_day_count_changed), NULL);
+    gtk_widget_set_size_request(day_count_combo, 120, 34);
+    gtk_widget_set_tooltip_text(day_count_combo, "Pick tracker cycle length");
+    gtk_box_pack_start(GTK_BOX(picker_row), day_count_combo, FALSE, FALSE, 0);
+
+    rolling_check = gtk_check_button_new_with_label("Rolling");
+    gtk_widget_set_name(rolling_check, "picker-label");
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(rolling_check), tracker.history.rolling);
+    g_signal_connect(rolling_check, "toggled", G_CALLBACK(on_rolling_toggled), NULL);
+    gtk_widget_set_tooltip_text(rolling_check, "Keep the window ending today, moving it forward every midnight");
+    gtk_box_pack_start(GTK_BOX(picker_row), rolling_check, FALSE, FALSE, 0);
+
+    gtk_box_pack_start(GTK_BOX(title_vbox), picker_row, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(header_hbox), title_vbox, TRUE, TRUE, 0);
+
+    GtkWidget *stats_hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 20);
+    gtk_widget_set_halign(stats_hbox, GTK_ALIGN_END);
+
+    GtkWidget *stat_chip = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
+    gtk_widget_set_name(stat_chip, "stat-chip");
+    gtk_widget_set_halign(stat_chip, GTK_ALIGN_END);
+
+    complete_label = gtk_label_new("0%");
+    gtk_widget_set_name(complete_label, "stat-value");
+    make_label_interactive(complete_label);
+    gtk_widget_set_halign(complete_label, GTK_ALIGN_END);
+
+    GtkWidget *complete_text = gtk_label_new("Complete");
+    gtk_widget_set_name(complete_text, "stat-caption");
+    make_label_interactive(complete_text);
+    gtk_widget_set_halign(complete_text, GTK_ALIGN_END);
+
+    gtk_box_pack_start(GTK_BOX(stat_chip), complete_label, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(stat_chip), complete_text, FALSE, FALSE, 0);
+    gtk_box_pack_end(GTK_BOX(stats_hbox), stat_chip, FALSE, FALSE, 0);
+
+    reset_button = gtk_button_new_with_label("New Cycle");
+    gtk_widget_set_name(reset_button, "reset-btn");
+    gtk_widget_set_tooltip_text(reset_button, "Archive this cycle and start a new one (Ctrl+Shift+R)");
+    gtk_widget_set_sensitive(reset_button, !tracker.history.rolling);
+    g_signal_connect(reset_button, "clicked", G_CALLBACK(on_reset), NULL);
+    gtk_box_pack_end(GTK_BOX(stats_hbox), reset_button, FALSE, FALSE, 0);
+
+    gtk_box_pack_start(GTK_BOX(header_hbox), stats_hbox, FALSE, FALSE, 0);
+
+    GtkWidget *tracker_frame = gtk_frame_new(NULL);
+    gtk_widget_set_name(tracker_frame, "tracker-card");
+    gtk_frame_set_shadow_type(GTK_FRAME(tracker_frame), GTK_SHADOW_NONE);
+    gtk_box_pack_start(GTK_BOX(vbox), tracker_frame, FALSE, FALSE, 0);
+
+    grid_scroll = gtk_scrolled_window_new(NULL, NULL);
+    gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(grid_scroll),
+                                   GTK_POLICY_AUTOMATIC, GTK_POLICY_NEVER);
+    gtk_scrolled_window_set_shadow_type(GTK_SCROLLED_WINDOW(grid_scroll), GTK_SHADOW_NONE);
+    gtk_container_set_border_width(GTK_CONTAINER(grid_scroll), 8);
+    gtk_container_add(GTK_CONTAINER(tracker_frame), grid_scroll);
+
+    habit_grid_area = gtk_drawing_area_new();
+    gtk_widget_set_name(habit_grid_area, "habit-grid");
+    gtk_widget_set_can_focus(habit_grid_area, TRUE);
+    gtk_widget_add_events(habit_grid_area,
+        GDK_BUTTON_PRESS_MASK | GDK_BUTTON_RELEASE_MASK | GDK_POINTER_MOTION_MASK | GDK_LEAVE_NOTIFY_MASK |
+        GDK_KEY_PRESS_MASK | GDK_FOCUS_CHANGE_MASK);
+    g_signal_connect(habit_grid_area, "draw", G_CALLBACK(on_draw_habit_grid), NULL);
+    g_signal_connect(habit_grid_area, "button-press-event", G_CALLBACK(on_habit_grid_button_press), NULL);
+    g_signal_connect(habit_grid_area, "button-release-event", G_CALLBACK(on_habit_grid_button_release), NULL);
+    g_signal_connect(habit_grid_area, "motion-notify-event", G_CALLBACK(on_habit_grid_motion), NULL);
+    g_signal_connect(habit_grid_area, "leave-notify-event", G_CALLBACK(on_habit_grid_leave), NULL);
+    gtk_widget_set_has_tooltip(habit_grid_area, TRUE);
+    g_signal_connect(habit_grid_area, "query-tooltip", G_CALLBACK(on_habit_grid_query_tooltip), NULL);
+    g_signal_connect(habit_grid_area, "key-press-event", G_CALLBACK(on_habit_grid_key_press), NULL);
+    g_signal_connect(habit_grid_area, "focus-in-event", G_CALLBACK(on_habit_grid_focus_change), NULL);
+    g_signal_connect(habit_grid_area, "focus-out-event", G_CALLBACK(on_habit_grid_focus_change), NULL);
+    update_grid_size();
+    gtk_container_add(GTK_CONTAINER(grid_scroll), habit_grid_area);
+
+    ui_dirty = UI_DIRTY_ALL;
+    flush_ui_refresh();
+    trace_end("build_window", span);
+
+    span = trace_begin();
     gtk_widget_show_all(main_window);
+    trace_end("show_all", span);
+    insights_source = g_idle_add(build_insights_card, vbox);
+    start_ipc_server(on_ipc_changed);
+    tracker_watch = tracker_watch_new(&tracker, on_external_change, NULL);
+    schedule_midnight_rollover();
     gtk_main();
 
-    g_free(check_buttons);
+    if (export_job)
+        export_job_free(export_job);
+    if (import_job)
+        import_job_free(import_job);
+    tracker_free(&tracker);
+    g_free(habit_row_text);
+    trace_shutdown();
     return 0;
 }
@@ -0,0 +1,421 @@
+#include "../core/habit_core.h"
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_MIN_MS 200
+#define ENGINE_BENCH_PROFILES 32
+#define ENGINE_BENCH_HOT 8
+#define HEATMAP_BENCH_ZOOM 2
+
+typedef struct {
+    HabitTracker tracker;
+    char *dir;
+    char *journal_path;
+    char *names_path;
+    char *export_path;
+    char *engine_root;
+    TrackerEngine *engine;
+    HeatmapSnapshot *heatmap;
+    guint32 *heatmap_pixels;
+    const DayCountsKernel *kernel;
+    int *day_counts;
+    int habits;
+    int days;
+} BenchCase;
+
+typedef void (*BenchFn)(BenchCase *bench);
+
+typedef struct {
+    const char *name;
+    BenchFn fn;
+} Benchmark;
+
+static volatile double bench_sink;
+
+static void bench_count_checked(BenchCase *bench)
+{
+    bench_sink += tracker_count_checked(&bench->tracker);
+}
+
+static void bench_count_checked_for_habit(BenchCase *bench)
+{
+    int sum = 0;
+    for (int i = 0; i < bench->habits; i++)
+        sum += tracker_count_checked_for_habit(&bench->tracker, i);
+    bench_sink += sum;
+}
+
+static void bench_count_checked_in_week(BenchCase *bench)
+{
+    int sum = 0;
+    int week_count = tracker_week_count(&bench->tracker);
+    for (int w = 0; w < week_count; w++)
+        sum += tracker_count_checked_in_week(&bench->tracker, w);
+    bench_sink += sum;
+}
+
+static void bench_day_completion_percent(BenchCase *bench)
+{
+    double sum = 0.0;
+    for (int d = 0; d < bench->days; d++)
+        sum += tracker_day_completion_percent(&bench->tracker, d);
+    bench_sink += sum;
+}
+
+static void bench_running_average_percent(BenchCase *bench)
+{
+    double sum = 0.0;
+    for (int d = 0; d < bench->days; d++)
+        sum += tracker_running_average_percent(&bench->tracker, d);
+    bench_sink += sum;
+}
+
+static void bench_format_summary(BenchCase *bench)
+{
+    gchar *text = tracker_format_summary(&bench->tracker);
+    bench_sink += text[0];
+    g_free(text);
+}
+
+static void bench_format_weekly(BenchCase *bench)
+{
+    gchar *text = tracker_format_weekly(&bench->tracker);
+    bench_sink += text[0];
+    g_free(text);
+}
+
+static void bench_stats_rebuild(BenchCase *bench)
+{
+    habit_stats_rebuild(&bench->tracker.stats, &bench->tracker.store, bench->days);
+}
+
+static void bench_day_counts(BenchCase *bench)
+{
+    const HabitStore *store = &bench->tracker.store;
+    bench->kernel->fn(store->words, store->habit_count, store->words_per_habit, bench->day_counts, bench->days);
+    bench_sink += bench->day_counts[0];
+}
+
+static void bench_set_cell(BenchCase *bench)
+{
+    static guint32 seed = 1;
+    seed = seed * 1103515245u + 12345u;
+    int habit = (int)((seed >> 8) % (guint32)bench->habits);
+    int day = (int)((seed >> 16) % (guint32)bench->days);
+    tracker_set_cell(&bench->tracker, habit, day, !tracker_get_cell(&bench->tracker, habit, day));
+}
+
+static void bench_set_range(BenchCase *bench)
+{
+    static gboolean value;
+    value = !value;
+    tracker_set_range(&bench->tracker, 0, bench->habits - 1, 0, bench->days - 1, value, NULL);
+}
+
+static void bench_save_names(BenchCase *bench)
+{
+    write_atomic_binary(bench->names_path, bench->tracker.names, NAME_LEN, (size_t)bench->habits);
+}
+
+static void bench_save_tracker(BenchCase *bench)
+{
+    tracker_file_write(bench->tracker.tracker_path, &bench->tracker.history,
+                       (const char *)bench->tracker.names, bench->tracker.day_count);
+}
+
+static void bench_load_tracker(BenchCase *bench)
+{
+    HabitTracker loaded;
+    tracker_init(&loaded, bench->dir, bench->habits, bench->days);
+    tracker_load(&loaded);
+    bench_sink += tracker_count_checked(&loaded);
+    tracker_free(&loaded);
+}
+
+static void bench_replay_journal(BenchCase *bench)
+{
+    HistoryStore hist;
+    history_store_init(&hist, bench->habits, bench->days, bench->tracker.history.cycle_start);
+    replay_journal(bench->journal_path, &hist);
+    bench_sink += history_count_range(&hist, 0, hist.cycle_start, hist.cycle_start + bench->days);
+    history_store_free(&hist);
+}
+
+static void bench_export_csv_cells(BenchCase *bench)
+{
+    ExportJob *job = export_job_new(&bench->tracker, bench->export_path, EXPORT_FORMAT_CSV, EXPORT_BY_CELL);
+    export_job_run(job);
+    export_job_free(job);
+}
+
+static void bench_import_csv_cells(BenchCase *bench)
+{
+    ImportResult result;
+    tracker_import(&bench->tracker, bench->export_path, &result);
+    bench_sink += (double)result.rows;
+}
+
+static void bench_engine_acquire(BenchCase *bench)
+{
+    static guint32 seed = 7;
+    seed = seed * 1103515245u + 12345u;
+    gchar id[16];
+    g_snprintf(id, sizeof(id), "p%u", (seed >> 8) % ENGINE_BENCH_PROFILES);
+
+    HabitTracker *tracker = tracker_engine_acquire(bench->engine, id);
+    int habit = (int)((seed >> 16) % (guint32)bench->habits);
+    tracker_set_cell(tracker, habit, 0, !tracker_get_cell(tracker, habit, 0));
+    tracker_engine_release(bench->engine, tracker);
+}
+
+static void bench_report_profiles(BenchCase *bench)
+{
+    TrackerReport report;
+    tracker_report_run(&report, bench->engine_root, 5, 0);
+    bench_sink += (double)report.checked;
+    tracker_report_free(&report);
+}
+
+static void bench_heatmap_tiles(BenchCase *bench)
+{
+    int width, height;
+    heatmap_snapshot_extent(bench->heatmap, HEATMAP_BENCH_ZOOM, &width, &height);
+    for (int ty = 0; ty * HEATMAP_TILE_SIZE < height; ty++) {
+        for (int tx = 0; tx * HEATMAP_TILE_SIZE < width; tx++)
+            heatmap_render_tile(bench->heatmap, HEATMAP_BENCH_ZOOM, tx, ty, 0x000000, 0xffffff, bench->heatmap_pixels);
+    }
+    bench_sink += bench->heatmap_pixels[0];
+}
+
+static const Benchmark benchmarks[] = {
+    { "count_checked", bench_count_checked },
+    { "count_checked_for_habit", bench_count_checked_for_habit },
+    { "count_checked_in_week", bench_count_checked_in_week },
+    { "day_completion_percent", bench_day_completion_percent },
+    { "running_average_percent", bench_running_average_percent },
+    { "format_summary", bench_format_summary },
+    { "format_weekly", bench_format_weekly },
+    { "stats_rebuild", bench_stats_rebuild },
+    { "set_cell", bench_set_cell },
+    { "set_range", bench_set_range },
+    { "save_names", bench_save_names },
+    { "save_tracker", bench_save_tracker },
+    { "load_tracker", bench_load_tracker },
+    { "replay_journal", bench_replay_journal },
+    { "export_csv_cells", bench_export_csv_cells },
+    { "import_csv_cells", bench_import_csv_cells },
+    { "engine_acquire", bench_engine_acquire },
+    { "report_profiles", bench_report_profiles },
+    { "heatmap_tiles", bench_heatmap_tiles },
+};
+
+static const int habit_sweep[] = { 1, 10, 100, 1000 };
+static const int day_sweep[] = { 7, 30, 60, 80, 365 };
+
+static void write_journal(const char *path, int habits, int days)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        g_error("could not create %s", path);
+
+    fwrite(JOURNAL_MAGIC, 1, JOURNAL_HEADER_SIZE, f);
+    guint8 record[JOURNAL_RECORD_SIZE];
+    for (int i = 0; i < habits; i++) {
+        for (int d = 0; d < days; d++) {
+            journal_encode(record, JOURNAL_SET_CELL, i, d, (i + d) % 3 != 0);
+            fwrite(record, 1, JOURNAL_RECORD_SIZE, f);
+        }
+    }
+    fclose(f);
+}
+
+static void check_day_counts(BenchCase *bench)
+{
+    const HabitStore *store = &bench->tracker.store;
+    const DayCountsKernel *kernels;
+    int kernel_count = day_counts_kernels(&kernels);
+    int *expected = g_new(int, bench->days);
+
+    kernels[0].fn(store->words, store->habit_count, store->words_per_habit, expected, bench->days);
+    for (int k = 1; k < kernel_count; k++) {
+        kernels[k].fn(store->words, store->habit_count, store->words_per_habit, bench->day_counts, bench->days);
+        if (memcmp(expected, bench->day_counts, (size_t)bench->days * sizeof(int)) != 0)
+            g_error("day_counts %s differs from %s for %d habits x %d days",
+                    kernels[k].name, kernels[0].name, bench->habits, bench->days);
+    }
+    g_free(expected);
+}
+
+static void bench_case_init(BenchCase *bench, const char *root, int habits, int days)
+{
+    bench->habits = habits;
+    bench->days = days;
+    gchar *leaf = g_strdup_printf("h%d-d%d", habits, days);
+    bench->dir = g_build_filename(root, leaf, NULL);
+    g_free(leaf);
+    g_mkdir_with_parents(bench->dir, 0700);
+    bench->journal_path = g_build_filename(bench->dir, "bench.journal", NULL);
+    bench->names_path = g_build_filename(bench->dir, "names.dat", NULL);
+    bench->export_path = g_build_filename(bench->dir, "export.csv", NULL);
+
+    tracker_init(&bench->tracker, bench->dir, habits, days);
+    tracker_set_day_count(&bench->tracker, days);
+    for (int i = 0; i < habits; i++) {
+        for (int d = 0; d < days; d++) {
+            if ((i * 7 + d * 3) % 5 < 3)
+                tracker_set_cell(&bench->tracker, i, d, TRUE);
+        }
+    }
+
+    tracker_file_write(bench->tracker.tracker_path, &bench->tracker.history,
+                       (const char *)bench->tracker.names, bench->tracker.day_count);
+    write_journal(bench->journal_path, habits, days);
+    bench_export_csv_cells(bench);
+    bench->day_counts = g_new(int, days);
+    check_day_counts(bench);
+    bench->heatmap = heatmap_snapshot_new(&bench->tracker);
+    bench->heatmap_pixels = g_new(guint32, HEATMAP_TILE_SIZE * HEATMAP_TILE_SIZE);
+
+    /* Room for a quarter of the profiles, so most acquires load and evict. */
+    bench->engine_root = g_build_filename(bench->dir, "profiles", NULL);
+    for (int p = 0; p < ENGINE_BENCH_PROFILES; p++) {
+        gchar *leaf = g_strdup_printf("p%d", p);
+        gchar *profile_dir = g_build_filename(bench->engine_root, leaf, NULL);
+        gchar *profile_path = g_build_filename(profile_dir, TRACKER_FILE_NAME, NULL);
+        g_mkdir_with_parents(profile_dir, 0700);
+        tracker_file_write(profile_path, &bench->tracker.history,
+                           (const char *)bench->tracker.names, bench->tracker.day_count);
+        g_free(profile_path);
+        g_free(profile_dir);
+        g_free(leaf);
+    }
+    bench->engine = tracker_engine_new(bench->engine_root, habits, days,
+                                       tracker_memory_size(&bench->tracker) * ENGINE_BENCH_HOT);
+}
+
+static void remove_tree(const char *path)
+{
+    GDir *dir = g_dir_open(path, 0, NULL);
+    if (dir) {
+        const gchar *name;
+        while ((name = g_dir_read_name(dir))) {
+            gchar *child = g_build_filename(path, name, NULL);
+            remove_tree(child);
+            g_free(child);
+        }
+        g_dir_close(dir);
+        g_rmdir(path);
+    } else {
+        remove(path);
+    }
+}
+
+static void bench_case_free(BenchCase *bench)
+{
+    tracker_engine_free(bench->engine);
+    remove_tree(bench->engine_root);
+    g_free(bench->engine_root);
+    tracker_free(&bench->tracker);
+    remove(bench->journal_path);
+    remove(bench->names_path);
+    remove(bench->export_path);
+    gchar *tracker_path = g_build_filename(bench->dir, TRACKER_FILE_NAME, NULL);
+    remove(tracker_path);
+    g_free(tracker_path);
+    g_rmdir(bench->dir);
+    g_free(bench->dir);
+    g_free(bench->journal_path);
+    g_free(bench->names_path);
+    g_free(bench->export_path);
+    g_free(bench->day_counts);
+    heatmap_snapshot_unref(bench->heatmap);
+    g_free(bench->heatmap_pixels);
+}
+
+static void run_benchmark(const Benchmark *bm, BenchCase *bench, gint64 min_us)
+{
+    gint64 iterations = 1;
+    gint64 elapsed = 0;
+
+    bm->fn(bench);
+    for (;;) {
+        gint64 start = g_get_monotonic_time();
+        for (gint64 n = 0; n < iterations; n++)
+            bm->fn(bench);
+        elapsed = g_get_monotonic_time() - start;
+
+        if (elapsed >= min_us)
+            break;
+        iterations *= (elapsed > 0 && elapsed < min_us / 8) ? 8 : 2;
+    }
+
+    printf("%s,%d,%d,%" G_GINT64_FORMAT ",%.1f\n",
+           bm->name, bench->habits, bench->days, iterations,
+           (elapsed * 1000.0) / (double)iterations);
+    fflush(stdout);
+}
+
+static void print_usage(void)
+{
+    fprintf(stderr,
+            "usage: habit-bench [--filter SUBSTRING] [--min-ms MS]\n"
+            "Prints one CSV row per benchmark, habit count and cycle length.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *filter = NULL;
+    int min_ms = DEFAULT_MIN_MS;
+
+    for (int i = 1; i < argc; i++) {
+        if (g_str_equal(argv[i], "--filter") && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (g_str_equal(argv[i], "--min-ms") && i + 1 < argc) {
+            min_ms = atoi(argv[++i]);
+            if (min_ms < 1) {
+                print_usage();
+                return 2;
+            }
+        } else {
+            print_usage();
+            return 2;
+        }
+    }
+
+    GError *error = NULL;
+    gchar *root = g_dir_make_tmp("habit-bench-XXXXXX", &error);
+    if (!root) {
+        fprintf(stderr, "could not create a scratch directory: %s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+
+    const DayCountsKernel *kernels;
+    int kernel_count = day_counts_kernels(&kernels);
+
+    printf("benchmark,habits,days,iterations,ns_per_op\n");
+    for (size_t h = 0; h < G_N_ELEMENTS(habit_sweep); h++) {
+        for (size_t d = 0; d < G_N_ELEMENTS(day_sweep); d++) {
+            BenchCase bench;
+            bench_case_init(&bench, root, habit_sweep[h], day_sweep[d]);
+            for (size_t b = 0; b < G_N_ELEMENTS(benchmarks); b++) {
+                if (!filter || strstr(benchmarks[b].name, filter))
+                    run_benchmark(&benchmarks[b], &bench, (gint64)min_ms * 1000);
+            }
+            for (int k = 0; k < kernel_count; k++) {
+                gchar *name = g_strdup_printf("day_counts_%s", kernels[k].name);
+                Benchmark bm = { name, bench_day_counts };
+                bench.kernel = &kernels[k];
+                if (!filter || strstr(name, filter))
+                    run_benchmark(&bm, &bench, (gint64)min_ms * 1000);
+                g_free(name);
+            }
+            bench_case_free(&bench);
+        }
+    }
+
+    g_rmdir(root);
+    g_free(root);
+    return 0;
+}
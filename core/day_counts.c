@@ -0,0 +1,188 @@
+#include "habit_core.h"
+#include <string.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define DAY_COUNTS_X86 1
+#include <immintrin.h>
+#endif
+
+/* Byte lanes are flushed to the int counts before they can wrap. */
+#define DAY_COUNTS_BATCH 255
+
+static void day_counts_flush(const guint8 *lanes, int *counts, int base, int count_len)
+{
+    int n = MIN(64, count_len - base);
+    for (int i = 0; i < n; i++)
+        counts[base + i] += lanes[i];
+}
+
+static void day_counts_scalar(const guint64 *words, int rows, int words_per_row, int *counts, int count_len)
+{
+    memset(counts, 0, (size_t)count_len * sizeof(int));
+    for (int r = 0; r < rows; r++) {
+        const guint64 *row = words + (size_t)r * words_per_row;
+        for (int w = 0; w < words_per_row; w++) {
+            for (guint64 word = row[w]; word; word &= word - 1) {
+                int day = w * 64 + lowest_bit64(word);
+                if (day < count_len)
+                    counts[day]++;
+            }
+        }
+    }
+}
+
+#ifdef DAY_COUNTS_X86
+
+__attribute__((target("sse2")))
+static __m128i expand16_sse2(guint32 bits)
+{
+    const __m128i select = _mm_set1_epi64x((long long)G_GUINT64_CONSTANT(0x8040201008040201));
+    __m128i v = _mm_unpacklo_epi64(_mm_set1_epi8((char)(bits & 0xff)), _mm_set1_epi8((char)((bits >> 8) & 0xff)));
+    return _mm_cmpeq_epi8(_mm_and_si128(v, select), select);
+}
+
+__attribute__((target("sse2")))
+static void day_counts_sse2(const guint64 *words, int rows, int words_per_row, int *counts, int count_len)
+{
+    memset(counts, 0, (size_t)count_len * sizeof(int));
+    guint8 lanes[64];
+
+    for (int w = 0; w < words_per_row && w * 64 < count_len; w++) {
+        for (int first = 0; first < rows; first += DAY_COUNTS_BATCH) {
+            __m128i acc[4] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+            int last = MIN(rows, first + DAY_COUNTS_BATCH);
+            for (int r = first; r < last; r++) {
+                guint64 word = words[(size_t)r * words_per_row + w];
+                for (int k = 0; k < 4; k++)
+                    acc[k] = _mm_sub_epi8(acc[k], expand16_sse2((guint32)(word >> (16 * k))));
+            }
+            for (int k = 0; k < 4; k++)
+                _mm_storeu_si128((__m128i *)(lanes + 16 * k), acc[k]);
+            day_counts_flush(lanes, counts, w * 64, count_len);
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static __m256i expand32_avx2(guint32 bits)
+{
+    const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const __m256i select = _mm256_set1_epi64x((long long)G_GUINT64_CONSTANT(0x8040201008040201));
+    __m256i v = _mm256_shuffle_epi8(_mm256_set1_epi32((int)bits), spread);
+    return _mm256_cmpeq_epi8(_mm256_and_si256(v, select), select);
+}
+
+__attribute__((target("avx2")))
+static void day_counts_avx2(const guint64 *words, int rows, int words_per_row, int *counts, int count_len)
+{
+    memset(counts, 0, (size_t)count_len * sizeof(int));
+    guint8 lanes[64];
+
+    for (int w = 0; w < words_per_row && w * 64 < count_len; w++) {
+        for (int first = 0; first < rows; first += DAY_COUNTS_BATCH) {
+            __m256i lo = _mm256_setzero_si256();
+            __m256i hi = _mm256_setzero_si256();
+            int last = MIN(rows, first + DAY_COUNTS_BATCH);
+            for (int r = first; r < last; r++) {
+                guint64 word = words[(size_t)r * words_per_row + w];
+                lo = _mm256_sub_epi8(lo, expand32_avx2((guint32)word));
+                hi = _mm256_sub_epi8(hi, expand32_avx2((guint32)(word >> 32)));
+            }
+            _mm256_storeu_si256((__m256i *)lanes, lo);
+            _mm256_storeu_si256((__m256i *)(lanes + 32), hi);
+            day_counts_flush(lanes, counts, w * 64, count_len);
+        }
+    }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void day_counts_avx512(const guint64 *words, int rows, int words_per_row, int *counts, int count_len)
+{
+    memset(counts, 0, (size_t)count_len * sizeof(int));
+    const __m512i one = _mm512_set1_epi8(1);
+    guint8 lanes[64];
+
+    for (int w = 0; w < words_per_row && w * 64 < count_len; w++) {
+        for (int first = 0; first < rows; first += DAY_COUNTS_BATCH) {
+            __m512i acc = _mm512_setzero_si512();
+            int last = MIN(rows, first + DAY_COUNTS_BATCH);
+            for (int r = first; r < last; r++)
+                acc = _mm512_mask_add_epi8(acc, (__mmask64)words[(size_t)r * words_per_row + w], acc, one);
+            _mm512_storeu_si512(lanes, acc);
+            day_counts_flush(lanes, counts, w * 64, count_len);
+        }
+    }
+}
+
+#endif
+
+static const DayCountsKernel all_kernels[] = {
+    { "scalar", day_counts_scalar },
+#ifdef DAY_COUNTS_X86
+    { "sse2", day_counts_sse2 },
+    { "avx2", day_counts_avx2 },
+    { "avx512", day_counts_avx512 },
+#endif
+};
+
+static gboolean kernel_supported(const DayCountsKernel *kernel)
+{
+#ifdef DAY_COUNTS_X86
+    __builtin_cpu_init();
+    if (kernel->fn == day_counts_sse2)
+        return __builtin_cpu_supports("sse2");
+    if (kernel->fn == day_counts_avx2)
+        return __builtin_cpu_supports("avx2");
+    if (kernel->fn == day_counts_avx512)
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+    return kernel->fn == day_counts_scalar;
+}
+
+int day_counts_kernels(const DayCountsKernel **kernels)
+{
+    static DayCountsKernel supported[G_N_ELEMENTS(all_kernels)];
+    static gsize supported_count;
+
+    if (g_once_init_enter(&supported_count)) {
+        int count = 0;
+        for (guint i = 0; i < G_N_ELEMENTS(all_kernels); i++) {
+            if (kernel_supported(&all_kernels[i]))
+                supported[count++] = all_kernels[i];
+        }
+        g_once_init_leave(&supported_count, (gsize)count);
+    }
+
+    *kernels = supported;
+    return (int)supported_count;
+}
+
+const DayCountsKernel *day_counts_kernel(void)
+{
+    static const DayCountsKernel *active;
+
+    if (g_once_init_enter(&active)) {
+        const DayCountsKernel *kernels;
+        int count = day_counts_kernels(&kernels);
+        const DayCountsKernel *chosen = &kernels[count - 1];
+        const char *forced = g_getenv(SIMD_ENV);
+
+        if (forced) {
+            int i = 0;
+            while (i < count && !g_str_equal(kernels[i].name, forced))
+                i++;
+            if (i < count)
+                chosen = &kernels[i];
+            else
+                g_warning("%s=%s is not available on this CPU, using %s", SIMD_ENV, forced, chosen->name);
+        }
+        g_once_init_leave(&active, chosen);
+    }
+    return active;
+}
+
+void day_counts(const guint64 *words, int rows, int words_per_row, int *counts, int count_len)
+{
+    day_counts_kernel()->fn(words, rows, words_per_row, counts, count_len);
+}
@@ -0,0 +1,230 @@
+#include "habit_core.h"
+#include <errno.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+#define ENGINE_MAX_ID_LEN 64
+#define ENGINE_MAX_WRITERS 8
+
+/* `tracker` comes first so a HabitTracker handed out by acquire can be cast
+ * back to its profile. */
+typedef struct {
+    HabitTracker tracker;
+    char *id;
+    int refs;
+    gboolean ready;
+    gboolean evicting;
+    gsize bytes;
+    GList link;
+} EngineProfile;
+
+struct _TrackerEngine {
+    char *root;
+    int habit_count;
+    int day_capacity;
+    gsize budget;
+    gsize used;
+    GMutex lock;
+    GCond cond;
+    GHashTable *profiles;
+    GQueue idle;
+    GThreadPool *writers;
+    guint64 hits;
+    guint64 misses;
+    guint64 evictions;
+};
+
+static gboolean profile_id_valid(const char *id)
+{
+    size_t len = strlen(id);
+    if (len == 0 || len > ENGINE_MAX_ID_LEN || id[0] == '.')
+        return FALSE;
+
+    for (size_t i = 0; i < len; i++) {
+        if (!g_ascii_isalnum(id[i]) && id[i] != '-' && id[i] != '_' && id[i] != '.')
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static void profile_free(gpointer data)
+{
+    EngineProfile *profile = data;
+    g_free(profile->id);
+    g_free(profile);
+}
+
+static void profile_load(TrackerEngine *engine, EngineProfile *profile)
+{
+    gint64 span = trace_begin();
+    gchar *dir = g_build_filename(engine->root, profile->id, NULL);
+    if (g_mkdir_with_parents(dir, 0700) != 0)
+        g_warning("could not create %s: %s", dir, g_strerror(errno));
+
+    tracker_init(&profile->tracker, dir, engine->habit_count, engine->day_capacity);
+    gboolean snapshot_now = tracker_load(&profile->tracker);
+    persist_worker_start_pooled(&profile->tracker.persist, &profile->tracker, snapshot_now, engine->writers);
+    tracker_roll_to_today(&profile->tracker);
+    g_free(dir);
+    trace_end("engine_load", span);
+}
+
+/* Picks least recently used idle profiles until the cache fits; the caller
+ * writes them out with engine_finish_evictions once the lock is dropped. */
+static GSList *engine_evict(TrackerEngine *engine)
+{
+    GSList *victims = NULL;
+
+    while (engine->used > engine->budget && engine->idle.tail) {
+        GList *link = engine->idle.tail;
+        EngineProfile *profile = link->data;
+        g_queue_unlink(&engine->idle, link);
+        profile->evicting = TRUE;
+        engine->used -= profile->bytes;
+        engine->evictions++;
+        victims = g_slist_prepend(victims, profile);
+    }
+    return victims;
+}
+
+static void engine_finish_evictions(TrackerEngine *engine, GSList *victims)
+{
+    if (!victims)
+        return;
+
+    gint64 span = trace_begin();
+    for (GSList *l = victims; l; l = l->next)
+        tracker_free(&((EngineProfile *)l->data)->tracker);
+    trace_end("engine_evict", span);
+
+    /* Evicted profiles stay in the table until their writes are on disk, so
+     * a concurrent acquire cannot load a stale copy. */
+    g_mutex_lock(&engine->lock);
+    for (GSList *l = victims; l; l = l->next)
+        g_hash_table_remove(engine->profiles, ((EngineProfile *)l->data)->id);
+    g_cond_broadcast(&engine->cond);
+    g_mutex_unlock(&engine->lock);
+    g_slist_free(victims);
+}
+
+/* Serves the profiles under `root/<id>`, keeping idle ones in memory until
+ * their combined tracker_memory_size exceeds `budget_bytes`. New profiles
+ * start with `habit_count` habits and `day_capacity` days; saved ones load
+ * with their own layout when it is larger. Dirty profiles are written by a
+ * shared pool of persist threads. */
+TrackerEngine *tracker_engine_new(const char *root, int habit_count, int day_capacity, gsize budget_bytes)
+{
+    TrackerEngine *engine = g_new0(TrackerEngine, 1);
+    engine->root = g_strdup(root);
+    engine->habit_count = habit_count;
+    engine->day_capacity = day_capacity;
+    engine->budget = budget_bytes;
+    g_mutex_init(&engine->lock);
+    g_cond_init(&engine->cond);
+    engine->profiles = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, profile_free);
+    g_queue_init(&engine->idle);
+    engine->writers = persist_pool_new(CLAMP((int)g_get_num_processors(), 1, ENGINE_MAX_WRITERS));
+    return engine;
+}
+
+/* Returns the tracker for `id`, loading it on first use, or NULL if the id
+ * is not a plain file name. The tracker stays loaded until every acquire is
+ * matched by tracker_engine_release. Each profile may be pinned from several
+ * threads but must only be used by one at a time. */
+HabitTracker *tracker_engine_acquire(TrackerEngine *engine, const char *id)
+{
+    if (!profile_id_valid(id)) {
+        g_warning("invalid profile id '%s'", id);
+        return NULL;
+    }
+
+    g_mutex_lock(&engine->lock);
+    EngineProfile *profile;
+    while ((profile = g_hash_table_lookup(engine->profiles, id)) && profile->evicting)
+        g_cond_wait(&engine->cond, &engine->lock);
+
+    if (profile) {
+        if (profile->refs++ == 0)
+            g_queue_unlink(&engine->idle, &profile->link);
+        engine->hits++;
+        while (!profile->ready)
+            g_cond_wait(&engine->cond, &engine->lock);
+        g_mutex_unlock(&engine->lock);
+        return &profile->tracker;
+    }
+
+    profile = g_new0(EngineProfile, 1);
+    profile->id = g_strdup(id);
+    profile->refs = 1;
+    profile->link.data = profile;
+    g_hash_table_insert(engine->profiles, profile->id, profile);
+    engine->misses++;
+    g_mutex_unlock(&engine->lock);
+
+    profile_load(engine, profile);
+    gsize bytes = tracker_memory_size(&profile->tracker);
+
+    g_mutex_lock(&engine->lock);
+    profile->ready = TRUE;
+    profile->bytes = bytes;
+    engine->used += bytes;
+    g_cond_broadcast(&engine->cond);
+    GSList *victims = engine_evict(engine);
+    g_mutex_unlock(&engine->lock);
+
+    engine_finish_evictions(engine, victims);
+    return &profile->tracker;
+}
+
+void tracker_engine_release(TrackerEngine *engine, HabitTracker *tracker)
+{
+    EngineProfile *profile = (EngineProfile *)tracker;
+    gsize bytes = tracker_memory_size(tracker);
+
+    g_mutex_lock(&engine->lock);
+    engine->used = engine->used - profile->bytes + bytes;
+    profile->bytes = bytes;
+    if (--profile->refs == 0)
+        g_queue_push_head_link(&engine->idle, &profile->link);
+    GSList *victims = engine_evict(engine);
+    g_mutex_unlock(&engine->lock);
+
+    engine_finish_evictions(engine, victims);
+}
+
+void tracker_engine_get_stats(TrackerEngine *engine, TrackerEngineStats *stats)
+{
+    g_mutex_lock(&engine->lock);
+    stats->loaded = (int)g_hash_table_size(engine->profiles);
+    stats->pinned = stats->loaded - (int)engine->idle.length;
+    stats->bytes = engine->used;
+    stats->budget = engine->budget;
+    stats->hits = engine->hits;
+    stats->misses = engine->misses;
+    stats->evictions = engine->evictions;
+    g_mutex_unlock(&engine->lock);
+}
+
+/* Writes out every loaded profile. All of them must have been released. */
+void tracker_engine_free(TrackerEngine *engine)
+{
+    if (!engine)
+        return;
+
+    GHashTableIter iter;
+    gpointer value;
+    g_hash_table_iter_init(&iter, engine->profiles);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        EngineProfile *profile = value;
+        if (profile->refs > 0)
+            g_warning("profile '%s' is still in use", profile->id);
+        tracker_free(&profile->tracker);
+    }
+
+    g_thread_pool_free(engine->writers, FALSE, TRUE);
+    g_hash_table_destroy(engine->profiles);
+    g_mutex_clear(&engine->lock);
+    g_cond_clear(&engine->cond);
+    g_free(engine->root);
+    g_free(engine);
+}
@@ -0,0 +1,522 @@
+#include "habit_core.h"
+#include <errno.h>
+#include <string.h>
+
+#define EXPORT_MAGIC "HTX1"
+#define EXPORT_BINARY_VERSION 1
+#define EXPORT_PROGRESS_ROWS 4096
+#define EXPORT_PROGRESS_MS 100
+
+typedef struct {
+    ExportJob *job;
+    FILE *f;
+    const HistoryStore *hist;
+    int habit_count;
+    int first_day;
+    int end_day;
+    gint64 rows_done;
+    gint64 rows_total;
+    gboolean first_row;
+} ExportWriter;
+
+static const char *const format_names[] = { "text", "csv", "json", "binary" };
+static const char *const format_extensions[] = { "txt", "csv", "json", "bin" };
+static const char *const granularity_names[] = { "cell", "habit", "day", "week" };
+
+gboolean export_parse_format(const char *name, ExportFormat *format)
+{
+    for (guint i = 0; i < G_N_ELEMENTS(format_names); i++) {
+        if (g_str_equal(name, format_names[i])) {
+            *format = (ExportFormat)i;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+gboolean export_parse_granularity(const char *name, ExportGranularity *granularity)
+{
+    for (guint i = 0; i < G_N_ELEMENTS(granularity_names); i++) {
+        if (g_str_equal(name, granularity_names[i])) {
+            *granularity = (ExportGranularity)i;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+const char *export_format_extension(ExportFormat format)
+{
+    return format_extensions[format];
+}
+
+static void format_day(int day, char *buf, size_t len)
+{
+    GDate date;
+    g_date_clear(&date, 1);
+    g_date_set_julian(&date, (guint32)day);
+    g_snprintf(buf, len, "%04d-%02d-%02d", g_date_get_year(&date), g_date_get_month(&date),
+               g_date_get_day(&date));
+}
+
+static int week_start(int day)
+{
+    return day - (day - 1) % 7;
+}
+
+static void write_u32(FILE *f, guint32 value)
+{
+    guint32 le = GUINT32_TO_LE(value);
+    fwrite(&le, sizeof(le), 1, f);
+}
+
+static void write_csv_string(FILE *f, const char *text)
+{
+    fputc('"', f);
+    for (const char *p = text; *p; p++) {
+        if (*p == '"')
+            fputc('"', f);
+        fputc(*p, f);
+    }
+    fputc('"', f);
+}
+
+static void write_json_string(FILE *f, const char *text)
+{
+    fputc('"', f);
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        if (*p == '"' || *p == '\\')
+            fprintf(f, "\\%c", *p);
+        else if (*p < 0x20)
+            fprintf(f, "\\u%04x", *p);
+        else
+            fputc(*p, f);
+    }
+    fputc('"', f);
+}
+
+static gboolean export_step(ExportWriter *w)
+{
+    w->rows_done++;
+    if (w->rows_done % EXPORT_PROGRESS_ROWS != 0)
+        return TRUE;
+
+    ExportJob *job = w->job;
+    if (g_atomic_int_get(&job->cancelled))
+        return FALSE;
+
+    g_atomic_int_set(&job->progress_permille, (gint)((w->rows_done * 1000) / MAX(w->rows_total, 1)));
+    return !ferror(w->f);
+}
+
+static void begin_row(ExportWriter *w)
+{
+    if (w->job->format == EXPORT_FORMAT_JSON) {
+        fputs(w->first_row ? "\n  {" : ",\n  {", w->f);
+        w->first_row = FALSE;
+    }
+}
+
+static void end_row(ExportWriter *w)
+{
+    fputs(w->job->format == EXPORT_FORMAT_JSON ? "}" : "\n", w->f);
+}
+
+static void write_summary_row(ExportWriter *w, const char *key, const char *label, int checked, int possible)
+{
+    double percent = possible > 0 ? (100.0 * checked) / possible : 0.0;
+
+    if (w->job->format == EXPORT_FORMAT_BINARY) {
+        write_u32(w->f, (guint32)checked);
+        write_u32(w->f, (guint32)possible);
+        return;
+    }
+
+    begin_row(w);
+    if (w->job->format == EXPORT_FORMAT_JSON)
+        fprintf(w->f, "\"%s\":\"%s\",\"checked\":%d,\"possible\":%d,\"percent\":%.2f",
+                key, label, checked, possible, percent);
+    else
+        fprintf(w->f, "%s,%d,%d,%.2f", label, checked, possible, percent);
+    end_row(w);
+}
+
+static gboolean export_cells(ExportWriter *w)
+{
+    ExportFormat format = w->job->format;
+    int bitmap_bytes = (w->habit_count + 7) / 8;
+    guint8 *bitmap = g_malloc(bitmap_bytes);
+    gboolean ok = TRUE;
+
+    for (int day = w->first_day; ok && day < w->end_day; day++) {
+        const guint64 *words = history_segment_words(w->hist, day / HISTORY_SEGMENT_DAYS);
+        int bit = day % HISTORY_SEGMENT_DAYS;
+        char date[16];
+        format_day(day, date, sizeof(date));
+
+        if (format == EXPORT_FORMAT_BINARY)
+            memset(bitmap, 0, bitmap_bytes);
+
+        for (int h = 0; ok && h < w->habit_count; h++) {
+            int checked = words ? (int)((words[h] >> bit) & 1) : 0;
+
+            if (format == EXPORT_FORMAT_BINARY) {
+                bitmap[h / 8] |= (guint8)(checked << (h % 8));
+            } else {
+                begin_row(w);
+                if (format == EXPORT_FORMAT_JSON) {
+                    fprintf(w->f, "\"date\":\"%s\",\"habit_index\":%d,\"habit\":", date, h + 1);
+                    write_json_string(w->f, w->job->snapshot.names[h]);
+                    fprintf(w->f, ",\"checked\":%d", checked);
+                } else {
+                    fprintf(w->f, "%s,%d,", date, h + 1);
+                    write_csv_string(w->f, w->job->snapshot.names[h]);
+                    fprintf(w->f, ",%d", checked);
+                }
+                end_row(w);
+            }
+            ok = export_step(w);
+        }
+
+        if (format == EXPORT_FORMAT_BINARY)
+            fwrite(bitmap, 1, bitmap_bytes, w->f);
+    }
+
+    g_free(bitmap);
+    return ok;
+}
+
+static gboolean export_habits(ExportWriter *w)
+{
+    int possible = w->end_day - w->first_day;
+    for (int h = 0; h < w->habit_count; h++) {
+        int checked = history_count_range(w->hist, h, w->first_day, w->end_day);
+        const char *name = w->job->snapshot.names[h];
+
+        if (w->job->format == EXPORT_FORMAT_BINARY) {
+            write_summary_row(w, NULL, NULL, checked, possible);
+        } else {
+            begin_row(w);
+            if (w->job->format == EXPORT_FORMAT_JSON) {
+                fprintf(w->f, "\"habit_index\":%d,\"habit\":", h + 1);
+                write_json_string(w->f, name);
+            } else {
+                fprintf(w->f, "%d,", h + 1);
+                write_csv_string(w->f, name);
+            }
+            double percent = possible > 0 ? (100.0 * checked) / possible : 0.0;
+            fprintf(w->f, w->job->format == EXPORT_FORMAT_JSON
+                              ? ",\"checked\":%d,\"possible\":%d,\"percent\":%.2f"
+                                ",\"current_streak\":%d,\"longest_streak\":%d"
+                              : ",%d,%d,%.2f,%d,%d",
+                    checked, possible, percent, tracker_current_streak(&w->job->snapshot, h),
+                    tracker_longest_streak(&w->job->snapshot, h));
+            end_row(w);
+        }
+        if (!export_step(w))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static gboolean export_days(ExportWriter *w, gboolean by_week)
+{
+    int counts[HISTORY_SEGMENT_DAYS];
+    int week_first = w->first_day;
+    int week_checked = 0;
+
+    for (int block = w->first_day - w->first_day % HISTORY_SEGMENT_DAYS; block < w->end_day;
+         block += HISTORY_SEGMENT_DAYS) {
+        const guint64 *words = history_segment_words(w->hist, block / HISTORY_SEGMENT_DAYS);
+        if (words)
+            day_counts(words, w->habit_count, 1, counts, HISTORY_SEGMENT_DAYS);
+        else
+            memset(counts, 0, sizeof(counts));
+
+        for (int day = MAX(block, w->first_day); day < MIN(block + HISTORY_SEGMENT_DAYS, w->end_day); day++) {
+            int checked = counts[day - block];
+            char date[16];
+
+            if (!by_week) {
+                format_day(day, date, sizeof(date));
+                if (w->job->format == EXPORT_FORMAT_BINARY)
+                    write_u32(w->f, (guint32)checked);
+                else
+                    write_summary_row(w, "date", date, checked, w->habit_count);
+                if (!export_step(w))
+                    return FALSE;
+                continue;
+            }
+
+            week_checked += checked;
+            if (day + 1 == w->end_day || week_start(day + 1) == day + 1) {
+                format_day(week_start(day), date, sizeof(date));
+                if (w->job->format == EXPORT_FORMAT_BINARY)
+                    write_u32(w->f, (guint32)week_start(day));
+                write_summary_row(w, "week_start", date, week_checked, w->habit_count * (day + 1 - week_first));
+                week_checked = 0;
+                week_first = day + 1;
+                if (!export_step(w))
+                    return FALSE;
+            }
+        }
+    }
+    return TRUE;
+}
+
+/* The plain-text summary of the current cycle, streamed a habit or week at a time. */
+static gboolean export_text(ExportWriter *w)
+{
+    const HabitTracker *tracker = &w->job->snapshot;
+    int day_count = tracker->day_count;
+    int total = tracker->habit_count * day_count;
+    int checked = tracker_count_checked(tracker);
+    int total_percent = (total > 0) ? (checked * 100) / total : 0;
+
+    fprintf(w->f, "%d-Day Tracker Export\n", day_count);
+    fprintf(w->f, "===================\n\n");
+    fprintf(w->f, "Overall: %d/%d (%d%%)\n\n", checked, total, total_percent);
+
+    fprintf(w->f, "Per-habit completion:\n");
+    for (int i = 0; i < tracker->habit_count; i++) {
+        int habit_checked = tracker_count_checked_for_habit(tracker, i);
+        int habit_percent = (day_count > 0) ? (habit_checked * 100) / day_count : 0;
+        int current = tracker_current_streak(tracker, i);
+        int longest = tracker_longest_streak(tracker, i);
+        fprintf(w->f, "- %s: %d/%d (%d%%), streak %d %s, longest %d %s\n", tracker->names[i], habit_checked,
+                day_count, habit_percent, current, day_unit(current), longest, day_unit(longest));
+        if (!export_step(w))
+            return FALSE;
+    }
+
+    fprintf(w->f, "\nWeekly breakdown:\n");
+    int week_count = tracker_week_count(tracker);
+    for (int week = 0; week < week_count; week++) {
+        int start_day, end_day;
+        tracker_week_bounds(tracker, week, &start_day, &end_day);
+
+        int week_total = tracker->habit_count * (end_day - start_day + 1);
+        int week_checked = tracker_count_checked_in_week(tracker, week);
+        int week_percent = (week_total > 0) ? (week_checked * 100) / week_total : 0;
+
+        fprintf(w->f, "- Week %d (Day %d-%d): %d/%d (%d%%)\n",
+                week + 1, start_day, end_day, week_checked, week_total, week_percent);
+        if (!export_step(w))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static gint64 export_row_count(const ExportWriter *w)
+{
+    int days = w->end_day - w->first_day;
+    if (w->job->format == EXPORT_FORMAT_TEXT)
+        return w->habit_count + tracker_week_count(&w->job->snapshot);
+
+    switch (w->job->granularity) {
+    case EXPORT_BY_CELL:
+        return (gint64)days * w->habit_count;
+    case EXPORT_BY_HABIT:
+        return w->habit_count;
+    case EXPORT_BY_DAY:
+        return days;
+    case EXPORT_BY_WEEK:
+    default:
+        return (week_start(w->end_day - 1) - week_start(w->first_day)) / 7 + 1;
+    }
+}
+
+static void write_header(ExportWriter *w)
+{
+    ExportJob *job = w->job;
+    static const char *const csv_headers[] = {
+        "date,habit_index,habit,checked",
+        "habit_index,habit,checked,possible,percent,current_streak,longest_streak",
+        "date,checked,possible,percent",
+        "week_start,checked,possible,percent"
+    };
+
+    if (job->format == EXPORT_FORMAT_CSV) {
+        fprintf(w->f, "%s\n", csv_headers[job->granularity]);
+        return;
+    }
+
+    if (job->format == EXPORT_FORMAT_BINARY) {
+        fwrite(EXPORT_MAGIC, 1, 4, w->f);
+        fputc(EXPORT_BINARY_VERSION, w->f);
+        fputc(job->granularity, w->f);
+        fputc(0, w->f);
+        fputc(0, w->f);
+        write_u32(w->f, (guint32)w->habit_count);
+        write_u32(w->f, (guint32)w->first_day);
+        write_u32(w->f, (guint32)(w->end_day - w->first_day));
+        write_u32(w->f, (guint32)w->rows_total);
+        for (int h = 0; h < w->habit_count; h++) {
+            char name[NAME_LEN] = { 0 };
+            g_strlcpy(name, job->snapshot.names[h], NAME_LEN);
+            fwrite(name, 1, NAME_LEN, w->f);
+        }
+        return;
+    }
+
+    char first[16], last[16];
+    format_day(w->first_day, first, sizeof(first));
+    format_day(w->end_day - 1, last, sizeof(last));
+    fprintf(w->f, "{\n\"granularity\": \"%s\",\n\"first_day\": \"%s\",\n\"last_day\": \"%s\",\n\"habits\": [",
+            granularity_names[job->granularity], first, last);
+    for (int h = 0; h < w->habit_count; h++) {
+        if (h > 0)
+            fputs(", ", w->f);
+        write_json_string(w->f, job->snapshot.names[h]);
+    }
+    fputs("],\n\"rows\": [", w->f);
+}
+
+static gboolean export_write(ExportJob *job, FILE *f)
+{
+    const HistoryStore *hist = &job->snapshot.history;
+    int end_day = hist->cycle_start + job->snapshot.day_count;
+    ExportWriter w = {
+        .job = job,
+        .f = f,
+        .hist = hist,
+        .habit_count = job->snapshot.habit_count,
+        .first_day = history_first_day(hist, hist->cycle_start),
+        .end_day = end_day,
+        .first_row = TRUE,
+    };
+    w.rows_total = export_row_count(&w);
+    if (job->format == EXPORT_FORMAT_TEXT)
+        return export_text(&w) && !ferror(f);
+
+    write_header(&w);
+
+    gboolean ok;
+    switch (job->granularity) {
+    case EXPORT_BY_CELL:
+        ok = export_cells(&w);
+        break;
+    case EXPORT_BY_HABIT:
+        ok = export_habits(&w);
+        break;
+    case EXPORT_BY_DAY:
+        ok = export_days(&w, FALSE);
+        break;
+    case EXPORT_BY_WEEK:
+    default:
+        ok = export_days(&w, TRUE);
+        break;
+    }
+
+    if (ok && job->format == EXPORT_FORMAT_JSON)
+        fputs("\n]\n}\n", f);
+    return ok && !ferror(f);
+}
+
+ExportJob *export_job_new(const HabitTracker *tracker, const char *path,
+                          ExportFormat format, ExportGranularity granularity)
+{
+    ExportJob *job = g_new0(ExportJob, 1);
+    tracker_snapshot(&job->snapshot, tracker);
+    job->path = g_strdup(path);
+    job->format = format;
+    job->granularity = granularity;
+    return job;
+}
+
+gboolean export_job_run(ExportJob *job)
+{
+    tracker_snapshot_rebuild(&job->snapshot);
+    if (g_str_equal(job->path, "-")) {
+        job->ok = export_write(job, stdout) && fflush(stdout) == 0;
+        return job->ok;
+    }
+
+    gchar *tmp_path = g_strdup_printf("%s.tmp", job->path);
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) {
+        g_warning("could not open %s for writing: %s", tmp_path, g_strerror(errno));
+        g_free(tmp_path);
+        job->ok = FALSE;
+        return FALSE;
+    }
+
+    gboolean ok = export_write(job, f);
+    if (fclose(f) != 0)
+        ok = FALSE;
+
+    if (ok && rename(tmp_path, job->path) != 0) {
+        g_warning("failed replacing %s: %s", job->path, g_strerror(errno));
+        ok = FALSE;
+    }
+    if (!ok) {
+        if (!g_atomic_int_get(&job->cancelled))
+            g_warning("failed writing %s", job->path);
+        remove(tmp_path);
+    }
+
+    g_free(tmp_path);
+    g_atomic_int_set(&job->progress_permille, 1000);
+    job->ok = ok;
+    return ok;
+}
+
+static gboolean export_report_progress(gpointer user_data)
+{
+    ExportJob *job = user_data;
+    job->progress(g_atomic_int_get(&job->progress_permille) / 1000.0, job->user_data);
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean export_report_done(gpointer user_data)
+{
+    ExportJob *job = user_data;
+    g_thread_join(job->thread);
+    job->thread = NULL;
+    if (job->progress_source) {
+        g_source_remove(job->progress_source);
+        job->progress_source = 0;
+    }
+    if (job->done)
+        job->done(job->ok, g_atomic_int_get(&job->cancelled), job->user_data);
+    return G_SOURCE_REMOVE;
+}
+
+static gpointer export_job_main(gpointer user_data)
+{
+    ExportJob *job = user_data;
+    trace_name_thread("export");
+    gint64 span = trace_begin();
+    export_job_run(job);
+    trace_end("export_job", span);
+    g_idle_add(export_report_done, job);
+    return NULL;
+}
+
+void export_job_start(ExportJob *job, ExportProgressFunc progress, ExportDoneFunc done, gpointer user_data)
+{
+    job->progress = progress;
+    job->done = done;
+    job->user_data = user_data;
+    job->thread = g_thread_new("export", export_job_main, job);
+    if (progress)
+        job->progress_source = g_timeout_add(EXPORT_PROGRESS_MS, export_report_progress, job);
+}
+
+void export_job_cancel(ExportJob *job)
+{
+    g_atomic_int_set(&job->cancelled, 1);
+}
+
+void export_job_free(ExportJob *job)
+{
+    if (job->thread) {
+        export_job_cancel(job);
+        g_thread_join(job->thread);
+        while (g_source_remove_by_user_data(job))
+            ;
+    }
+    tracker_free(&job->snapshot);
+    g_free(job->path);
+    g_free(job);
+}
@@ -0,0 +1,524 @@
+#ifndef HABIT_CORE_H
+#define HABIT_CORE_H
+
+#include <glib.h>
+#include <stdio.h>
+
+#define MAX_DAY_COUNT 80
+#define DEFAULT_DAY_COUNT 60
+#define ITEM_COUNT 10
+#define NAME_LEN 64
+#define MAX_HABIT_COUNT 65535
+#define MAX_DAY_CAPACITY 36600
+
+#define HISTORY_SEGMENT_DAYS 64
+
+#define TRACKER_FILE_NAME "tracker.dat"
+#define JOURNAL_FILE_NAME "tracker.journal"
+#define LEGACY_STATES_FILE_NAME "states.dat"
+#define LEGACY_HABITS_FILE_NAME "habits.dat"
+#define LEGACY_SETTINGS_FILE_NAME "settings.dat"
+#define LEGACY_JOURNAL_FILE_NAME "states.journal"
+#define LOCK_FILE_NAME "tracker.lock"
+
+#define DEFAULT_GROUP_COMMIT_MS 250
+#define JOURNAL_MAGIC "HTJ1"
+#define JOURNAL_HEADER_SIZE 4
+#define JOURNAL_RECORD_SIZE 8
+#define JOURNAL_COMPACT_BYTES (64 * 1024)
+
+#define TRACE_ENV "HABIT_TRACKER_TRACE"
+#define TRACE_BUFFER_EVENTS 32768
+
+#define HEATMAP_TILE_SIZE 128
+
+#define SIMD_ENV "HABIT_TRACKER_SIMD"
+
+#define SOCKET_ENV "HABIT_TRACKER_SOCKET"
+#define IPC_SOCKET_NAME "habit-tracker.sock"
+#define IPC_HEADER_SIZE 4
+
+typedef struct {
+    int habit_count;
+    int day_capacity;
+    int words_per_habit;
+    int ring_days;
+    int head;
+    guint64 *words;
+} HabitStore;
+
+typedef struct {
+    int habit_count;
+    int day_capacity;
+    int ring_days;
+    int head;
+    int day_count;
+    int total;
+    int *per_habit;
+    int *per_day;
+    int *day_prefix_tree;
+} HabitStats;
+
+typedef void (*DayCountsFunc)(const guint64 *words, int rows, int words_per_row, int *counts, int count_len);
+
+typedef struct {
+    const char *name;
+    DayCountsFunc fn;
+} DayCountsKernel;
+
+/* Segment words shared copy-on-write between stores. */
+typedef struct {
+    gint refs;
+    guint64 words[];
+} HistoryBlock;
+
+typedef struct {
+    gint64 index;
+    guint64 *words;
+    HistoryBlock *block;
+} HistorySegment;
+
+typedef struct {
+    int habit_count;
+    int window_days;
+    int cycle_start;
+    gboolean rolling;
+    GArray *segments;
+    GMappedFile *mapping;
+} HistoryStore;
+
+typedef struct {
+    int start;
+    int length;
+} StreakRun;
+
+typedef struct {
+    int habit_count;
+    GArray **runs;
+    int *longest;
+} HabitStreaks;
+
+typedef struct {
+    int habit;
+    int day;
+    gboolean value;
+} CellChange;
+
+typedef struct {
+    GArray *cells;
+    char *names;
+    int habit_count;
+    int day_count;
+    int cycle_start;
+    HistoryStore *history;
+} TrackerChange;
+
+typedef enum {
+    TRACKER_CHANGED_CELLS = 1 << 0,
+    TRACKER_CHANGED_NAMES = 1 << 1,
+    TRACKER_CHANGED_LAYOUT = 1 << 2
+} TrackerChangeFlags;
+
+typedef void (*TrackerChangedFunc)(const GArray *cells, guint flags, gpointer user_data);
+typedef struct _TrackerWatch TrackerWatch;
+
+typedef struct {
+    guint64 write_id;
+    gint64 journal_size;
+} DataStamp;
+
+typedef enum {
+    DURABILITY_EVERY_CHANGE,
+    DURABILITY_GROUP_COMMIT,
+    DURABILITY_ON_EXIT
+} DurabilityPolicy;
+
+typedef enum {
+    JOURNAL_SET_CELL = 1,
+    JOURNAL_CLEAR_HABIT = 2,
+    JOURNAL_CLEAR_ALL = 3,
+    JOURNAL_NEW_CYCLE = 4,
+    JOURNAL_MOVE_WINDOW = 5
+} JournalOp;
+
+typedef struct {
+    GThread *thread;
+    GThreadPool *pool;
+    gboolean queued;
+    GMutex lock;
+    GCond cond;
+    DurabilityPolicy policy;
+    gint64 group_commit_us;
+    GByteArray *pending_journal;
+    char *pending_names;
+    int pending_name_count;
+    HistoryStore *pending_history;
+    int pending_day_count;
+    gint64 first_dirty_time;
+    gboolean stopping;
+    gboolean snapshot_requested;
+    gboolean sync_requested;
+    gboolean verify_requested;
+    char *data_dir;
+    char *tracker_path;
+    char *journal_path;
+    char *lock_path;
+    DataStamp stamp;
+    TrackerChange *change;
+    GSourceFunc change_ready;
+    gpointer change_data;
+    guint change_source;
+    FILE *journal_file;
+    long journal_size;
+    HistoryStore mirror;
+    char *mirror_names;
+    int mirror_day_count;
+} PersistWorker;
+
+typedef struct {
+    char *data_dir;
+    char *tracker_path;
+    char *journal_path;
+    int habit_count;
+    int day_capacity;
+    int day_count;
+    int archived_check_ins;
+    char (*names)[NAME_LEN];
+    char (*name_storage)[NAME_LEN];
+    HabitStore store;
+    HistoryStore history;
+    HabitStats stats;
+    HabitStreaks streaks;
+    DataStamp disk_stamp;
+    gboolean history_unverified;
+    PersistWorker persist;
+} HabitTracker;
+
+typedef enum {
+    EXPORT_FORMAT_TEXT,
+    EXPORT_FORMAT_CSV,
+    EXPORT_FORMAT_JSON,
+    EXPORT_FORMAT_BINARY
+} ExportFormat;
+
+typedef enum {
+    EXPORT_BY_CELL,
+    EXPORT_BY_HABIT,
+    EXPORT_BY_DAY,
+    EXPORT_BY_WEEK
+} ExportGranularity;
+
+typedef struct {
+    gint64 rows;
+    gint64 invalid;
+    gint64 duplicates;
+    gint64 changed;
+    int habits_created;
+} ImportResult;
+
+typedef enum {
+    IPC_OP_PING = 0,
+    IPC_OP_GET_COUNTS = 1,
+    IPC_OP_GET_CELLS = 2,
+    IPC_OP_GET_NAMES = 3,
+    IPC_OP_SET = 4,
+    IPC_OP_TOGGLE = 5,
+    IPC_OP_SUBSCRIBE = 6,
+    IPC_OP_UNSUBSCRIBE = 7,
+    IPC_EVENT_CHANGED = 0x80
+} IpcOp;
+
+typedef enum {
+    IPC_STATUS_OK = 0,
+    IPC_STATUS_BAD_REQUEST = 1,
+    IPC_STATUS_OUT_OF_RANGE = 2
+} IpcStatus;
+
+typedef struct _IpcServer IpcServer;
+typedef void (*IpcChangedFunc)(gpointer user_data);
+
+typedef struct _TrackerEngine TrackerEngine;
+
+typedef struct {
+    int loaded;
+    int pinned;
+    gsize bytes;
+    gsize budget;
+    guint64 hits;
+    guint64 misses;
+    guint64 evictions;
+} TrackerEngineStats;
+
+typedef struct {
+    char *profile;
+    int habit;
+    char name[NAME_LEN];
+    int checked;
+    int days;
+} ReportEntry;
+
+typedef struct {
+    gint64 profiles;
+    gint64 unreadable;
+    gint64 checked;
+    gint64 cells;
+    double percent_sum;
+    int week_count;
+    gint64 *week_checked;
+    gint64 *week_cells;
+    int k;
+    GArray *top;
+    GArray *bottom;
+} TrackerReport;
+
+typedef void (*ExportProgressFunc)(double fraction, gpointer user_data);
+typedef void (*ExportDoneFunc)(gboolean ok, gboolean cancelled, gpointer user_data);
+
+typedef struct {
+    HabitTracker snapshot;
+    char *path;
+    ExportFormat format;
+    ExportGranularity granularity;
+    GThread *thread;
+    gint cancelled;
+    gint progress_permille;
+    guint progress_source;
+    gboolean ok;
+    ExportProgressFunc progress;
+    ExportDoneFunc done;
+    gpointer user_data;
+} ExportJob;
+
+typedef void (*ImportProgressFunc)(double fraction, gpointer user_data);
+typedef void (*ImportDoneFunc)(gboolean ok, gboolean cancelled, gpointer user_data);
+
+typedef struct {
+    HabitTracker snapshot;
+    HistoryStore base_history;
+    char *base_names;
+    char *path;
+    ImportResult result;
+    GThread *thread;
+    gint cancelled;
+    gint progress_permille;
+    guint progress_source;
+    gboolean ok;
+    ImportProgressFunc progress;
+    ImportDoneFunc done;
+    gpointer user_data;
+} ImportJob;
+
+typedef struct {
+    int days_per_cell;
+    int cell_size;
+} HeatmapZoom;
+
+typedef struct {
+    gint refs;
+    HistoryStore history;
+    int habit_count;
+    int first_day;
+    int end_day;
+    int origin;
+} HeatmapSnapshot;
+
+typedef struct {
+    int habit;
+    int start_day;
+    int end_day;
+    int checked;
+} HeatmapCell;
+
+typedef struct _HeatmapView HeatmapView;
+typedef void (*HeatmapReadyFunc)(gpointer user_data);
+
+int popcount64(guint64 word);
+int lowest_bit64(guint64 word);
+int today_day_number(void);
+void format_day_label(int day_number, char *buf, gsize len);
+
+guint64 *habit_store_row(const HabitStore *store, int habit);
+int habit_store_slot(const HabitStore *store, int day);
+void habit_store_init(HabitStore *store, int habit_count, int day_capacity);
+void habit_store_free(HabitStore *store);
+void habit_store_mask_tail(HabitStore *store);
+void habit_store_clear(HabitStore *store);
+void habit_store_clear_habit(HabitStore *store, int habit);
+gboolean habit_store_get(const HabitStore *store, int habit, int day);
+gboolean habit_store_set(HabitStore *store, int habit, int day, gboolean value);
+int habit_store_count_range(const HabitStore *store, int habit, int start_day, int end_day);
+void habit_store_fill_range(HabitStore *store, int habit, int start_day, int end_day, gboolean value,
+                            GArray *changed);
+void habit_store_advance(HabitStore *store);
+void habit_store_read_row(const HabitStore *store, int habit, guint64 *out);
+
+int day_counts_kernels(const DayCountsKernel **kernels);
+const DayCountsKernel *day_counts_kernel(void);
+void day_counts(const guint64 *words, int rows, int words_per_row, int *counts, int count_len);
+
+void habit_stats_init(HabitStats *stats, int habit_count, int day_capacity);
+void habit_stats_free(HabitStats *stats);
+int habit_stats_day(const HabitStats *stats, int day);
+int habit_stats_prefix(const HabitStats *stats, int day);
+void habit_stats_set_day_count(HabitStats *stats, const HabitStore *store, int day_count);
+void habit_stats_rebuild(HabitStats *stats, const HabitStore *store, int day_count);
+void habit_stats_apply(HabitStats *stats, int habit, int day, int delta);
+void habit_stats_advance(HabitStats *stats, const HabitStore *store);
+
+void habit_streaks_init(HabitStreaks *streaks, int habit_count);
+void habit_streaks_free(HabitStreaks *streaks);
+void habit_streaks_reset(HabitStreaks *streaks, int habit);
+void habit_streaks_apply(HabitStreaks *streaks, int habit, int day, gboolean value);
+const StreakRun *habit_streaks_find(HabitStreaks *streaks, const HistoryStore *hist, int habit, int day);
+int habit_streaks_longest(HabitStreaks *streaks, const HistoryStore *hist, int habit);
+
+HistoryBlock *history_block_new(int habit_count);
+void history_store_init(HistoryStore *hist, int habit_count, int window_days, int cycle_start);
+void history_store_free(HistoryStore *hist);
+void history_store_copy(HistoryStore *dest, const HistoryStore *src);
+void history_store_resize(HistoryStore *hist, int habit_count, int window_days);
+gboolean history_get(const HistoryStore *hist, int habit, int day);
+gboolean history_set(HistoryStore *hist, int habit, int day, gboolean value);
+int history_count_range(const HistoryStore *hist, int habit, int start_day, int end_day);
+void history_clear_range(HistoryStore *hist, int habit, int start_day, int end_day);
+void history_read_window(const HistoryStore *hist, HabitStore *window);
+const guint64 *history_segment_words(const HistoryStore *hist, gint64 index);
+int history_first_day(const HistoryStore *hist, int fallback);
+void history_diff(const HistoryStore *from, const HistoryStore *to, GArray *cells);
+
+gboolean flush_to_disk(FILE *f);
+gboolean write_atomic_binary(const char *file_path, const void *data, size_t item_size, size_t item_count);
+void journal_encode(guint8 *record, JournalOp op, int habit, int day, gboolean value);
+gboolean journal_decode(const guint8 *record, JournalOp *op, int *habit, int *day, gboolean *value);
+gboolean journal_apply(HistoryStore *hist, const guint8 *record);
+gboolean replay_journal(const char *path, HistoryStore *hist);
+gboolean tracker_file_write(const char *path, const HistoryStore *hist, const char *names, int day_count);
+gboolean tracker_file_load(HabitTracker *tracker, GMappedFile *mapping, gboolean verify_history);
+gboolean tracker_file_verify(const char *path, guint64 write_id);
+void data_stamp_read(DataStamp *stamp, const char *tracker_path, const char *journal_path);
+int data_lock_acquire(const char *path, gboolean exclusive);
+void data_lock_release(int fd);
+
+void persist_worker_start(PersistWorker *worker, const HabitTracker *tracker, gboolean snapshot_now);
+GThreadPool *persist_pool_new(int threads);
+void persist_worker_start_pooled(PersistWorker *worker, const HabitTracker *tracker, gboolean snapshot_now,
+                                 GThreadPool *pool);
+void persist_names(PersistWorker *worker, const char *names, int habit_count);
+void persist_history(PersistWorker *worker, const HistoryStore *hist);
+void persist_settings(PersistWorker *worker, int day_count);
+void persist_journal(PersistWorker *worker, JournalOp op, int habit, int day, gboolean value);
+void persist_journal_records(PersistWorker *worker, const guint8 *records, guint length);
+void persist_sync(PersistWorker *worker);
+void persist_watch(PersistWorker *worker, GSourceFunc ready, gpointer user_data);
+TrackerChange *persist_take_change(PersistWorker *worker);
+void tracker_change_free(TrackerChange *change);
+void persist_worker_stop(PersistWorker *worker);
+
+void tracker_init(HabitTracker *tracker, const char *data_dir, int habit_count, int day_capacity);
+void tracker_free(HabitTracker *tracker);
+void tracker_reset_names(HabitTracker *tracker);
+void tracker_resize(HabitTracker *tracker, int habit_count, int day_capacity);
+gboolean tracker_load(HabitTracker *tracker);
+void tracker_start_persistence(HabitTracker *tracker, gboolean snapshot_now);
+void tracker_stop_persistence(HabitTracker *tracker);
+gboolean tracker_get_cell(const HabitTracker *tracker, int habit, int day);
+void tracker_set_cell(HabitTracker *tracker, int habit, int day, gboolean value);
+guint tracker_apply_cells(HabitTracker *tracker, GArray *cells);
+guint tracker_set_range(HabitTracker *tracker, int first_habit, int last_habit, int first_day, int last_day,
+                        gboolean value, GArray *changed);
+void tracker_clear_habit(HabitTracker *tracker, int habit);
+void tracker_start_new_cycle(HabitTracker *tracker);
+void tracker_set_day_count(HabitTracker *tracker, int day_count);
+gboolean tracker_roll_to_today(HabitTracker *tracker);
+void tracker_set_rolling(HabitTracker *tracker, gboolean rolling);
+void tracker_rename_habit(HabitTracker *tracker, int habit, const char *name);
+int tracker_add_habit(HabitTracker *tracker, const char *name);
+void tracker_snapshot(HabitTracker *dest, const HabitTracker *src);
+void tracker_snapshot_rebuild(HabitTracker *snapshot);
+gsize tracker_memory_size(const HabitTracker *tracker);
+void tracker_reload_window(HabitTracker *tracker);
+gboolean tracker_read_disk(HabitTracker *tracker);
+guint tracker_apply_change(HabitTracker *tracker, TrackerChange *change);
+TrackerWatch *tracker_watch_new(HabitTracker *tracker, TrackerChangedFunc changed, gpointer user_data);
+void tracker_watch_free(TrackerWatch *watch);
+gboolean tracker_import(HabitTracker *tracker, const char *path, ImportResult *result);
+ImportJob *import_job_new(const HabitTracker *tracker, const char *path);
+gboolean import_job_run(ImportJob *job);
+void import_job_start(ImportJob *job, ImportProgressFunc progress, ImportDoneFunc done, gpointer user_data);
+void import_job_cancel(ImportJob *job);
+void import_job_apply(ImportJob *job, HabitTracker *tracker);
+void import_job_free(ImportJob *job);
+
+TrackerEngine *tracker_engine_new(const char *root, int habit_count, int day_capacity, gsize budget_bytes);
+HabitTracker *tracker_engine_acquire(TrackerEngine *engine, const char *id);
+void tracker_engine_release(TrackerEngine *engine, HabitTracker *tracker);
+void tracker_engine_get_stats(TrackerEngine *engine, TrackerEngineStats *stats);
+void tracker_engine_free(TrackerEngine *engine);
+
+gboolean tracker_report_run(TrackerReport *report, const char *root, int k, int threads);
+gchar *tracker_report_format(const TrackerReport *report);
+void tracker_report_free(TrackerReport *report);
+
+int tracker_count_checked(const HabitTracker *tracker);
+int tracker_count_checked_for_habit(const HabitTracker *tracker, int habit);
+int tracker_week_count(const HabitTracker *tracker);
+void tracker_week_bounds(const HabitTracker *tracker, int week, int *start_day, int *end_day);
+int tracker_count_checked_in_week(const HabitTracker *tracker, int week);
+double tracker_day_completion_percent(const HabitTracker *tracker, int day);
+double tracker_running_average_percent(const HabitTracker *tracker, int day);
+int tracker_count_range(const HabitTracker *tracker, int habit, int start_day, int end_day);
+const char *day_unit(int days);
+int tracker_archived_check_ins(const HabitTracker *tracker);
+int tracker_current_streak(const HabitTracker *tracker, int habit);
+int tracker_longest_streak(const HabitTracker *tracker, int habit);
+gchar *tracker_format_summary(const HabitTracker *tracker);
+gchar *tracker_format_weekly(const HabitTracker *tracker);
+
+gboolean export_parse_format(const char *name, ExportFormat *format);
+gboolean export_parse_granularity(const char *name, ExportGranularity *granularity);
+const char *export_format_extension(ExportFormat format);
+ExportJob *export_job_new(const HabitTracker *tracker, const char *path,
+                          ExportFormat format, ExportGranularity granularity);
+gboolean export_job_run(ExportJob *job);
+void export_job_start(ExportJob *job, ExportProgressFunc progress, ExportDoneFunc done, gpointer user_data);
+void export_job_cancel(ExportJob *job);
+void export_job_free(ExportJob *job);
+
+int heatmap_zoom_levels(const HeatmapZoom **zooms);
+HeatmapSnapshot *heatmap_snapshot_new(const HabitTracker *tracker);
+HeatmapSnapshot *heatmap_snapshot_ref(HeatmapSnapshot *snapshot);
+void heatmap_snapshot_unref(HeatmapSnapshot *snapshot);
+void heatmap_snapshot_extent(const HeatmapSnapshot *snapshot, int zoom, int *width, int *height);
+gboolean heatmap_snapshot_cell(const HeatmapSnapshot *snapshot, int zoom, int x, int y, HeatmapCell *cell);
+void heatmap_render_tile(const HeatmapSnapshot *snapshot, int zoom, int tx, int ty,
+                         guint32 empty_color, guint32 full_color, guint32 *pixels);
+HeatmapView *heatmap_view_new(int threads, guint32 empty_color, guint32 full_color,
+                              HeatmapReadyFunc ready, gpointer user_data);
+void heatmap_view_set_snapshot(HeatmapView *view, HeatmapSnapshot *snapshot);
+const guint32 *heatmap_view_tile(HeatmapView *view, int zoom, int tx, int ty);
+void heatmap_view_free(HeatmapView *view);
+
+IpcServer *ipc_server_new(HabitTracker *tracker, const char *path, IpcChangedFunc changed, gpointer user_data);
+void ipc_server_notify(IpcServer *server);
+void ipc_server_free(IpcServer *server);
+char *ipc_default_socket_path(void);
+
+extern gint trace_active;
+
+void trace_init(void);
+void trace_name_thread(const char *name);
+void trace_record(const char *name, gint64 start);
+void trace_shutdown(void);
+
+static inline gint64 trace_begin(void)
+{
+    return G_UNLIKELY(trace_active) ? g_get_monotonic_time() : 0;
+}
+
+static inline void trace_end(const char *name, gint64 start)
+{
+    if (G_UNLIKELY(start != 0))
+        trace_record(name, start);
+}
+
+#endif
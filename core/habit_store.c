@@ -0,0 +1,323 @@
+#include "habit_core.h"
+#include <string.h>
+
+int popcount64(guint64 word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(word);
+#else
+    word = word - ((word >> 1) & G_GUINT64_CONSTANT(0x5555555555555555));
+    word = (word & G_GUINT64_CONSTANT(0x3333333333333333)) + ((word >> 2) & G_GUINT64_CONSTANT(0x3333333333333333));
+    word = (word + (word >> 4)) & G_GUINT64_CONSTANT(0x0f0f0f0f0f0f0f0f);
+    return (int)((word * G_GUINT64_CONSTANT(0x0101010101010101)) >> 56);
+#endif
+}
+
+int lowest_bit64(guint64 word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    int bit = 0;
+    while (!(word & 1)) {
+        word >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+guint64 *habit_store_row(const HabitStore *store, int habit)
+{
+    return store->words + (size_t)habit * store->words_per_habit;
+}
+
+/* Rows are rings of `ring_days` bits: logical day 0 lives at bit `head`, and
+ * bits outside the window are kept clear so whole-word counts stay exact. */
+int habit_store_slot(const HabitStore *store, int day)
+{
+    int slot = store->head + day;
+    return slot >= store->ring_days ? slot - store->ring_days : slot;
+}
+
+void habit_store_init(HabitStore *store, int habit_count, int day_capacity)
+{
+    store->habit_count = habit_count;
+    store->day_capacity = day_capacity;
+    store->words_per_habit = (day_capacity + 63) / 64;
+    store->ring_days = store->words_per_habit * 64;
+    store->head = 0;
+    store->words = g_new0(guint64, (size_t)habit_count * store->words_per_habit);
+}
+
+void habit_store_free(HabitStore *store)
+{
+    g_free(store->words);
+    store->words = NULL;
+    store->habit_count = 0;
+    store->day_capacity = 0;
+    store->words_per_habit = 0;
+    store->ring_days = 0;
+    store->head = 0;
+}
+
+/* Only meaningful while `head` is 0, i.e. straight after a window reload. */
+void habit_store_mask_tail(HabitStore *store)
+{
+    if (store->day_capacity % 64 == 0)
+        return;
+
+    guint64 tail_mask = (G_GUINT64_CONSTANT(1) << (store->day_capacity % 64)) - 1;
+    for (int i = 0; i < store->habit_count; i++) {
+        guint64 *last = &habit_store_row(store, i)[store->words_per_habit - 1];
+        if (*last & ~tail_mask)
+            *last &= tail_mask;
+    }
+}
+
+void habit_store_clear(HabitStore *store)
+{
+    memset(store->words, 0, (size_t)store->habit_count * store->words_per_habit * sizeof(guint64));
+    store->head = 0;
+}
+
+void habit_store_clear_habit(HabitStore *store, int habit)
+{
+    memset(habit_store_row(store, habit), 0, store->words_per_habit * sizeof(guint64));
+}
+
+gboolean habit_store_get(const HabitStore *store, int habit, int day)
+{
+    int slot = habit_store_slot(store, day);
+    guint64 word = habit_store_row(store, habit)[slot / 64];
+    return (word >> (slot % 64)) & 1;
+}
+
+gboolean habit_store_set(HabitStore *store, int habit, int day, gboolean value)
+{
+    int slot = habit_store_slot(store, day);
+    guint64 *word = &habit_store_row(store, habit)[slot / 64];
+    guint64 bit = G_GUINT64_CONSTANT(1) << (slot % 64);
+    guint64 old = *word;
+
+    if (value)
+        *word |= bit;
+    else
+        *word &= ~bit;
+    return *word != old;
+}
+
+/* Drops logical day 0 and makes the first free slot the new last day. The
+ * caller must have cleared day 0 first. */
+void habit_store_advance(HabitStore *store)
+{
+    store->head = habit_store_slot(store, 1);
+}
+
+/* Copies one row out in logical order, day 0 in bit 0 of out[0]. */
+void habit_store_read_row(const HabitStore *store, int habit, guint64 *out)
+{
+    const guint64 *row = habit_store_row(store, habit);
+    int first = store->head / 64;
+    int shift = store->head % 64;
+
+    for (int w = 0; w < store->words_per_habit; w++) {
+        int low = first + w;
+        if (low >= store->words_per_habit)
+            low -= store->words_per_habit;
+        int high = (low + 1 == store->words_per_habit) ? 0 : low + 1;
+        out[w] = shift ? (row[low] >> shift) | (row[high] << (64 - shift)) : row[low];
+    }
+}
+
+static int count_slots(const guint64 *row, int start, int end)
+{
+    int first_word = start / 64;
+    int last_word = (end - 1) / 64;
+    guint64 head_mask = ~G_GUINT64_CONSTANT(0) << (start % 64);
+    guint64 tail_mask = ~G_GUINT64_CONSTANT(0) >> (63 - ((end - 1) % 64));
+
+    if (first_word == last_word)
+        return popcount64(row[first_word] & head_mask & tail_mask);
+
+    int count = popcount64(row[first_word] & head_mask);
+    for (int w = first_word + 1; w < last_word; w++)
+        count += popcount64(row[w]);
+    count += popcount64(row[last_word] & tail_mask);
+    return count;
+}
+
+int habit_store_count_range(const HabitStore *store, int habit, int start_day, int end_day)
+{
+    if (start_day < 0)
+        start_day = 0;
+    if (end_day > store->day_capacity)
+        end_day = store->day_capacity;
+    if (start_day >= end_day)
+        return 0;
+
+    const guint64 *row = habit_store_row(store, habit);
+    int start = habit_store_slot(store, start_day);
+    int end = start + (end_day - start_day);
+    if (end <= store->ring_days)
+        return count_slots(row, start, end);
+    return count_slots(row, start, store->ring_days) + count_slots(row, 0, end - store->ring_days);
+}
+
+static void fill_slots(guint64 *row, int start, int end, gboolean value, int habit, int head, int ring_days,
+                       GArray *changed)
+{
+    for (int w = start / 64; w * 64 < end; w++) {
+        int lo = MAX(start, w * 64) - w * 64;
+        int hi = MIN(end, w * 64 + 64) - w * 64;
+        guint64 mask = (~G_GUINT64_CONSTANT(0) << lo) & (~G_GUINT64_CONSTANT(0) >> (64 - hi));
+        guint64 flip = (value ? ~row[w] : row[w]) & mask;
+        row[w] ^= flip;
+
+        while (flip) {
+            int day = w * 64 + lowest_bit64(flip) - head;
+            CellChange cell = { habit, day < 0 ? day + ring_days : day, value };
+            g_array_append_val(changed, cell);
+            flip &= flip - 1;
+        }
+    }
+}
+
+/* Sets days [start_day, end_day) of one habit a word at a time, appending a
+ * CellChange for every cell that actually flipped. */
+void habit_store_fill_range(HabitStore *store, int habit, int start_day, int end_day, gboolean value,
+                            GArray *changed)
+{
+    start_day = MAX(start_day, 0);
+    end_day = MIN(end_day, store->day_capacity);
+    if (start_day >= end_day)
+        return;
+
+    guint64 *row = habit_store_row(store, habit);
+    int start = habit_store_slot(store, start_day);
+    int end = start + (end_day - start_day);
+    if (end <= store->ring_days) {
+        fill_slots(row, start, end, value, habit, store->head, store->ring_days, changed);
+    } else {
+        fill_slots(row, start, store->ring_days, value, habit, store->head, store->ring_days, changed);
+        fill_slots(row, 0, end - store->ring_days, value, habit, store->head, store->ring_days, changed);
+    }
+}
+
+/* per_day and the prefix tree are indexed by store slot, so moving the head
+ * never shifts them. */
+void habit_stats_init(HabitStats *stats, int habit_count, int day_capacity)
+{
+    stats->habit_count = habit_count;
+    stats->day_capacity = day_capacity;
+    stats->ring_days = ((day_capacity + 63) / 64) * 64;
+    stats->head = 0;
+    stats->day_count = 0;
+    stats->total = 0;
+    stats->per_habit = g_new0(int, habit_count);
+    stats->per_day = g_new0(int, stats->ring_days);
+    stats->day_prefix_tree = g_new0(int, stats->ring_days + 1);
+}
+
+void habit_stats_free(HabitStats *stats)
+{
+    g_free(stats->per_habit);
+    g_free(stats->per_day);
+    g_free(stats->day_prefix_tree);
+    stats->per_habit = NULL;
+    stats->per_day = NULL;
+    stats->day_prefix_tree = NULL;
+}
+
+static void habit_stats_build_prefix_tree(HabitStats *stats)
+{
+    int *tree = stats->day_prefix_tree;
+    tree[0] = 0;
+    for (int i = 1; i <= stats->ring_days; i++)
+        tree[i] = stats->per_day[i - 1];
+
+    for (int i = 1; i <= stats->ring_days; i++) {
+        int parent = i + (i & -i);
+        if (parent <= stats->ring_days)
+            tree[parent] += tree[i];
+    }
+}
+
+static int prefix_tree_sum(const HabitStats *stats, int slots)
+{
+    int sum = 0;
+    for (int i = slots; i > 0; i -= i & -i)
+        sum += stats->day_prefix_tree[i];
+    return sum;
+}
+
+static int habit_stats_slot(const HabitStats *stats, int day)
+{
+    int slot = stats->head + day;
+    return slot >= stats->ring_days ? slot - stats->ring_days : slot;
+}
+
+int habit_stats_day(const HabitStats *stats, int day)
+{
+    return stats->per_day[habit_stats_slot(stats, day)];
+}
+
+/* Check-ins on logical days 0..day. */
+int habit_stats_prefix(const HabitStats *stats, int day)
+{
+    if (day >= stats->day_capacity)
+        day = stats->day_capacity - 1;
+    if (day < 0)
+        return 0;
+
+    int end = stats->head + day + 1;
+    if (end <= stats->ring_days)
+        return prefix_tree_sum(stats, end) - prefix_tree_sum(stats, stats->head);
+    return prefix_tree_sum(stats, stats->ring_days) - prefix_tree_sum(stats, stats->head) +
+           prefix_tree_sum(stats, end - stats->ring_days);
+}
+
+void habit_stats_set_day_count(HabitStats *stats, const HabitStore *store, int day_count)
+{
+    stats->day_count = day_count;
+    stats->total = 0;
+    for (int i = 0; i < stats->habit_count; i++) {
+        stats->per_habit[i] = habit_store_count_range(store, i, 0, day_count);
+        stats->total += stats->per_habit[i];
+    }
+}
+
+void habit_stats_rebuild(HabitStats *stats, const HabitStore *store, int day_count)
+{
+    day_counts(store->words, store->habit_count, store->words_per_habit, stats->per_day, stats->ring_days);
+    stats->head = store->head;
+    habit_stats_build_prefix_tree(stats);
+    habit_stats_set_day_count(stats, store, day_count);
+}
+
+void habit_stats_apply(HabitStats *stats, int habit, int day, int delta)
+{
+    int slot = habit_stats_slot(stats, day);
+    stats->per_day[slot] += delta;
+    for (int i = slot + 1; i <= stats->ring_days; i += i & -i)
+        stats->day_prefix_tree[i] += delta;
+    if (day >= stats->day_count)
+        return;
+
+    stats->total += delta;
+    stats->per_habit[habit] += delta;
+}
+
+/* Follows habit_store_advance. Day 0 must already have been applied away;
+ * the day that slides into the counted range is added from `store`. */
+void habit_stats_advance(HabitStats *stats, const HabitStore *store)
+{
+    stats->head = store->head;
+    int entering = stats->day_count - 1;
+    for (int i = 0; i < stats->habit_count; i++) {
+        if (habit_store_get(store, i, entering)) {
+            stats->per_habit[i]++;
+            stats->total++;
+        }
+    }
+}
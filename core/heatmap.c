@@ -0,0 +1,342 @@
+#include "habit_core.h"
+#include <string.h>
+
+#define HEATMAP_ALIGN_DAYS 28
+#define HEATMAP_CACHE_TILES 256
+#define HEATMAP_DIFF_LIMIT 4096
+
+typedef struct {
+    gint64 key;
+    int zoom;
+    int tx;
+    int ty;
+    guint generation;
+    guint rendered_generation;
+    guint32 *pixels;
+    guint done_generation;
+    guint32 *done;
+    gboolean queued;
+    gint last_use;
+    GList link;
+} HeatmapTile;
+
+struct _HeatmapView {
+    GMutex lock;
+    GThreadPool *pool;
+    GHashTable *tiles;
+    GQueue lru;
+    HeatmapSnapshot *snapshot;
+    guint32 empty_color;
+    guint32 full_color;
+    gint clock;
+    guint ready_source;
+    HeatmapReadyFunc ready;
+    gpointer user_data;
+};
+
+static const HeatmapZoom heatmap_zooms[] = {
+    { 1, 16 },
+    { 1, 8 },
+    { 1, 4 },
+    { 7, 4 },
+    { 7, 2 },
+    { 28, 2 },
+};
+
+int heatmap_zoom_levels(const HeatmapZoom **zooms)
+{
+    *zooms = heatmap_zooms;
+    return (int)G_N_ELEMENTS(heatmap_zooms);
+}
+
+/* Copies the tracker's whole history, from the first check-in to the end of
+ * the current window, so tiles can be drawn off the main thread. Columns start
+ * on a Monday that stays put until older check-ins appear. */
+HeatmapSnapshot *heatmap_snapshot_new(const HabitTracker *tracker)
+{
+    HeatmapSnapshot *snapshot = g_new0(HeatmapSnapshot, 1);
+    snapshot->refs = 1;
+    history_store_copy(&snapshot->history, &tracker->history);
+    snapshot->habit_count = tracker->habit_count;
+    snapshot->first_day = history_first_day(&tracker->history, tracker->history.cycle_start);
+    snapshot->end_day = tracker->history.cycle_start + MAX(tracker->day_count, 1);
+    snapshot->origin = snapshot->first_day - (snapshot->first_day - 1) % HEATMAP_ALIGN_DAYS;
+    return snapshot;
+}
+
+HeatmapSnapshot *heatmap_snapshot_ref(HeatmapSnapshot *snapshot)
+{
+    g_atomic_int_inc(&snapshot->refs);
+    return snapshot;
+}
+
+void heatmap_snapshot_unref(HeatmapSnapshot *snapshot)
+{
+    if (!snapshot || !g_atomic_int_dec_and_test(&snapshot->refs))
+        return;
+
+    history_store_free(&snapshot->history);
+    g_free(snapshot);
+}
+
+void heatmap_snapshot_extent(const HeatmapSnapshot *snapshot, int zoom, int *width, int *height)
+{
+    const HeatmapZoom *z = &heatmap_zooms[zoom];
+    int columns = (snapshot->end_day - snapshot->origin + z->days_per_cell - 1) / z->days_per_cell;
+    *width = columns * z->cell_size;
+    *height = snapshot->habit_count * z->cell_size;
+}
+
+/* Fills `cell` with the habit and days under content pixel (`x`, `y`). */
+gboolean heatmap_snapshot_cell(const HeatmapSnapshot *snapshot, int zoom, int x, int y, HeatmapCell *cell)
+{
+    const HeatmapZoom *z = &heatmap_zooms[zoom];
+    if (x < 0 || y < 0)
+        return FALSE;
+
+    int habit = y / z->cell_size;
+    int start = snapshot->origin + (x / z->cell_size) * z->days_per_cell;
+    cell->habit = habit;
+    cell->start_day = MAX(start, snapshot->first_day);
+    cell->end_day = MIN(start + z->days_per_cell, snapshot->end_day);
+    if (habit >= snapshot->habit_count || cell->start_day >= cell->end_day)
+        return FALSE;
+
+    cell->checked = history_count_range(&snapshot->history, habit, cell->start_day, cell->end_day);
+    return TRUE;
+}
+
+static guint32 heatmap_blend(guint32 empty, guint32 full, int checked, int days)
+{
+    guint32 color = 0xff000000u;
+    for (int shift = 0; shift < 24; shift += 8) {
+        int a = (int)((empty >> shift) & 0xff);
+        int b = (int)((full >> shift) & 0xff);
+        color |= (guint32)(a + (b - a) * checked / days) << shift;
+    }
+    return color;
+}
+
+/* Rasterizes tile (`tx`, `ty`) as a square of HEATMAP_TILE_SIZE native-endian ARGB32
+ * pixels. Days outside the snapshot stay transparent; cells of 4 pixels and
+ * up keep a one pixel gap. */
+void heatmap_render_tile(const HeatmapSnapshot *snapshot, int zoom, int tx, int ty,
+                         guint32 empty_color, guint32 full_color, guint32 *pixels)
+{
+    const HeatmapZoom *z = &heatmap_zooms[zoom];
+    int cells = HEATMAP_TILE_SIZE / z->cell_size;
+    int fill = z->cell_size >= 4 ? z->cell_size - 1 : z->cell_size;
+
+    memset(pixels, 0, HEATMAP_TILE_SIZE * HEATMAP_TILE_SIZE * sizeof(guint32));
+    for (int row = 0; row < cells; row++) {
+        int habit = ty * cells + row;
+        if (habit >= snapshot->habit_count)
+            break;
+
+        for (int col = 0; col < cells; col++) {
+            int start = snapshot->origin + (tx * cells + col) * z->days_per_cell;
+            int first = MAX(start, snapshot->first_day);
+            int end = MIN(start + z->days_per_cell, snapshot->end_day);
+            if (first >= end)
+                continue;
+
+            int checked = history_count_range(&snapshot->history, habit, first, end);
+            guint32 color = heatmap_blend(empty_color, full_color, checked, end - first);
+            guint32 *out = pixels + row * z->cell_size * HEATMAP_TILE_SIZE + col * z->cell_size;
+            for (int y = 0; y < fill; y++) {
+                for (int x = 0; x < fill; x++)
+                    out[y * HEATMAP_TILE_SIZE + x] = color;
+            }
+        }
+    }
+}
+
+static gint64 heatmap_tile_key(int zoom, int tx, int ty)
+{
+    return ((gint64)zoom << 56) | ((gint64)ty << 28) | (gint64)tx;
+}
+
+static void heatmap_tile_free(gpointer data)
+{
+    HeatmapTile *tile = data;
+    g_free(tile->pixels);
+    g_free(tile->done);
+    g_free(tile);
+}
+
+static gboolean heatmap_view_ready(gpointer user_data)
+{
+    HeatmapView *view = user_data;
+    g_mutex_lock(&view->lock);
+    view->ready_source = 0;
+    g_mutex_unlock(&view->lock);
+    view->ready(view->user_data);
+    return G_SOURCE_REMOVE;
+}
+
+static void heatmap_render_job(gpointer data, gpointer user_data)
+{
+    HeatmapTile *tile = data;
+    HeatmapView *view = user_data;
+
+    g_mutex_lock(&view->lock);
+    HeatmapSnapshot *snapshot = heatmap_snapshot_ref(view->snapshot);
+    guint generation = tile->generation;
+    guint32 empty_color = view->empty_color;
+    guint32 full_color = view->full_color;
+    g_mutex_unlock(&view->lock);
+
+    gint64 span = trace_begin();
+    guint32 *pixels = g_new(guint32, HEATMAP_TILE_SIZE * HEATMAP_TILE_SIZE);
+    heatmap_render_tile(snapshot, tile->zoom, tile->tx, tile->ty, empty_color, full_color, pixels);
+    heatmap_snapshot_unref(snapshot);
+    trace_end("heatmap_render_tile", span);
+
+    g_mutex_lock(&view->lock);
+    g_free(tile->done);
+    tile->done = pixels;
+    tile->done_generation = generation;
+    tile->queued = FALSE;
+    if (!view->ready_source)
+        view->ready_source = g_idle_add(heatmap_view_ready, view);
+    g_mutex_unlock(&view->lock);
+}
+
+/* Most recently requested tiles first, so panning does not wait behind tiles
+ * that already scrolled out of view. */
+static gint heatmap_job_compare(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+    (void)user_data;
+    gint use_a = g_atomic_int_get(&((const HeatmapTile *)a)->last_use);
+    gint use_b = g_atomic_int_get(&((const HeatmapTile *)b)->last_use);
+    return (use_a < use_b) - (use_a > use_b);
+}
+
+/* Caches tiles of every zoom level and renders missing or outdated ones on
+ * `threads` workers. `ready` runs on the main loop when new pixels wait to be
+ * picked up by heatmap_view_tile. */
+HeatmapView *heatmap_view_new(int threads, guint32 empty_color, guint32 full_color,
+                              HeatmapReadyFunc ready, gpointer user_data)
+{
+    HeatmapView *view = g_new0(HeatmapView, 1);
+    g_mutex_init(&view->lock);
+    view->pool = g_thread_pool_new(heatmap_render_job, view, MAX(threads, 1), FALSE, NULL);
+    g_thread_pool_set_sort_function(view->pool, heatmap_job_compare, NULL);
+    view->tiles = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, heatmap_tile_free);
+    g_queue_init(&view->lru);
+    view->empty_color = empty_color;
+    view->full_color = full_color;
+    view->ready = ready;
+    view->user_data = user_data;
+    return view;
+}
+
+static void heatmap_invalidate_cell(HeatmapView *view, int habit, int day)
+{
+    for (int zoom = 0; zoom < (int)G_N_ELEMENTS(heatmap_zooms); zoom++) {
+        const HeatmapZoom *z = &heatmap_zooms[zoom];
+        int cells = HEATMAP_TILE_SIZE / z->cell_size;
+        gint64 key = heatmap_tile_key(zoom, (day - view->snapshot->origin) / z->days_per_cell / cells, habit / cells);
+        HeatmapTile *tile = g_hash_table_lookup(view->tiles, &key);
+        if (tile)
+            tile->generation++;
+    }
+}
+
+/* Swaps in a newer snapshot. Only tiles holding changed check-ins are redrawn
+ * unless the layout moved; outdated tiles stay on screen until replaced. */
+void heatmap_view_set_snapshot(HeatmapView *view, HeatmapSnapshot *snapshot)
+{
+    HeatmapSnapshot *old = view->snapshot;
+    gboolean all = !old || old->habit_count != snapshot->habit_count || old->origin != snapshot->origin ||
+                   old->first_day != snapshot->first_day || old->end_day != snapshot->end_day;
+    GArray *cells = g_array_new(FALSE, FALSE, sizeof(CellChange));
+    if (!all) {
+        history_diff(&old->history, &snapshot->history, cells);
+        all = cells->len > HEATMAP_DIFF_LIMIT;
+    }
+
+    g_mutex_lock(&view->lock);
+    view->snapshot = heatmap_snapshot_ref(snapshot);
+    if (all) {
+        for (GList *l = view->lru.head; l; l = l->next)
+            ((HeatmapTile *)l->data)->generation++;
+    } else {
+        for (guint i = 0; i < cells->len; i++) {
+            const CellChange *cell = &g_array_index(cells, CellChange, i);
+            if (cell->day >= snapshot->first_day && cell->day < snapshot->end_day)
+                heatmap_invalidate_cell(view, cell->habit, cell->day);
+        }
+    }
+    g_mutex_unlock(&view->lock);
+
+    g_array_free(cells, TRUE);
+    heatmap_snapshot_unref(old);
+}
+
+static void heatmap_view_evict(HeatmapView *view, const HeatmapTile *keep)
+{
+    GList *l = view->lru.tail;
+    while (l && view->lru.length > HEATMAP_CACHE_TILES) {
+        HeatmapTile *tile = l->data;
+        l = l->prev;
+        if (tile->queued || tile == keep)
+            continue;
+        g_queue_unlink(&view->lru, &tile->link);
+        g_hash_table_remove(view->tiles, &tile->key);
+    }
+}
+
+/* The latest pixels of a tile, or NULL while its first render is pending.
+ * Outdated tiles are returned as they are and re-rendered in the background.
+ * Main thread only; the pixels stay valid until the next call. */
+const guint32 *heatmap_view_tile(HeatmapView *view, int zoom, int tx, int ty)
+{
+    gint64 key = heatmap_tile_key(zoom, tx, ty);
+
+    g_mutex_lock(&view->lock);
+    HeatmapTile *tile = g_hash_table_lookup(view->tiles, &key);
+    if (tile) {
+        g_queue_unlink(&view->lru, &tile->link);
+    } else {
+        tile = g_new0(HeatmapTile, 1);
+        tile->key = key;
+        tile->zoom = zoom;
+        tile->tx = tx;
+        tile->ty = ty;
+        tile->generation = 1;
+        tile->link.data = tile;
+        g_hash_table_insert(view->tiles, &tile->key, tile);
+    }
+    g_queue_push_head_link(&view->lru, &tile->link);
+    g_atomic_int_set(&tile->last_use, ++view->clock);
+
+    if (tile->done) {
+        g_free(tile->pixels);
+        tile->pixels = tile->done;
+        tile->rendered_generation = tile->done_generation;
+        tile->done = NULL;
+    }
+    if (tile->rendered_generation != tile->generation && !tile->queued && view->snapshot) {
+        tile->queued = TRUE;
+        g_thread_pool_push(view->pool, tile, NULL);
+    }
+    heatmap_view_evict(view, tile);
+    const guint32 *pixels = tile->pixels;
+    g_mutex_unlock(&view->lock);
+    return pixels;
+}
+
+void heatmap_view_free(HeatmapView *view)
+{
+    if (!view)
+        return;
+
+    g_thread_pool_free(view->pool, TRUE, TRUE);
+    if (view->ready_source)
+        g_source_remove(view->ready_source);
+    g_hash_table_destroy(view->tiles);
+    heatmap_snapshot_unref(view->snapshot);
+    g_mutex_clear(&view->lock);
+    g_free(view);
+}
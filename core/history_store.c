@@ -0,0 +1,285 @@
+#include "habit_core.h"
+#include <string.h>
+
+int today_day_number(void)
+{
+    GDateTime *now = g_date_time_new_now_local();
+    GDate date;
+
+    g_date_clear(&date, 1);
+    g_date_set_dmy(&date, (GDateDay)g_date_time_get_day_of_month(now),
+                   (GDateMonth)g_date_time_get_month(now), (GDateYear)g_date_time_get_year(now));
+    g_date_time_unref(now);
+    return (int)g_date_get_julian(&date);
+}
+
+void format_day_label(int day_number, char *buf, gsize len)
+{
+    GDate date;
+    char month[32];
+
+    g_date_clear(&date, 1);
+    if (day_number > 0)
+        g_date_set_julian(&date, (guint32)day_number);
+    if (g_date_valid(&date) && g_date_strftime(month, sizeof(month), "%b", &date) > 0)
+        g_snprintf(buf, len, "%s %d", month, g_date_get_day(&date));
+    else
+        g_snprintf(buf, len, "#%d", day_number);
+}
+
+HistoryBlock *history_block_new(int habit_count)
+{
+    HistoryBlock *block = g_malloc0(sizeof(HistoryBlock) + (gsize)habit_count * sizeof(guint64));
+    block->refs = 1;
+    return block;
+}
+
+static void history_block_unref(HistoryBlock *block)
+{
+    if (block && g_atomic_int_dec_and_test(&block->refs))
+        g_free(block);
+}
+
+void history_store_init(HistoryStore *hist, int habit_count, int window_days, int cycle_start)
+{
+    hist->habit_count = habit_count;
+    hist->window_days = window_days;
+    hist->cycle_start = cycle_start;
+    hist->rolling = FALSE;
+    hist->segments = g_array_new(FALSE, FALSE, sizeof(HistorySegment));
+    hist->mapping = NULL;
+}
+
+void history_store_free(HistoryStore *hist)
+{
+    if (!hist->segments)
+        return;
+
+    for (guint i = 0; i < hist->segments->len; i++)
+        history_block_unref(g_array_index(hist->segments, HistorySegment, i).block);
+    g_array_free(hist->segments, TRUE);
+    hist->segments = NULL;
+    if (hist->mapping)
+        g_mapped_file_unref(hist->mapping);
+    hist->mapping = NULL;
+}
+
+/* Shares every segment with src; whichever store writes a shared segment
+ * first takes its own copy, so a copy costs one reference per segment. */
+void history_store_copy(HistoryStore *dest, const HistoryStore *src)
+{
+    history_store_init(dest, src->habit_count, src->window_days, src->cycle_start);
+    dest->rolling = src->rolling;
+    g_array_append_vals(dest->segments, src->segments->data, src->segments->len);
+    for (guint i = 0; i < dest->segments->len; i++) {
+        HistorySegment *seg = &g_array_index(dest->segments, HistorySegment, i);
+        if (seg->block)
+            g_atomic_int_inc(&seg->block->refs);
+    }
+    if (src->mapping)
+        dest->mapping = g_mapped_file_ref(src->mapping);
+}
+
+/* Widens every segment to `habit_count` rows; new habits start empty. */
+void history_store_resize(HistoryStore *hist, int habit_count, int window_days)
+{
+    if (habit_count > hist->habit_count) {
+        for (guint i = 0; i < hist->segments->len; i++) {
+            HistorySegment *seg = &g_array_index(hist->segments, HistorySegment, i);
+            HistoryBlock *block = history_block_new(habit_count);
+            memcpy(block->words, seg->words, (gsize)hist->habit_count * sizeof(guint64));
+            history_block_unref(seg->block);
+            seg->block = block;
+            seg->words = block->words;
+        }
+        hist->habit_count = habit_count;
+    }
+    hist->window_days = MAX(hist->window_days, window_days);
+}
+
+static guint history_lower_bound(const HistoryStore *hist, gint64 index)
+{
+    guint lo = 0;
+    guint hi = hist->segments->len;
+
+    while (lo < hi) {
+        guint mid = lo + (hi - lo) / 2;
+        if (g_array_index(hist->segments, HistorySegment, mid).index < index)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+const guint64 *history_segment_words(const HistoryStore *hist, gint64 index)
+{
+    guint pos = history_lower_bound(hist, index);
+    if (pos == hist->segments->len)
+        return NULL;
+
+    const HistorySegment *seg = &g_array_index(hist->segments, HistorySegment, pos);
+    return seg->index == index ? seg->words : NULL;
+}
+
+static guint64 *history_segment_make_writable(HistoryStore *hist, HistorySegment *seg)
+{
+    if (!seg->block || g_atomic_int_get(&seg->block->refs) != 1) {
+        HistoryBlock *block = history_block_new(hist->habit_count);
+        memcpy(block->words, seg->words, (gsize)hist->habit_count * sizeof(guint64));
+        history_block_unref(seg->block);
+        seg->block = block;
+        seg->words = block->words;
+    }
+    return seg->words;
+}
+
+static guint64 *history_writable_words(HistoryStore *hist, gint64 index)
+{
+    guint pos = history_lower_bound(hist, index);
+    if (pos == hist->segments->len || g_array_index(hist->segments, HistorySegment, pos).index != index) {
+        HistoryBlock *block = history_block_new(hist->habit_count);
+        HistorySegment seg = { index, block->words, block };
+        g_array_insert_val(hist->segments, pos, seg);
+    }
+    return history_segment_make_writable(hist, &g_array_index(hist->segments, HistorySegment, pos));
+}
+
+gboolean history_get(const HistoryStore *hist, int habit, int day)
+{
+    const guint64 *words = history_segment_words(hist, day / HISTORY_SEGMENT_DAYS);
+    return words && ((words[habit] >> (day % HISTORY_SEGMENT_DAYS)) & 1);
+}
+
+gboolean history_set(HistoryStore *hist, int habit, int day, gboolean value)
+{
+    if (history_get(hist, habit, day) == !!value)
+        return FALSE;
+
+    guint64 *words = history_writable_words(hist, day / HISTORY_SEGMENT_DAYS);
+    words[habit] ^= G_GUINT64_CONSTANT(1) << (day % HISTORY_SEGMENT_DAYS);
+    return TRUE;
+}
+
+static guint64 history_range_mask(gint64 index, int start_day, int end_day)
+{
+    gint64 base = index * HISTORY_SEGMENT_DAYS;
+    int lo = start_day > base ? (int)(start_day - base) : 0;
+    int hi = end_day < base + HISTORY_SEGMENT_DAYS ? (int)(end_day - base) : HISTORY_SEGMENT_DAYS;
+    guint64 mask = (hi == 64) ? ~G_GUINT64_CONSTANT(0) : (G_GUINT64_CONSTANT(1) << hi) - 1;
+    return mask & (~G_GUINT64_CONSTANT(0) << lo);
+}
+
+int history_count_range(const HistoryStore *hist, int habit, int start_day, int end_day)
+{
+    int count = 0;
+    if (start_day >= end_day)
+        return 0;
+
+    for (guint i = history_lower_bound(hist, start_day / HISTORY_SEGMENT_DAYS); i < hist->segments->len; i++) {
+        const HistorySegment *seg = &g_array_index(hist->segments, HistorySegment, i);
+        if (seg->index * HISTORY_SEGMENT_DAYS >= end_day)
+            break;
+        count += popcount64(seg->words[habit] & history_range_mask(seg->index, start_day, end_day));
+    }
+    return count;
+}
+
+void history_clear_range(HistoryStore *hist, int habit, int start_day, int end_day)
+{
+    int first = habit < 0 ? 0 : habit;
+    int last = habit < 0 ? hist->habit_count : habit + 1;
+    if (start_day >= end_day)
+        return;
+
+    for (guint i = history_lower_bound(hist, start_day / HISTORY_SEGMENT_DAYS); i < hist->segments->len; i++) {
+        HistorySegment *seg = &g_array_index(hist->segments, HistorySegment, i);
+        if (seg->index * HISTORY_SEGMENT_DAYS >= end_day)
+            break;
+
+        guint64 mask = history_range_mask(seg->index, start_day, end_day);
+        for (int h = first; h < last; h++) {
+            if (seg->words[h] & mask)
+                history_segment_make_writable(hist, seg)[h] &= ~mask;
+        }
+    }
+}
+
+int history_first_day(const HistoryStore *hist, int fallback)
+{
+    for (guint i = 0; i < hist->segments->len; i++) {
+        const HistorySegment *seg = &g_array_index(hist->segments, HistorySegment, i);
+        guint64 any = 0;
+        for (int h = 0; h < hist->habit_count; h++)
+            any |= seg->words[h];
+        if (any) {
+            int day = (int)(seg->index * HISTORY_SEGMENT_DAYS) + lowest_bit64(any);
+            return MIN(day, fallback);
+        }
+    }
+    return fallback;
+}
+
+static void history_diff_words(const HistoryStore *from_hist, const guint64 *from,
+                               const HistoryStore *to_hist, const guint64 *to, gint64 index, GArray *cells)
+{
+    int habit_count = MAX(from_hist->habit_count, to_hist->habit_count);
+    for (int h = 0; h < habit_count; h++) {
+        guint64 a = (from && h < from_hist->habit_count) ? from[h] : 0;
+        guint64 b = (to && h < to_hist->habit_count) ? to[h] : 0;
+        for (guint64 diff = a ^ b; diff; diff &= diff - 1) {
+            int bit = lowest_bit64(diff);
+            CellChange cell = { h, (int)(index * HISTORY_SEGMENT_DAYS) + bit, (int)((b >> bit) & 1) };
+            g_array_append_val(cells, cell);
+        }
+    }
+}
+
+/* Appends every cell whose value differs, with its value in `to`. Habits
+ * only one side has count as empty on the other. */
+void history_diff(const HistoryStore *from, const HistoryStore *to, GArray *cells)
+{
+    guint i = 0;
+    guint j = 0;
+
+    while (i < from->segments->len || j < to->segments->len) {
+        const HistorySegment *a = i < from->segments->len ? &g_array_index(from->segments, HistorySegment, i) : NULL;
+        const HistorySegment *b = j < to->segments->len ? &g_array_index(to->segments, HistorySegment, j) : NULL;
+
+        if (a && (!b || a->index < b->index)) {
+            history_diff_words(from, a->words, to, NULL, a->index, cells);
+            i++;
+        } else if (b && (!a || b->index < a->index)) {
+            history_diff_words(from, NULL, to, b->words, b->index, cells);
+            j++;
+        } else {
+            if (a->words != b->words)
+                history_diff_words(from, a->words, to, b->words, a->index, cells);
+            i++;
+            j++;
+        }
+    }
+}
+
+void history_read_window(const HistoryStore *hist, HabitStore *window)
+{
+    habit_store_clear(window);
+    for (int w = 0; w < window->words_per_habit; w++) {
+        int first_day = hist->cycle_start + w * 64;
+        int shift = first_day % HISTORY_SEGMENT_DAYS;
+        const guint64 *low = history_segment_words(hist, first_day / HISTORY_SEGMENT_DAYS);
+        const guint64 *high = shift ? history_segment_words(hist, first_day / HISTORY_SEGMENT_DAYS + 1) : NULL;
+        if (!low && !high)
+            continue;
+
+        for (int h = 0; h < window->habit_count && h < hist->habit_count; h++) {
+            guint64 word = 0;
+            if (low)
+                word |= low[h] >> shift;
+            if (high)
+                word |= high[h] << (64 - shift);
+            habit_store_row(window, h)[w] = word;
+        }
+    }
+    habit_store_mask_tail(window);
+}
@@ -0,0 +1,767 @@
+#include "habit_core.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define IMPORT_MIN_CHUNK_BYTES (256 * 1024)
+#define IMPORT_CHUNKS_PER_THREAD 4
+#define IMPORT_MAX_FIELDS 16
+#define IMPORT_PROGRESS_MS 100
+#define IMPORT_PARSE_PERMILLE 900
+
+typedef struct {
+    int date;
+    int habit_name;
+    int habit_index;
+    int checked;
+    gboolean has_header;
+} ImportColumns;
+
+typedef struct {
+    int day;
+    int habit;
+    gboolean value;
+} ImportRecord;
+
+typedef struct {
+    const char *start;
+    const char *end;
+} ImportSpan;
+
+typedef struct {
+    ImportJob *job;
+    gint *chunks_done;
+    int chunk_count;
+    const char *start;
+    const char *end;
+    const ImportColumns *columns;
+    GArray *objects;
+    guint first_object;
+    guint end_object;
+    int end_day;
+    int habit_count;
+    GArray *records;
+    GPtrArray *names;
+    GHashTable *name_ids;
+    gint64 rows;
+    gint64 invalid;
+} ImportChunk;
+
+static gboolean parse_import_date(const char *text, int *day)
+{
+    int y, m, d;
+    char tail;
+    if (sscanf(text, "%4d-%2d-%2d%c", &y, &m, &d, &tail) != 3 ||
+        !g_date_valid_dmy((GDateDay)d, (GDateMonth)m, (GDateYear)y))
+        return FALSE;
+
+    GDate date;
+    g_date_clear(&date, 1);
+    g_date_set_dmy(&date, (GDateDay)d, (GDateMonth)m, (GDateYear)y);
+    *day = (int)g_date_get_julian(&date);
+    return TRUE;
+}
+
+static gboolean parse_import_value(const char *text, gboolean *value)
+{
+    static const char *const on[] = { "1", "true", "on", "yes", "x" };
+    static const char *const off[] = { "0", "false", "off", "no", "" };
+
+    for (guint i = 0; i < G_N_ELEMENTS(on); i++) {
+        if (g_ascii_strcasecmp(text, on[i]) == 0) {
+            *value = TRUE;
+            return TRUE;
+        }
+        if (g_ascii_strcasecmp(text, off[i]) == 0) {
+            *value = FALSE;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static gboolean parse_import_index(const char *text, int habit_count, int *habit)
+{
+    char *end = NULL;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || value < 1 || value > habit_count)
+        return FALSE;
+    *habit = (int)value - 1;
+    return TRUE;
+}
+
+static int chunk_name_id(ImportChunk *chunk, const char *name)
+{
+    gpointer id = g_hash_table_lookup(chunk->name_ids, name);
+    if (id)
+        return GPOINTER_TO_INT(id) - 1;
+
+    char *copy = g_strdup(name);
+    g_ptr_array_add(chunk->names, copy);
+    g_hash_table_insert(chunk->name_ids, copy, GINT_TO_POINTER((int)chunk->names->len));
+    return (int)chunk->names->len - 1;
+}
+
+static void chunk_add_row(ImportChunk *chunk, const char *date, const char *habit_name,
+                          const char *habit_index, const char *checked)
+{
+    ImportRecord record;
+    chunk->rows++;
+
+    if (!date || !parse_import_date(date, &record.day) ||
+        record.day >= chunk->end_day ||
+        !parse_import_value(checked ? checked : "1", &record.value)) {
+        chunk->invalid++;
+        return;
+    }
+
+    int index;
+    if (habit_index && parse_import_index(habit_index, chunk->habit_count, &index)) {
+        record.habit = -1 - index;
+    } else if (habit_name && habit_name[0] != '\0' && strlen(habit_name) < NAME_LEN) {
+        record.habit = chunk_name_id(chunk, habit_name);
+    } else {
+        chunk->invalid++;
+        return;
+    }
+
+    g_array_append_val(chunk->records, record);
+}
+
+static int split_csv_line(char *line, char **fields)
+{
+    int count = 0;
+    char *p = line;
+
+    while (count < IMPORT_MAX_FIELDS) {
+        while (*p == ' ' || *p == '\t')
+            p++;
+
+        char *out = p;
+        fields[count++] = p;
+        if (*p == '"') {
+            char *in = p + 1;
+            while (*in) {
+                if (in[0] == '"' && in[1] == '"') {
+                    *out++ = '"';
+                    in += 2;
+                } else if (in[0] == '"') {
+                    in++;
+                    break;
+                } else {
+                    *out++ = *in++;
+                }
+            }
+            while (*in && *in != ',')
+                in++;
+            gboolean more = *in == ',';
+            *out = '\0';
+            if (!more)
+                break;
+            p = in + 1;
+        } else {
+            char *comma = strchr(p, ',');
+            if (comma)
+                *comma = '\0';
+            g_strchomp(p);
+            if (!comma)
+                break;
+            p = comma + 1;
+        }
+    }
+    return count;
+}
+
+static const char *csv_field(char **fields, int count, int column)
+{
+    return (column >= 0 && column < count) ? fields[column] : NULL;
+}
+
+static void parse_csv_chunk(ImportChunk *chunk)
+{
+    const ImportColumns *cols = chunk->columns;
+    const char *p = chunk->start;
+    GString *line = g_string_new(NULL);
+    char *fields[IMPORT_MAX_FIELDS];
+
+    while (p < chunk->end) {
+        const char *eol = memchr(p, '\n', (size_t)(chunk->end - p));
+        const char *next = eol ? eol + 1 : chunk->end;
+        if (!eol)
+            eol = chunk->end;
+        if (eol > p && eol[-1] == '\r')
+            eol--;
+
+        g_string_assign(line, "");
+        g_string_append_len(line, p, eol - p);
+        p = next;
+        if (line->len == 0)
+            continue;
+
+        int count = split_csv_line(line->str, fields);
+        const char *habit = csv_field(fields, count, cols->habit_name);
+        const char *index = csv_field(fields, count, cols->habit_index);
+        chunk_add_row(chunk, csv_field(fields, count, cols->date), habit, index,
+                      csv_field(fields, count, cols->checked));
+    }
+
+    g_string_free(line, TRUE);
+}
+
+static const char *json_skip_space(const char *p, const char *end)
+{
+    while (p < end && g_ascii_isspace(*p))
+        p++;
+    return p;
+}
+
+static const char *json_read_string(const char *p, const char *end, GString *out)
+{
+    g_string_assign(out, "");
+    for (p++; p < end && *p != '"'; p++) {
+        if (*p != '\\' || p + 1 >= end) {
+            g_string_append_c(out, *p);
+            continue;
+        }
+
+        p++;
+        switch (*p) {
+        case 'n':
+            g_string_append_c(out, '\n');
+            break;
+        case 't':
+            g_string_append_c(out, '\t');
+            break;
+        case 'u':
+            if (p + 4 < end) {
+                char hex[5] = { p[1], p[2], p[3], p[4], '\0' };
+                g_string_append_unichar(out, (gunichar)strtoul(hex, NULL, 16));
+                p += 4;
+            }
+            break;
+        default:
+            g_string_append_c(out, *p);
+            break;
+        }
+    }
+    return p < end ? p + 1 : end;
+}
+
+static const char *json_read_scalar(const char *p, const char *end, GString *out)
+{
+    if (*p == '"')
+        return json_read_string(p, end, out);
+
+    const char *start = p;
+    while (p < end && *p != ',' && *p != '}' && !g_ascii_isspace(*p))
+        p++;
+    g_string_assign(out, "");
+    g_string_append_len(out, start, p - start);
+    return p;
+}
+
+static void parse_json_object(ImportChunk *chunk, const char *p, const char *end,
+                              GString *key, GString *value, GString **fields)
+{
+    for (int i = 0; i < 3; i++)
+        g_string_assign(fields[i], "");
+    gboolean seen[3] = { FALSE, FALSE, FALSE };
+    gboolean has_index = FALSE;
+    GString *index = fields[3];
+
+    p++;
+    while (p < end) {
+        p = json_skip_space(p, end);
+        if (p >= end || *p == '}')
+            break;
+        if (*p != '"') {
+            p++;
+            continue;
+        }
+
+        p = json_read_string(p, end, key);
+        p = json_skip_space(p, end);
+        if (p < end && *p == ':')
+            p = json_skip_space(p + 1, end);
+        p = json_read_scalar(p, end, value);
+        p = json_skip_space(p, end);
+        if (p < end && *p == ',')
+            p++;
+
+        if (g_str_equal(key->str, "date")) {
+            g_string_assign(fields[0], value->str);
+            seen[0] = TRUE;
+        } else if (g_str_equal(key->str, "habit")) {
+            g_string_assign(fields[1], value->str);
+            seen[1] = TRUE;
+        } else if (g_str_equal(key->str, "checked")) {
+            g_string_assign(fields[2], value->str);
+            seen[2] = TRUE;
+        } else if (g_str_equal(key->str, "habit_index")) {
+            g_string_assign(index, value->str);
+            has_index = TRUE;
+        }
+    }
+
+    chunk_add_row(chunk, seen[0] ? fields[0]->str : NULL, seen[1] ? fields[1]->str : NULL,
+                  has_index ? index->str : NULL, seen[2] ? fields[2]->str : NULL);
+}
+
+static void parse_json_chunk(ImportChunk *chunk)
+{
+    GString *key = g_string_new(NULL);
+    GString *value = g_string_new(NULL);
+    GString *fields[4] = { g_string_new(NULL), g_string_new(NULL), g_string_new(NULL), g_string_new(NULL) };
+
+    for (guint i = chunk->first_object; i < chunk->end_object; i++) {
+        const ImportSpan *object = &g_array_index(chunk->objects, ImportSpan, i);
+        parse_json_object(chunk, object->start, object->end, key, value, fields);
+    }
+
+    g_string_free(key, TRUE);
+    g_string_free(value, TRUE);
+    for (int i = 0; i < 4; i++)
+        g_string_free(fields[i], TRUE);
+}
+
+static void parse_chunk(gpointer data, gpointer user_data)
+{
+    ImportChunk *chunk = data;
+    (void)user_data;
+
+    if (g_atomic_int_get(&chunk->job->cancelled))
+        return;
+
+    gint64 span = trace_begin();
+    if (chunk->objects)
+        parse_json_chunk(chunk);
+    else
+        parse_csv_chunk(chunk);
+    trace_end("import_parse_chunk", span);
+
+    int done = g_atomic_int_add(chunk->chunks_done, 1) + 1;
+    g_atomic_int_set(&chunk->job->progress_permille, done * IMPORT_PARSE_PERMILLE / chunk->chunk_count);
+}
+
+static GArray *find_json_objects(const char *data, const char *end)
+{
+    GArray *objects = g_array_new(FALSE, FALSE, sizeof(ImportSpan));
+    ImportSpan object = { NULL, NULL };
+    gboolean in_string = FALSE;
+    gboolean nested = FALSE;
+
+    for (const char *p = data; p < end; p++) {
+        if (in_string) {
+            if (*p == '\\')
+                p++;
+            else if (*p == '"')
+                in_string = FALSE;
+            continue;
+        }
+
+        switch (*p) {
+        case '"':
+            in_string = TRUE;
+            break;
+        case '{':
+            object.start = p;
+            nested = FALSE;
+            break;
+        case '[':
+            nested = TRUE;
+            break;
+        case '}':
+            if (object.start && !nested) {
+                object.end = p;
+                g_array_append_val(objects, object);
+            }
+            object.start = NULL;
+            break;
+        default:
+            break;
+        }
+    }
+    return objects;
+}
+
+static GArray *split_csv_rows(const char *data, const char *end, int chunk_count)
+{
+    GArray *spans = g_array_new(FALSE, FALSE, sizeof(ImportSpan));
+    size_t target = (size_t)(end - data) / (size_t)chunk_count + 1;
+
+    while (data < end) {
+        ImportSpan span = { data, (size_t)(end - data) > target ? data + target : end };
+        if (span.end < end) {
+            const char *eol = memchr(span.end, '\n', (size_t)(end - span.end));
+            span.end = eol ? eol + 1 : end;
+        }
+        g_array_append_val(spans, span);
+        data = span.end;
+    }
+    return spans;
+}
+
+static const char *read_csv_header(const char *data, const char *end, ImportColumns *cols)
+{
+    const char *eol = memchr(data, '\n', (size_t)(end - data));
+    gchar *line = g_strndup(data, eol ? (gsize)(eol - data) : (gsize)(end - data));
+    g_strchomp(line);
+
+    char *fields[IMPORT_MAX_FIELDS];
+    int count = split_csv_line(line, fields);
+    int day;
+
+    cols->date = 0;
+    cols->habit_name = 1;
+    cols->habit_index = 1;
+    cols->checked = 2;
+    cols->has_header = count > 0 && !parse_import_date(fields[0], &day);
+
+    if (cols->has_header) {
+        cols->date = cols->habit_name = cols->habit_index = cols->checked = -1;
+        for (int i = 0; i < count; i++) {
+            if (g_ascii_strcasecmp(fields[i], "date") == 0)
+                cols->date = i;
+            else if (g_ascii_strcasecmp(fields[i], "habit") == 0)
+                cols->habit_name = i;
+            else if (g_ascii_strcasecmp(fields[i], "habit_index") == 0)
+                cols->habit_index = i;
+            else if (g_ascii_strcasecmp(fields[i], "checked") == 0)
+                cols->checked = i;
+        }
+    }
+
+    g_free(line);
+    if (!cols->has_header)
+        return data;
+    return eol ? eol + 1 : end;
+}
+
+static gboolean habit_slot_is_free(const HabitTracker *tracker, int habit)
+{
+    char default_name[NAME_LEN];
+    g_snprintf(default_name, sizeof(default_name), "Habit %d", habit + 1);
+    return g_str_equal(tracker->names[habit], default_name) &&
+           history_count_range(&tracker->history, habit, 0, G_MAXINT) == 0;
+}
+
+/* Matches `name` to a habit: an existing one with that name, else an
+ * unused "Habit N" slot, else a new habit appended after the others.
+ * Returns -1 once the tracker is full. */
+static int resolve_habit_name(HabitTracker *tracker, GHashTable *resolved, const char *name,
+                              gboolean *claimed, GPtrArray *added, ImportResult *result)
+{
+    gpointer found;
+    if (g_hash_table_lookup_extended(resolved, name, NULL, &found))
+        return GPOINTER_TO_INT(found);
+
+    int habit = -1;
+    for (int i = 0; i < tracker->habit_count && habit < 0; i++) {
+        if (g_str_equal(tracker->names[i], name))
+            habit = i;
+    }
+    for (int i = 0; i < tracker->habit_count && habit < 0; i++) {
+        if (!claimed[i] && habit_slot_is_free(tracker, i)) {
+            g_strlcpy(tracker->names[i], name, NAME_LEN);
+            result->habits_created++;
+            habit = i;
+        }
+    }
+    if (habit >= 0) {
+        claimed[habit] = TRUE;
+    } else if (tracker->habit_count + (int)added->len < MAX_HABIT_COUNT) {
+        habit = tracker->habit_count + (int)added->len;
+        g_ptr_array_add(added, g_strdup(name));
+    } else {
+        g_warning("a tracker holds at most %d habits, skipping the rows for '%s'", MAX_HABIT_COUNT, name);
+    }
+
+    g_hash_table_insert(resolved, g_strdup(name), GINT_TO_POINTER(habit));
+    return habit;
+}
+
+static void commit_chunks(HabitTracker *tracker, ImportChunk *chunks, int chunk_count, ImportResult *result)
+{
+    GHashTable *resolved = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    GPtrArray *added = g_ptr_array_new_with_free_func(g_free);
+    gboolean *claimed = g_new0(gboolean, tracker->habit_count);
+    int **habit_maps = g_new0(int *, chunk_count);
+
+    for (int c = 0; c < chunk_count; c++) {
+        for (guint r = 0; r < chunks[c].records->len; r++) {
+            const ImportRecord *record = &g_array_index(chunks[c].records, ImportRecord, r);
+            if (record->habit < 0)
+                claimed[-1 - record->habit] = TRUE;
+        }
+    }
+    for (int c = 0; c < chunk_count; c++) {
+        habit_maps[c] = g_new(int, chunks[c].names->len + 1);
+        for (guint n = 0; n < chunks[c].names->len; n++)
+            habit_maps[c][n] = resolve_habit_name(tracker, resolved, g_ptr_array_index(chunks[c].names, n),
+                                                  claimed, added, result);
+        result->rows += chunks[c].rows;
+        result->invalid += chunks[c].invalid;
+    }
+
+    if (added->len > 0) {
+        int first = tracker->habit_count;
+        tracker_resize(tracker, first + (int)added->len, 0);
+        for (guint i = 0; i < added->len; i++)
+            g_strlcpy(tracker->names[first + (int)i], g_ptr_array_index(added, i), NAME_LEN);
+        result->habits_created += (int)added->len;
+    }
+
+    /* Walk the rows backwards so the last row for a cell wins and earlier ones count as duplicates. */
+    HistoryStore seen;
+    history_store_init(&seen, tracker->habit_count, tracker->day_capacity, tracker->history.cycle_start);
+    for (int c = chunk_count - 1; c >= 0; c--) {
+        for (guint r = chunks[c].records->len; r-- > 0;) {
+            const ImportRecord *record = &g_array_index(chunks[c].records, ImportRecord, r);
+            int habit = record->habit < 0 ? -1 - record->habit : habit_maps[c][record->habit];
+            if (habit < 0)
+                result->invalid++;
+            else if (!history_set(&seen, habit, record->day, TRUE))
+                result->duplicates++;
+            else if (history_set(&tracker->history, habit, record->day, record->value))
+                result->changed++;
+            else
+                result->duplicates++;
+        }
+        g_free(habit_maps[c]);
+    }
+    history_store_free(&seen);
+
+    g_free(habit_maps);
+    g_free(claimed);
+    g_ptr_array_free(added, TRUE);
+    g_hash_table_destroy(resolved);
+}
+
+ImportJob *import_job_new(const HabitTracker *tracker, const char *path)
+{
+    ImportJob *job = g_new0(ImportJob, 1);
+    tracker_snapshot(&job->snapshot, tracker);
+    history_store_copy(&job->base_history, &tracker->history);
+    job->base_names = g_memdup2(tracker->names, (gsize)tracker->habit_count * NAME_LEN);
+    job->path = g_strdup(path);
+    return job;
+}
+
+/* Parses the file and merges it into the job's snapshot; the live tracker
+ * is untouched until import_job_apply. */
+gboolean import_job_run(ImportJob *job)
+{
+    HabitTracker *tracker = &job->snapshot;
+    ImportResult *result = &job->result;
+    memset(result, 0, sizeof(*result));
+
+    GError *error = NULL;
+    GMappedFile *mapping = g_mapped_file_new(job->path, FALSE, &error);
+    if (!mapping) {
+        g_warning("could not open %s: %s", job->path, error->message);
+        g_error_free(error);
+        job->ok = FALSE;
+        return FALSE;
+    }
+
+    gint64 span = trace_begin();
+    const char *data = g_mapped_file_get_contents(mapping);
+    const char *end = data + g_mapped_file_get_length(mapping);
+    const char *body = json_skip_space(data, end);
+    gboolean json = body < end && (*body == '[' || *body == '{');
+
+    ImportColumns columns = { 0 };
+    if (!json && body < end)
+        body = read_csv_header(body, end, &columns);
+    if (!json && columns.has_header && (columns.date < 0 || (columns.habit_name < 0 && columns.habit_index < 0))) {
+        g_warning("%s: the CSV header needs a date and a habit or habit_index column", job->path);
+        g_mapped_file_unref(mapping);
+        trace_end("import_job_run", span);
+        job->ok = FALSE;
+        return FALSE;
+    }
+
+    int threads = MAX(1, (int)g_get_num_processors());
+    int chunk_count = CLAMP((int)((end - body) / IMPORT_MIN_CHUNK_BYTES), 1, threads * IMPORT_CHUNKS_PER_THREAD);
+    GArray *spans = NULL;
+    GArray *objects = NULL;
+    if (json) {
+        objects = find_json_objects(body, end);
+        chunk_count = MIN(chunk_count, MAX((int)objects->len, 1));
+    } else {
+        spans = split_csv_rows(body, end, chunk_count);
+        chunk_count = MAX((int)spans->len, 1);
+    }
+
+    gint chunks_done = 0;
+    ImportChunk *chunks = g_new0(ImportChunk, chunk_count);
+    GThreadPool *pool = g_thread_pool_new(parse_chunk, NULL, MIN(threads, chunk_count), FALSE, NULL);
+    for (int c = 0; c < chunk_count; c++) {
+        ImportChunk *chunk = &chunks[c];
+        chunk->job = job;
+        chunk->chunks_done = &chunks_done;
+        chunk->chunk_count = chunk_count;
+        if (objects) {
+            chunk->objects = objects;
+            chunk->first_object = (guint)((guint64)objects->len * (guint)c / (guint)chunk_count);
+            chunk->end_object = (guint)((guint64)objects->len * (guint)(c + 1) / (guint)chunk_count);
+        } else if (spans->len > 0) {
+            chunk->start = g_array_index(spans, ImportSpan, c).start;
+            chunk->end = g_array_index(spans, ImportSpan, c).end;
+        }
+        chunk->columns = &columns;
+        chunk->end_day = tracker->history.cycle_start + tracker->day_count;
+        chunk->habit_count = tracker->habit_count;
+        chunk->records = g_array_new(FALSE, FALSE, sizeof(ImportRecord));
+        chunk->names = g_ptr_array_new_with_free_func(g_free);
+        chunk->name_ids = g_hash_table_new(g_str_hash, g_str_equal);
+        g_thread_pool_push(pool, chunk, NULL);
+    }
+    g_thread_pool_free(pool, FALSE, TRUE);
+
+    gboolean ok = !g_atomic_int_get(&job->cancelled);
+    if (ok) {
+        gint64 merge_span = trace_begin();
+        commit_chunks(tracker, chunks, chunk_count, result);
+        trace_end("import_merge", merge_span);
+    }
+
+    for (int c = 0; c < chunk_count; c++) {
+        g_array_free(chunks[c].records, TRUE);
+        g_hash_table_destroy(chunks[c].name_ids);
+        g_ptr_array_free(chunks[c].names, TRUE);
+    }
+    g_free(chunks);
+    if (spans)
+        g_array_free(spans, TRUE);
+    if (objects)
+        g_array_free(objects, TRUE);
+    g_mapped_file_unref(mapping);
+
+    trace_end("import_job_run", span);
+    g_atomic_int_set(&job->progress_permille, 1000);
+    job->ok = ok;
+    return ok;
+}
+
+/* Applies a finished job to `tracker`, which may have been edited (or grown
+ * by another instance) while the job ran.  Untouched trackers adopt the
+ * imported history outright; otherwise only the cells the import changed are
+ * replayed, with habits the import created appended after the live ones. */
+void import_job_apply(ImportJob *job, HabitTracker *tracker)
+{
+    HabitTracker *imported = &job->snapshot;
+    int base_count = job->base_history.habit_count;
+    int offset = tracker->habit_count - base_count;
+    if (!job->ok)
+        return;
+
+    gint64 span = trace_begin();
+    gboolean names_changed = job->result.habits_created > 0;
+    if (imported->habit_count > base_count)
+        tracker_resize(tracker, tracker->habit_count + imported->habit_count - base_count, 0);
+    for (int i = 0; i < base_count && names_changed; i++) {
+        const char *base_name = job->base_names + (gsize)i * NAME_LEN;
+        if (!g_str_equal(imported->names[i], base_name) && g_str_equal(tracker->names[i], base_name))
+            g_strlcpy(tracker->names[i], imported->names[i], NAME_LEN);
+    }
+    for (int i = base_count; i < imported->habit_count; i++)
+        g_strlcpy(tracker->names[i + offset], imported->names[i], NAME_LEN);
+
+    if (job->result.changed > 0) {
+        GArray *cells = g_array_new(FALSE, FALSE, sizeof(CellChange));
+        gboolean untouched = offset == 0 && tracker->history.cycle_start == job->base_history.cycle_start;
+        if (untouched)
+            history_diff(&job->base_history, &tracker->history, cells);
+        if (untouched && cells->len == 0) {
+            TrackerChange change = { .cells = cells, .habit_count = tracker->habit_count,
+                                     .history = &imported->history };
+            tracker_apply_change(tracker, &change);
+        } else {
+            g_array_set_size(cells, 0);
+            history_diff(&job->base_history, &imported->history, cells);
+            for (guint i = 0; i < cells->len; i++) {
+                const CellChange *cell = &g_array_index(cells, CellChange, i);
+                int habit = cell->habit < base_count ? cell->habit : cell->habit + offset;
+                history_set(&tracker->history, habit, cell->day, cell->value);
+            }
+            tracker_reload_window(tracker);
+        }
+        g_array_free(cells, TRUE);
+        persist_history(&tracker->persist, &tracker->history);
+    }
+    if (names_changed)
+        persist_names(&tracker->persist, (const char *)tracker->names, tracker->habit_count);
+    trace_end("import_job_apply", span);
+}
+
+static gboolean import_report_progress(gpointer user_data)
+{
+    ImportJob *job = user_data;
+    job->progress(g_atomic_int_get(&job->progress_permille) / 1000.0, job->user_data);
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean import_report_done(gpointer user_data)
+{
+    ImportJob *job = user_data;
+    g_thread_join(job->thread);
+    job->thread = NULL;
+    if (job->progress_source) {
+        g_source_remove(job->progress_source);
+        job->progress_source = 0;
+    }
+    if (job->done)
+        job->done(job->ok, g_atomic_int_get(&job->cancelled), job->user_data);
+    return G_SOURCE_REMOVE;
+}
+
+static gpointer import_job_main(gpointer user_data)
+{
+    ImportJob *job = user_data;
+    trace_name_thread("import");
+    gint64 span = trace_begin();
+    import_job_run(job);
+    trace_end("import_job", span);
+    g_idle_add(import_report_done, job);
+    return NULL;
+}
+
+void import_job_start(ImportJob *job, ImportProgressFunc progress, ImportDoneFunc done, gpointer user_data)
+{
+    job->progress = progress;
+    job->done = done;
+    job->user_data = user_data;
+    job->thread = g_thread_new("import", import_job_main, job);
+    if (progress)
+        job->progress_source = g_timeout_add(IMPORT_PROGRESS_MS, import_report_progress, job);
+}
+
+void import_job_cancel(ImportJob *job)
+{
+    g_atomic_int_set(&job->cancelled, 1);
+}
+
+void import_job_free(ImportJob *job)
+{
+    if (job->thread) {
+        import_job_cancel(job);
+        g_thread_join(job->thread);
+        while (g_source_remove_by_user_data(job))
+            ;
+    }
+    tracker_free(&job->snapshot);
+    history_store_free(&job->base_history);
+    g_free(job->base_names);
+    g_free(job->path);
+    g_free(job);
+}
+
+gboolean tracker_import(HabitTracker *tracker, const char *path, ImportResult *result)
+{
+    ImportJob *job = import_job_new(tracker, path);
+    gboolean ok = import_job_run(job);
+    import_job_apply(job, tracker);
+    *result = job->result;
+    import_job_free(job);
+    return ok;
+}
@@ -0,0 +1,425 @@
+#include "habit_core.h"
+#include <string.h>
+
+#ifdef G_OS_UNIX
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+#include <glib/gstdio.h>
+
+#define IPC_LISTEN_BACKLOG 64
+#define IPC_READ_CHUNK 65536
+#define IPC_MAX_PENDING_OUT (4 * 1024 * 1024)
+
+typedef struct {
+    IpcServer *server;
+    GSocket *socket;
+    GSource *source;
+    GIOCondition watching;
+    GByteArray *in;
+    GByteArray *out;
+    gboolean subscribed;
+    gboolean closing;
+} IpcClient;
+
+struct _IpcServer {
+    HabitTracker *tracker;
+    char *path;
+    GSocket *listener;
+    GSource *listen_source;
+    GPtrArray *clients;
+    guint notify_source;
+    guint32 generation;
+    IpcChangedFunc changed;
+    gpointer user_data;
+};
+
+static gboolean on_client_ready(GSocket *socket, GIOCondition condition, gpointer user_data);
+
+static void put_u32(GByteArray *out, guint32 value)
+{
+    guint32 le = GUINT32_TO_LE(value);
+    g_byte_array_append(out, (const guint8 *)&le, sizeof(le));
+}
+
+static guint32 get_u32(const guint8 *p)
+{
+    guint32 le;
+    memcpy(&le, p, sizeof(le));
+    return GUINT32_FROM_LE(le);
+}
+
+static void begin_response(GByteArray *out, guint8 op, guint8 status, guint32 length)
+{
+    guint8 header[4] = { op, status, 0, 0 };
+    g_byte_array_append(out, header, sizeof(header));
+    put_u32(out, length);
+}
+
+static void client_watch(IpcClient *client)
+{
+    GIOCondition condition = G_IO_HUP | G_IO_ERR;
+    if (client->out->len > 0)
+        condition |= G_IO_OUT;
+    if (client->out->len < IPC_MAX_PENDING_OUT && !client->closing)
+        condition |= G_IO_IN;
+    if (client->source && condition == client->watching)
+        return;
+
+    if (client->source) {
+        g_source_destroy(client->source);
+        g_source_unref(client->source);
+    }
+    client->watching = condition;
+    client->source = g_socket_create_source(client->socket, condition, NULL);
+    g_source_set_callback(client->source, (GSourceFunc)(void (*)(void))on_client_ready, client, NULL);
+    g_source_attach(client->source, NULL);
+}
+
+static void client_free(IpcClient *client)
+{
+    if (client->source) {
+        g_source_destroy(client->source);
+        g_source_unref(client->source);
+    }
+    g_socket_close(client->socket, NULL);
+    g_object_unref(client->socket);
+    g_byte_array_unref(client->in);
+    g_byte_array_unref(client->out);
+    g_free(client);
+}
+
+static void client_drop(IpcClient *client)
+{
+    g_ptr_array_remove_fast(client->server->clients, client);
+}
+
+static gboolean client_flush(IpcClient *client)
+{
+    while (client->out->len > 0) {
+        GError *error = NULL;
+        gssize sent = g_socket_send(client->socket, (const gchar *)client->out->data, client->out->len, NULL, &error);
+        if (sent < 0) {
+            gboolean again = g_error_matches(error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK);
+            g_error_free(error);
+            return again;
+        }
+        g_byte_array_remove_range(client->out, 0, (guint)sent);
+    }
+    return TRUE;
+}
+
+static gboolean decode_cell(const HabitTracker *tracker, guint32 arg, int *habit, int *day, gboolean *value)
+{
+    *day = (int)(arg & 0xffff);
+    *habit = (int)((arg >> 16) & 0x7fff);
+    *value = (arg >> 31) & 1;
+    return *habit < tracker->habit_count && *day < tracker->day_count;
+}
+
+static void write_counts(IpcServer *server, GByteArray *out)
+{
+    const HabitTracker *tracker = server->tracker;
+    begin_response(out, IPC_OP_GET_COUNTS, IPC_STATUS_OK, 4 * (4 + tracker->habit_count + tracker->day_count));
+    put_u32(out, server->generation);
+    put_u32(out, (guint32)tracker->habit_count);
+    put_u32(out, (guint32)tracker->day_count);
+    put_u32(out, (guint32)tracker_count_checked(tracker));
+    for (int i = 0; i < tracker->habit_count; i++)
+        put_u32(out, (guint32)tracker_count_checked_for_habit(tracker, i));
+    for (int d = 0; d < tracker->day_count; d++)
+        put_u32(out, (guint32)habit_stats_day(&tracker->stats, d));
+}
+
+static void write_cells(IpcServer *server, GByteArray *out)
+{
+    const HabitStore *store = &server->tracker->store;
+    guint32 length = (guint32)((size_t)store->habit_count * store->words_per_habit * sizeof(guint64));
+    begin_response(out, IPC_OP_GET_CELLS, IPC_STATUS_OK, 8 + length);
+    put_u32(out, server->generation);
+    put_u32(out, (guint32)store->words_per_habit);
+    guint64 *row = g_new(guint64, store->words_per_habit);
+    for (int i = 0; i < store->habit_count; i++) {
+        habit_store_read_row(store, i, row);
+        for (int w = 0; w < store->words_per_habit; w++) {
+            guint64 le = GUINT64_TO_LE(row[w]);
+            g_byte_array_append(out, (const guint8 *)&le, sizeof(le));
+        }
+    }
+    g_free(row);
+}
+
+static gboolean apply_cells(IpcServer *server, IpcClient *client, guint8 op, const guint8 *args, int arg_count)
+{
+    HabitTracker *tracker = server->tracker;
+    int habit, day;
+    gboolean value;
+
+    for (int i = 0; i < arg_count; i++) {
+        if (!decode_cell(tracker, get_u32(args + 4 * i), &habit, &day, &value)) {
+            begin_response(client->out, op, IPC_STATUS_OUT_OF_RANGE, 4);
+            put_u32(client->out, (guint32)i);
+            return FALSE;
+        }
+    }
+
+    /* A cell toggled twice in one request flips back, so toggles read the
+     * value an earlier entry of the batch left rather than the store's. */
+    GArray *cells = g_array_sized_new(FALSE, FALSE, sizeof(CellChange), (guint)arg_count);
+    GHashTable *toggled = op == IPC_OP_TOGGLE ? g_hash_table_new(g_direct_hash, g_direct_equal) : NULL;
+    for (int i = 0; i < arg_count; i++) {
+        CellChange cell;
+        decode_cell(tracker, get_u32(args + 4 * i), &cell.habit, &cell.day, &cell.value);
+        if (toggled) {
+            gpointer key = GUINT_TO_POINTER((guint)cell.habit * (guint)tracker->day_capacity + (guint)cell.day);
+            gpointer last = g_hash_table_lookup(toggled, key);
+            cell.value = last ? !g_array_index(cells, CellChange, GPOINTER_TO_UINT(last) - 1).value
+                              : !tracker_get_cell(tracker, cell.habit, cell.day);
+            g_hash_table_insert(toggled, key, GUINT_TO_POINTER(cells->len + 1));
+        }
+        g_array_append_val(cells, cell);
+    }
+    guint32 changed = tracker_apply_cells(tracker, cells);
+    g_array_free(cells, TRUE);
+    if (toggled)
+        g_hash_table_destroy(toggled);
+
+    begin_response(client->out, op, IPC_STATUS_OK, 4);
+    put_u32(client->out, changed);
+    return changed > 0;
+}
+
+/* Handles one request frame; returns TRUE when the tracker changed. */
+static gboolean dispatch_request(IpcClient *client, const guint8 *frame, int arg_count)
+{
+    IpcServer *server = client->server;
+    guint8 op = frame[0];
+    const guint8 *args = frame + IPC_HEADER_SIZE;
+
+    switch (op) {
+    case IPC_OP_PING:
+        begin_response(client->out, op, IPC_STATUS_OK, 4);
+        put_u32(client->out, server->generation);
+        return FALSE;
+    case IPC_OP_GET_COUNTS:
+        write_counts(server, client->out);
+        return FALSE;
+    case IPC_OP_GET_CELLS:
+        write_cells(server, client->out);
+        return FALSE;
+    case IPC_OP_GET_NAMES:
+        begin_response(client->out, op, IPC_STATUS_OK, (guint32)server->tracker->habit_count * NAME_LEN);
+        g_byte_array_append(client->out, (const guint8 *)server->tracker->names,
+                            (guint)server->tracker->habit_count * NAME_LEN);
+        return FALSE;
+    case IPC_OP_SET:
+    case IPC_OP_TOGGLE:
+        return apply_cells(server, client, op, args, arg_count);
+    case IPC_OP_SUBSCRIBE:
+    case IPC_OP_UNSUBSCRIBE:
+        client->subscribed = op == IPC_OP_SUBSCRIBE;
+        begin_response(client->out, op, IPC_STATUS_OK, 4);
+        put_u32(client->out, server->generation);
+        return FALSE;
+    default:
+        begin_response(client->out, op, IPC_STATUS_BAD_REQUEST, 0);
+        return FALSE;
+    }
+}
+
+static gboolean on_client_ready(GSocket *socket, GIOCondition condition, gpointer user_data)
+{
+    IpcClient *client = user_data;
+    IpcServer *server = client->server;
+    (void)socket;
+
+    if (condition & (G_IO_IN | G_IO_HUP)) {
+        guint old_len = client->in->len;
+        g_byte_array_set_size(client->in, old_len + IPC_READ_CHUNK);
+        GError *error = NULL;
+        gssize received = g_socket_receive(client->socket, (gchar *)client->in->data + old_len,
+                                           IPC_READ_CHUNK, NULL, &error);
+        g_byte_array_set_size(client->in, old_len + (guint)MAX(received, 0));
+        if (received == 0 || (received < 0 && !g_error_matches(error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK)))
+            client->closing = TRUE;
+        g_clear_error(&error);
+    }
+
+    gint64 span = trace_begin();
+    gboolean changed = FALSE;
+    guint offset = 0;
+    while (client->in->len - offset >= IPC_HEADER_SIZE) {
+        const guint8 *frame = client->in->data + offset;
+        int arg_count = frame[2] | (frame[3] << 8);
+        guint frame_len = IPC_HEADER_SIZE + 4u * (guint)arg_count;
+        if (client->in->len - offset < frame_len)
+            break;
+        changed |= dispatch_request(client, frame, arg_count);
+        offset += frame_len;
+    }
+    g_byte_array_remove_range(client->in, 0, offset);
+    trace_end("ipc_dispatch", span);
+
+    if (changed) {
+        ipc_server_notify(server);
+        if (server->changed)
+            server->changed(server->user_data);
+    }
+
+    if ((condition & G_IO_ERR) || !client_flush(client) || (client->closing && client->out->len == 0)) {
+        client_drop(client);
+        return G_SOURCE_REMOVE;
+    }
+
+    client_watch(client);
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean on_listener_ready(GSocket *socket, GIOCondition condition, gpointer user_data)
+{
+    IpcServer *server = user_data;
+    (void)condition;
+
+    GSocket *accepted;
+    while ((accepted = g_socket_accept(socket, NULL, NULL))) {
+        IpcClient *client = g_new0(IpcClient, 1);
+        client->server = server;
+        client->socket = accepted;
+        client->in = g_byte_array_new();
+        client->out = g_byte_array_new();
+        g_socket_set_blocking(accepted, FALSE);
+        g_ptr_array_add(server->clients, client);
+        client_watch(client);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean send_change_events(gpointer user_data)
+{
+    IpcServer *server = user_data;
+    server->notify_source = 0;
+    server->generation++;
+
+    for (guint i = server->clients->len; i-- > 0;) {
+        IpcClient *client = g_ptr_array_index(server->clients, i);
+        if (!client->subscribed)
+            continue;
+        begin_response(client->out, IPC_EVENT_CHANGED, IPC_STATUS_OK, 4);
+        put_u32(client->out, server->generation);
+        if (client_flush(client))
+            client_watch(client);
+        else
+            client_drop(client);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+static GSocket *bind_listener(const char *path, GError **error)
+{
+    GSocket *socket = g_socket_new(G_SOCKET_FAMILY_UNIX, G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT, error);
+    if (!socket)
+        return NULL;
+
+    GSocketAddress *address = g_unix_socket_address_new(path);
+    gboolean ok = g_socket_bind(socket, address, FALSE, error);
+    if (!ok && g_error_matches(*error, G_IO_ERROR, G_IO_ERROR_ADDRESS_IN_USE)) {
+        /* A socket file nobody answers on is left over from a crash. */
+        GSocket *probe = g_socket_new(G_SOCKET_FAMILY_UNIX, G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT, NULL);
+        gboolean alive = probe && g_socket_connect(probe, address, NULL, NULL);
+        if (probe)
+            g_object_unref(probe);
+        if (!alive) {
+            g_clear_error(error);
+            g_unlink(path);
+            ok = g_socket_bind(socket, address, FALSE, error);
+        }
+    }
+    g_object_unref(address);
+
+    if (ok) {
+        g_socket_set_listen_backlog(socket, IPC_LISTEN_BACKLOG);
+        ok = g_socket_listen(socket, error);
+    }
+    if (!ok) {
+        g_object_unref(socket);
+        return NULL;
+    }
+    g_socket_set_blocking(socket, FALSE);
+    return socket;
+}
+
+IpcServer *ipc_server_new(HabitTracker *tracker, const char *path, IpcChangedFunc changed, gpointer user_data)
+{
+    GError *error = NULL;
+    GSocket *listener = bind_listener(path, &error);
+    if (!listener) {
+        g_warning("could not listen on %s: %s", path, error->message);
+        g_error_free(error);
+        return NULL;
+    }
+
+    IpcServer *server = g_new0(IpcServer, 1);
+    server->tracker = tracker;
+    server->path = g_strdup(path);
+    server->listener = listener;
+    server->clients = g_ptr_array_new_with_free_func((GDestroyNotify)client_free);
+    server->changed = changed;
+    server->user_data = user_data;
+    server->listen_source = g_socket_create_source(listener, G_IO_IN, NULL);
+    g_source_set_callback(server->listen_source, (GSourceFunc)(void (*)(void))on_listener_ready, server, NULL);
+    g_source_attach(server->listen_source, NULL);
+    return server;
+}
+
+void ipc_server_notify(IpcServer *server)
+{
+    if (server && !server->notify_source)
+        server->notify_source = g_idle_add(send_change_events, server);
+}
+
+void ipc_server_free(IpcServer *server)
+{
+    if (!server)
+        return;
+
+    if (server->notify_source)
+        g_source_remove(server->notify_source);
+    g_source_destroy(server->listen_source);
+    g_source_unref(server->listen_source);
+    g_ptr_array_free(server->clients, TRUE);
+    g_socket_close(server->listener, NULL);
+    g_object_unref(server->listener);
+    g_unlink(server->path);
+    g_free(server->path);
+    g_free(server);
+}
+
+#else
+
+IpcServer *ipc_server_new(HabitTracker *tracker, const char *path, IpcChangedFunc changed, gpointer user_data)
+{
+    (void)tracker;
+    (void)changed;
+    (void)user_data;
+    g_warning("could not listen on %s: local sockets are not supported on this platform", path);
+    return NULL;
+}
+
+void ipc_server_notify(IpcServer *server)
+{
+    (void)server;
+}
+
+void ipc_server_free(IpcServer *server)
+{
+    (void)server;
+}
+
+#endif
+
+char *ipc_default_socket_path(void)
+{
+    const char *path = g_getenv(SOCKET_ENV);
+    if (path)
+        return path[0] != '\0' ? g_strdup(path) : NULL;
+    return g_build_filename(g_get_user_runtime_dir(), IPC_SOCKET_NAME, NULL);
+}
@@ -0,0 +1,706 @@
+#include "habit_core.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+static gboolean journal_reset(PersistWorker *worker)
+{
+    if (worker->journal_file)
+        fclose(worker->journal_file);
+
+    worker->journal_file = fopen(worker->journal_path, "wb");
+    worker->journal_size = 0;
+    if (!worker->journal_file) {
+        g_warning("could not open %s for writing: %s", worker->journal_path, g_strerror(errno));
+        return FALSE;
+    }
+
+    if (fwrite(JOURNAL_MAGIC, 1, JOURNAL_HEADER_SIZE, worker->journal_file) != JOURNAL_HEADER_SIZE ||
+        !flush_to_disk(worker->journal_file)) {
+        g_warning("failed writing %s header", worker->journal_path);
+        return FALSE;
+    }
+    worker->journal_size = JOURNAL_HEADER_SIZE;
+    return TRUE;
+}
+
+static void journal_open(PersistWorker *worker)
+{
+    FILE *f = fopen(worker->journal_path, "ab");
+    if (!f) {
+        journal_reset(worker);
+        return;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    if (size < JOURNAL_HEADER_SIZE) {
+        fclose(f);
+        journal_reset(worker);
+        return;
+    }
+
+    worker->journal_file = f;
+    worker->journal_size = size;
+}
+
+static void write_snapshot(PersistWorker *worker)
+{
+    gint64 span = trace_begin();
+    if (tracker_file_write(worker->tracker_path, &worker->mirror, worker->mirror_names, worker->mirror_day_count))
+        journal_reset(worker);
+    trace_end("write_snapshot", span);
+}
+
+static gboolean journal_append(PersistWorker *worker, GByteArray *records)
+{
+    if (!worker->journal_file)
+        journal_open(worker);
+
+    gint64 span = trace_begin();
+    gboolean ok = worker->journal_file &&
+        fwrite(records->data, 1, records->len, worker->journal_file) == records->len &&
+        flush_to_disk(worker->journal_file);
+    trace_end("journal_append", span);
+    if (!ok) {
+        g_warning("failed appending to %s, writing a snapshot instead", worker->journal_path);
+        return FALSE;
+    }
+
+    worker->journal_size += records->len;
+    return worker->journal_size < JOURNAL_COMPACT_BYTES;
+}
+
+static gboolean persist_has_pending(const PersistWorker *worker)
+{
+    return worker->pending_journal->len > 0 || worker->pending_names || worker->pending_history ||
+           worker->pending_day_count > 0 || worker->snapshot_requested;
+}
+
+static gboolean persist_write_due(const PersistWorker *worker)
+{
+    if (worker->stopping)
+        return TRUE;
+    if (worker->policy == DURABILITY_ON_EXIT)
+        return FALSE;
+    if (worker->pool || worker->policy == DURABILITY_EVERY_CHANGE)
+        return TRUE;
+    return g_get_monotonic_time() >= worker->first_dirty_time + worker->group_commit_us;
+}
+
+typedef struct {
+    GByteArray *records;
+    char *names;
+    int name_count;
+    HistoryStore *history;
+    int day_count;
+    gboolean snapshot;
+} PersistBatch;
+
+static gboolean batch_is_empty(const PersistBatch *batch)
+{
+    return batch->records->len == 0 && !batch->names && !batch->history &&
+           batch->day_count == 0 && !batch->snapshot;
+}
+
+/* mirror_names holds one entry per mirror habit; added habits get the
+ * default name until a rename arrives. */
+static void mirror_names_resize(PersistWorker *worker, int old_count, int habit_count)
+{
+    if (habit_count <= old_count)
+        return;
+
+    worker->mirror_names = g_realloc(worker->mirror_names, (gsize)habit_count * NAME_LEN);
+    for (int i = old_count; i < habit_count; i++)
+        g_snprintf(worker->mirror_names + (size_t)i * NAME_LEN, NAME_LEN, "Habit %d", i + 1);
+}
+
+static void mirror_resize(PersistWorker *worker, int habit_count)
+{
+    int old_count = worker->mirror.habit_count;
+    history_store_resize(&worker->mirror, habit_count, 0);
+    mirror_names_resize(worker, old_count, worker->mirror.habit_count);
+}
+
+static void batch_apply(PersistWorker *worker, PersistBatch *batch)
+{
+    if (batch->history) {
+        int habit_count = worker->mirror.habit_count;
+        history_store_free(&worker->mirror);
+        worker->mirror = *batch->history;
+        g_free(batch->history);
+        batch->history = NULL;
+        batch->snapshot = TRUE;
+        history_store_resize(&worker->mirror, habit_count, 0);
+        mirror_names_resize(worker, habit_count, worker->mirror.habit_count);
+    }
+    if (batch->names) {
+        mirror_resize(worker, batch->name_count);
+        memcpy(worker->mirror_names, batch->names, (size_t)batch->name_count * NAME_LEN);
+        g_clear_pointer(&batch->names, g_free);
+        batch->snapshot = TRUE;
+    }
+    if (batch->day_count > 0) {
+        worker->mirror_day_count = batch->day_count;
+        batch->snapshot = TRUE;
+    }
+    for (guint offset = 0; offset < batch->records->len; offset += JOURNAL_RECORD_SIZE)
+        journal_apply(&worker->mirror, batch->records->data + offset);
+}
+
+/* Replays this instance's unsaved edits on top of what another instance
+ * saved, so both sets of changes survive. Must run before batch_apply. */
+static void batch_merge(const PersistWorker *worker, const PersistBatch *batch, HabitTracker *disk)
+{
+    if (batch->history) {
+        tracker_resize(disk, batch->history->habit_count, 0);
+        GArray *cells = g_array_new(FALSE, FALSE, sizeof(CellChange));
+        history_diff(&worker->mirror, batch->history, cells);
+        for (guint i = 0; i < cells->len; i++) {
+            const CellChange *cell = &g_array_index(cells, CellChange, i);
+            history_set(&disk->history, cell->habit, cell->day, cell->value);
+        }
+        g_array_free(cells, TRUE);
+        if (batch->history->cycle_start != worker->mirror.cycle_start)
+            disk->history.cycle_start = batch->history->cycle_start;
+        if (batch->history->rolling != worker->mirror.rolling)
+            disk->history.rolling = batch->history->rolling;
+    }
+    if (batch->names) {
+        tracker_resize(disk, batch->name_count, 0);
+        for (int i = 0; i < batch->name_count; i++) {
+            const char *name = batch->names + (size_t)i * NAME_LEN;
+            if (i >= worker->mirror.habit_count || strcmp(name, worker->mirror_names + (size_t)i * NAME_LEN) != 0)
+                g_strlcpy(disk->names[i], name, NAME_LEN);
+        }
+    }
+    if (batch->day_count > 0)
+        disk->day_count = batch->day_count;
+    for (guint offset = 0; offset < batch->records->len; offset += JOURNAL_RECORD_SIZE)
+        journal_apply(&disk->history, batch->records->data + offset);
+}
+
+static void batch_take(PersistWorker *worker, PersistBatch *batch, gboolean due)
+{
+    memset(batch, 0, sizeof(*batch));
+    if (due) {
+        batch->records = worker->pending_journal;
+        worker->pending_journal = g_byte_array_new();
+        batch->names = worker->pending_names;
+        batch->name_count = worker->pending_name_count;
+        worker->pending_names = NULL;
+        batch->history = worker->pending_history;
+        worker->pending_history = NULL;
+        batch->day_count = worker->pending_day_count;
+        worker->pending_day_count = 0;
+        batch->snapshot = worker->snapshot_requested;
+        worker->snapshot_requested = FALSE;
+    } else {
+        batch->records = g_byte_array_new();
+    }
+    worker->sync_requested = FALSE;
+}
+
+static TrackerChange *change_new(const PersistWorker *worker, const HabitTracker *disk)
+{
+    TrackerChange *change = g_new0(TrackerChange, 1);
+    change->cells = g_array_new(FALSE, FALSE, sizeof(CellChange));
+    change->cycle_start = disk->history.cycle_start;
+
+    if (disk->history.cycle_start != worker->mirror.cycle_start ||
+        disk->history.rolling != worker->mirror.rolling) {
+        change->history = g_new(HistoryStore, 1);
+        history_store_copy(change->history, &disk->history);
+    } else {
+        history_diff(&worker->mirror, &disk->history, change->cells);
+    }
+    change->habit_count = disk->habit_count;
+    if (disk->habit_count != worker->mirror.habit_count ||
+        memcmp(worker->mirror_names, disk->names, (size_t)disk->habit_count * NAME_LEN) != 0)
+        change->names = g_memdup2(disk->names, (gsize)disk->habit_count * NAME_LEN);
+    if (disk->day_count != worker->mirror_day_count)
+        change->day_count = disk->day_count;
+
+    if (!change->history && change->cells->len == 0 && !change->names && change->day_count == 0) {
+        tracker_change_free(change);
+        return NULL;
+    }
+    return change;
+}
+
+static void mirror_adopt(PersistWorker *worker, const HabitTracker *disk)
+{
+    history_store_free(&worker->mirror);
+    history_store_copy(&worker->mirror, &disk->history);
+    g_free(worker->mirror_names);
+    worker->mirror_names = g_memdup2(disk->names, (gsize)disk->habit_count * NAME_LEN);
+    worker->mirror_day_count = disk->day_count;
+}
+
+static void persist_commit(PersistWorker *worker, PersistBatch *batch)
+{
+    gboolean local = !batch_is_empty(batch);
+    int lock = data_lock_acquire(worker->lock_path, local);
+    TrackerChange *change = NULL;
+    DataStamp stamp;
+
+    g_mutex_lock(&worker->lock);
+    gboolean watched = worker->change_ready != NULL;
+    g_mutex_unlock(&worker->lock);
+
+    data_stamp_read(&stamp, worker->tracker_path, worker->journal_path);
+    if (stamp.write_id != worker->stamp.write_id || stamp.journal_size != worker->stamp.journal_size) {
+        gint64 span = trace_begin();
+        HabitTracker disk;
+        tracker_init(&disk, worker->data_dir, worker->mirror.habit_count, worker->mirror.window_days);
+        if (tracker_read_disk(&disk)) {
+            batch_merge(worker, batch, &disk);
+            batch_apply(worker, batch);
+            if (watched)
+                change = change_new(worker, &disk);
+            mirror_adopt(worker, &disk);
+        } else {
+            batch_apply(worker, batch);
+        }
+        tracker_free(&disk);
+        worker->stamp = stamp;
+        if (worker->journal_file) {
+            fclose(worker->journal_file);
+            worker->journal_file = NULL;
+        }
+        batch->snapshot = local;
+        trace_end("merge_external", span);
+    } else {
+        batch_apply(worker, batch);
+    }
+
+    if (batch->snapshot)
+        write_snapshot(worker);
+    else if (batch->records->len > 0 && !journal_append(worker, batch->records))
+        write_snapshot(worker);
+    if (local)
+        data_stamp_read(&worker->stamp, worker->tracker_path, worker->journal_path);
+    data_lock_release(lock);
+
+    if (change) {
+        g_mutex_lock(&worker->lock);
+        if (worker->change_ready && !worker->stopping) {
+            worker->change = change;
+            worker->change_source = g_idle_add(worker->change_ready, worker->change_data);
+            change = NULL;
+        }
+        g_mutex_unlock(&worker->lock);
+        tracker_change_free(change);
+    }
+}
+
+/* Finishes the checksum tracker_load skipped. Damage is reported and a copy
+ * kept; the next snapshot is written with fresh checksums either way. */
+static void persist_verify(PersistWorker *worker)
+{
+    if (!worker->verify_requested)
+        return;
+
+    worker->verify_requested = FALSE;
+    gint64 span = trace_begin();
+    int lock = data_lock_acquire(worker->lock_path, FALSE);
+    if (!tracker_file_verify(worker->tracker_path, worker->stamp.write_id)) {
+        gchar *corrupt_path = g_strdup_printf("%s.corrupt", worker->tracker_path);
+        gchar *contents = NULL;
+        gsize length = 0;
+        g_warning("%s failed its checksum after loading, keeping a copy at %s", worker->tracker_path, corrupt_path);
+        if (g_file_get_contents(worker->tracker_path, &contents, &length, NULL))
+            g_file_set_contents(corrupt_path, contents, (gssize)length, NULL);
+        g_free(contents);
+        g_free(corrupt_path);
+    }
+    data_lock_release(lock);
+    trace_end("verify_snapshot", span);
+}
+
+static gpointer persist_worker_main(gpointer user_data)
+{
+    PersistWorker *worker = user_data;
+
+    trace_name_thread("persist");
+    persist_verify(worker);
+    g_mutex_lock(&worker->lock);
+    for (;;) {
+        /* Hold further writes until the main thread has taken the last
+         * external change, so it can tell which of its edits are newer. */
+        if (worker->change && !worker->stopping) {
+            g_cond_wait(&worker->cond, &worker->lock);
+            continue;
+        }
+
+        gboolean pending = persist_has_pending(worker);
+        gboolean due = pending && persist_write_due(worker);
+        if (!due && !worker->sync_requested) {
+            if (worker->stopping)
+                break;
+            if (pending && worker->policy == DURABILITY_GROUP_COMMIT)
+                g_cond_wait_until(&worker->cond, &worker->lock, worker->first_dirty_time + worker->group_commit_us);
+            else
+                g_cond_wait(&worker->cond, &worker->lock);
+            continue;
+        }
+
+        PersistBatch batch;
+        batch_take(worker, &batch, due);
+        g_mutex_unlock(&worker->lock);
+
+        persist_commit(worker, &batch);
+        g_byte_array_unref(batch.records);
+
+        g_mutex_lock(&worker->lock);
+    }
+    g_mutex_unlock(&worker->lock);
+
+    if (worker->journal_file) {
+        fclose(worker->journal_file);
+        worker->journal_file = NULL;
+    }
+    return NULL;
+}
+
+/* Pool task: writes everything queued for one worker, then closes its
+ * journal so thousands of idle workers do not hold descriptors open. */
+static void persist_pool_drain(gpointer data, gpointer user_data)
+{
+    PersistWorker *worker = data;
+    (void)user_data;
+
+    trace_name_thread("persist");
+    persist_verify(worker);
+    g_mutex_lock(&worker->lock);
+    for (;;) {
+        gboolean due = persist_has_pending(worker) && persist_write_due(worker);
+        if (!due && !worker->sync_requested)
+            break;
+
+        PersistBatch batch;
+        batch_take(worker, &batch, due);
+        g_mutex_unlock(&worker->lock);
+
+        persist_commit(worker, &batch);
+        g_byte_array_unref(batch.records);
+
+        g_mutex_lock(&worker->lock);
+    }
+    if (worker->journal_file) {
+        fclose(worker->journal_file);
+        worker->journal_file = NULL;
+    }
+    worker->queued = FALSE;
+    g_cond_broadcast(&worker->cond);
+    g_mutex_unlock(&worker->lock);
+}
+
+GThreadPool *persist_pool_new(int threads)
+{
+    return g_thread_pool_new(persist_pool_drain, NULL, threads, FALSE, NULL);
+}
+
+static void persist_queue(PersistWorker *worker)
+{
+    if (!worker->pool || worker->queued || worker->stopping)
+        return;
+
+    worker->queued = TRUE;
+    g_thread_pool_push(worker->pool, worker, NULL);
+}
+
+static void persist_worker_init(PersistWorker *worker, const HabitTracker *tracker, gboolean snapshot_now)
+{
+    memset(worker, 0, sizeof(*worker));
+    g_mutex_init(&worker->lock);
+    g_cond_init(&worker->cond);
+    worker->pending_journal = g_byte_array_new();
+    worker->snapshot_requested = snapshot_now;
+    worker->verify_requested = tracker->history_unverified;
+
+    worker->data_dir = g_strdup(tracker->data_dir);
+    worker->tracker_path = g_strdup(tracker->tracker_path);
+    worker->journal_path = g_strdup(tracker->journal_path);
+    worker->lock_path = g_build_filename(tracker->data_dir, LOCK_FILE_NAME, NULL);
+    worker->stamp = tracker->disk_stamp;
+    history_store_copy(&worker->mirror, &tracker->history);
+    worker->mirror_names = g_memdup2(tracker->names, (gsize)tracker->habit_count * NAME_LEN);
+    worker->mirror_day_count = tracker->day_count;
+
+    worker->policy = DURABILITY_GROUP_COMMIT;
+    worker->group_commit_us = DEFAULT_GROUP_COMMIT_MS * 1000;
+
+    const char *policy = g_getenv("HABIT_TRACKER_DURABILITY");
+    if (policy) {
+        if (g_str_equal(policy, "change")) {
+            worker->policy = DURABILITY_EVERY_CHANGE;
+        } else if (g_str_equal(policy, "exit")) {
+            worker->policy = DURABILITY_ON_EXIT;
+        } else if (g_str_has_prefix(policy, "group")) {
+            int interval_ms = (policy[5] == ':') ? atoi(policy + 6) : 0;
+            if (interval_ms > 0)
+                worker->group_commit_us = (gint64)interval_ms * 1000;
+        } else {
+            g_warning("unknown HABIT_TRACKER_DURABILITY '%s', using group commit", policy);
+        }
+    }
+}
+
+void persist_worker_start(PersistWorker *worker, const HabitTracker *tracker, gboolean snapshot_now)
+{
+    persist_worker_init(worker, tracker, snapshot_now);
+    worker->thread = g_thread_new("persist", persist_worker_main, worker);
+}
+
+/* Shares `pool` (from persist_pool_new) with other workers instead of
+ * starting a thread. Group commit degrades to writing as soon as a pool
+ * thread is free; on-exit durability still waits for the stop. */
+void persist_worker_start_pooled(PersistWorker *worker, const HabitTracker *tracker, gboolean snapshot_now,
+                                 GThreadPool *pool)
+{
+    persist_worker_init(worker, tracker, snapshot_now);
+    worker->pool = pool;
+    if (snapshot_now || worker->verify_requested) {
+        g_mutex_lock(&worker->lock);
+        persist_queue(worker);
+        g_mutex_unlock(&worker->lock);
+    }
+}
+
+static gboolean persist_running(const PersistWorker *worker)
+{
+    return worker->thread || worker->pool;
+}
+
+static void persist_mark_dirty(PersistWorker *worker)
+{
+    if (!persist_has_pending(worker))
+        worker->first_dirty_time = g_get_monotonic_time();
+    if (worker->policy != DURABILITY_ON_EXIT)
+        persist_queue(worker);
+    g_cond_signal(&worker->cond);
+}
+
+void persist_names(PersistWorker *worker, const char *names, int habit_count)
+{
+    if (!persist_running(worker))
+        return;
+
+    g_mutex_lock(&worker->lock);
+    persist_mark_dirty(worker);
+    g_free(worker->pending_names);
+    worker->pending_names = g_memdup2(names, (gsize)habit_count * NAME_LEN);
+    worker->pending_name_count = habit_count;
+    g_mutex_unlock(&worker->lock);
+}
+
+void persist_history(PersistWorker *worker, const HistoryStore *hist)
+{
+    if (!persist_running(worker))
+        return;
+
+    HistoryStore *copy = g_new(HistoryStore, 1);
+    history_store_copy(copy, hist);
+
+    g_mutex_lock(&worker->lock);
+    persist_mark_dirty(worker);
+    if (worker->pending_history) {
+        history_store_free(worker->pending_history);
+        g_free(worker->pending_history);
+    }
+    worker->pending_history = copy;
+    g_byte_array_set_size(worker->pending_journal, 0);
+    g_mutex_unlock(&worker->lock);
+}
+
+void persist_settings(PersistWorker *worker, int day_count)
+{
+    if (!persist_running(worker))
+        return;
+
+    g_mutex_lock(&worker->lock);
+    persist_mark_dirty(worker);
+    worker->pending_day_count = day_count;
+    g_mutex_unlock(&worker->lock);
+}
+
+void persist_journal(PersistWorker *worker, JournalOp op, int habit, int day, gboolean value)
+{
+    guint8 record[JOURNAL_RECORD_SIZE];
+    journal_encode(record, op, habit, day, value);
+    persist_journal_records(worker, record, JOURNAL_RECORD_SIZE);
+}
+
+/* Queues already encoded records as one write, so a batch edit wakes the
+ * writer once however many cells it touched. */
+void persist_journal_records(PersistWorker *worker, const guint8 *records, guint length)
+{
+    if (!persist_running(worker) || length == 0)
+        return;
+
+    g_mutex_lock(&worker->lock);
+    persist_mark_dirty(worker);
+    g_byte_array_append(worker->pending_journal, records, length);
+    g_mutex_unlock(&worker->lock);
+}
+
+void persist_sync(PersistWorker *worker)
+{
+    if (!persist_running(worker))
+        return;
+
+    g_mutex_lock(&worker->lock);
+    worker->sync_requested = TRUE;
+    persist_queue(worker);
+    g_cond_signal(&worker->cond);
+    g_mutex_unlock(&worker->lock);
+}
+
+static void drop_pending_change(PersistWorker *worker)
+{
+    if (worker->change_source)
+        g_source_remove(worker->change_source);
+    worker->change_source = 0;
+    tracker_change_free(worker->change);
+    worker->change = NULL;
+}
+
+/* `ready` runs on the main loop whenever another instance's saves have been
+ * merged; it should call persist_take_change. Pass NULL to stop. */
+void persist_watch(PersistWorker *worker, GSourceFunc ready, gpointer user_data)
+{
+    if (!worker->thread)
+        return;
+
+    g_mutex_lock(&worker->lock);
+    worker->change_ready = ready;
+    worker->change_data = user_data;
+    if (!ready) {
+        drop_pending_change(worker);
+        g_cond_signal(&worker->cond);
+    }
+    g_mutex_unlock(&worker->lock);
+}
+
+/* Edits still queued here are newer than the external change and will be
+ * written over it, so the parts they cover are left out. */
+static void drop_overridden(const PersistWorker *worker, TrackerChange *change)
+{
+    if (worker->pending_history) {
+        g_array_set_size(change->cells, 0);
+        g_clear_pointer(&change->names, g_free);
+        change->day_count = 0;
+        if (change->history) {
+            history_store_free(change->history);
+            g_clear_pointer(&change->history, g_free);
+        }
+        return;
+    }
+    if (worker->pending_names && change->names)
+        memcpy(change->names, worker->pending_names,
+               (size_t)MIN(worker->pending_name_count, change->habit_count) * NAME_LEN);
+    if (worker->pending_day_count > 0)
+        change->day_count = 0;
+
+    const GByteArray *records = worker->pending_journal;
+    if (records->len == 0)
+        return;
+    if (change->history) {
+        for (guint offset = 0; offset < records->len; offset += JOURNAL_RECORD_SIZE)
+            journal_apply(change->history, records->data + offset);
+        return;
+    }
+
+    HistoryStore touched;
+    gboolean *cleared = g_new0(gboolean, worker->mirror.habit_count);
+    gboolean all = FALSE;
+    history_store_init(&touched, worker->mirror.habit_count, worker->mirror.window_days, change->cycle_start);
+    for (guint offset = 0; offset < records->len; offset += JOURNAL_RECORD_SIZE) {
+        JournalOp op;
+        int habit, day;
+        gboolean value;
+        if (!journal_decode(records->data + offset, &op, &habit, &day, &value) || habit >= touched.habit_count)
+            continue;
+        if (op == JOURNAL_SET_CELL)
+            history_set(&touched, habit, change->cycle_start + day, TRUE);
+        else if (op == JOURNAL_CLEAR_HABIT)
+            cleared[habit] = TRUE;
+        else if (op != JOURNAL_MOVE_WINDOW)
+            all = TRUE;
+    }
+
+    guint kept = 0;
+    int end = change->cycle_start + touched.window_days;
+    for (guint i = 0; i < change->cells->len && !all; i++) {
+        CellChange cell = g_array_index(change->cells, CellChange, i);
+        gboolean in_window = cell.day >= change->cycle_start && cell.day < end;
+        if (cell.habit < touched.habit_count &&
+            ((cleared[cell.habit] && in_window) || history_get(&touched, cell.habit, cell.day)))
+            continue;
+        g_array_index(change->cells, CellChange, kept++) = cell;
+    }
+    g_array_set_size(change->cells, kept);
+    history_store_free(&touched);
+    g_free(cleared);
+}
+
+TrackerChange *persist_take_change(PersistWorker *worker)
+{
+    if (!worker->thread)
+        return NULL;
+
+    g_mutex_lock(&worker->lock);
+    TrackerChange *change = worker->change;
+    worker->change = NULL;
+    worker->change_source = 0;
+    if (change)
+        drop_overridden(worker, change);
+    g_cond_signal(&worker->cond);
+    g_mutex_unlock(&worker->lock);
+    return change;
+}
+
+void tracker_change_free(TrackerChange *change)
+{
+    if (!change)
+        return;
+
+    g_array_free(change->cells, TRUE);
+    g_free(change->names);
+    if (change->history) {
+        history_store_free(change->history);
+        g_free(change->history);
+    }
+    g_free(change);
+}
+
+void persist_worker_stop(PersistWorker *worker)
+{
+    if (!persist_running(worker))
+        return;
+
+    g_mutex_lock(&worker->lock);
+    worker->stopping = TRUE;
+    g_cond_signal(&worker->cond);
+    while (worker->queued)
+        g_cond_wait(&worker->cond, &worker->lock);
+    g_mutex_unlock(&worker->lock);
+
+    if (worker->thread)
+        g_thread_join(worker->thread);
+    else
+        persist_pool_drain(worker, NULL);
+    worker->thread = NULL;
+    worker->pool = NULL;
+    drop_pending_change(worker);
+    g_mutex_clear(&worker->lock);
+    g_cond_clear(&worker->cond);
+    g_byte_array_unref(worker->pending_journal);
+    g_free(worker->mirror_names);
+    g_free(worker->data_dir);
+    g_free(worker->tracker_path);
+    g_free(worker->journal_path);
+    g_free(worker->lock_path);
+    history_store_free(&worker->mirror);
+}
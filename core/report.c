@@ -0,0 +1,392 @@
+#include "habit_core.h"
+#include <string.h>
+
+typedef struct {
+    GMutex lock;
+    guint next;
+    guint end;
+} ReportRange;
+
+typedef struct _ReportWorker ReportWorker;
+
+typedef struct {
+    const char *root;
+    GPtrArray *profiles;
+    ReportWorker *workers;
+    int worker_count;
+} ReportRun;
+
+struct _ReportWorker {
+    ReportRun *run;
+    int index;
+    ReportRange range;
+    TrackerReport partial;
+    GThread *thread;
+};
+
+/* Positive when `a` ranks above `b`: higher completion first, then the
+ * earlier profile and habit, so results do not depend on thread timing. */
+static int entry_rank(const ReportEntry *a, const ReportEntry *b)
+{
+    gint64 lhs = (gint64)a->checked * b->days;
+    gint64 rhs = (gint64)b->checked * a->days;
+    if (lhs != rhs)
+        return lhs > rhs ? 1 : -1;
+
+    int order = strcmp(b->profile, a->profile);
+    if (order != 0)
+        return order;
+    return b->habit - a->habit;
+}
+
+static gint entry_rank_desc(gconstpointer a, gconstpointer b)
+{
+    return entry_rank(b, a);
+}
+
+static gint entry_rank_asc(gconstpointer a, gconstpointer b)
+{
+    return entry_rank(a, b);
+}
+
+/* Both heaps keep `k` entries with the entry closest to being displaced at
+ * the root: the lowest ranked for top (`sign` 1), the highest for bottom. */
+static gboolean heap_before(const GArray *heap, guint i, guint j, int sign)
+{
+    return sign * entry_rank(&g_array_index(heap, ReportEntry, i), &g_array_index(heap, ReportEntry, j)) < 0;
+}
+
+static void heap_swap(GArray *heap, guint i, guint j)
+{
+    ReportEntry tmp = g_array_index(heap, ReportEntry, i);
+    g_array_index(heap, ReportEntry, i) = g_array_index(heap, ReportEntry, j);
+    g_array_index(heap, ReportEntry, j) = tmp;
+}
+
+static void heap_sift_down(GArray *heap, guint i, int sign)
+{
+    for (;;) {
+        guint best = i;
+        guint left = 2 * i + 1;
+        guint right = left + 1;
+        if (left < heap->len && heap_before(heap, left, best, sign))
+            best = left;
+        if (right < heap->len && heap_before(heap, right, best, sign))
+            best = right;
+        if (best == i)
+            return;
+        heap_swap(heap, i, best);
+        i = best;
+    }
+}
+
+static void heap_offer(GArray *heap, int k, const ReportEntry *entry, int sign)
+{
+    if (k <= 0)
+        return;
+
+    if (heap->len < (guint)k) {
+        ReportEntry copy = *entry;
+        copy.profile = g_strdup(entry->profile);
+        g_array_append_val(heap, copy);
+        for (guint i = heap->len - 1; i > 0 && heap_before(heap, i, (i - 1) / 2, sign); i = (i - 1) / 2)
+            heap_swap(heap, i, (i - 1) / 2);
+        return;
+    }
+
+    ReportEntry *root = &g_array_index(heap, ReportEntry, 0);
+    if (sign * entry_rank(entry, root) <= 0)
+        return;
+
+    g_free(root->profile);
+    *root = *entry;
+    root->profile = g_strdup(entry->profile);
+    heap_sift_down(heap, 0, sign);
+}
+
+static void report_init(TrackerReport *report, int k)
+{
+    memset(report, 0, sizeof(*report));
+    report->k = MAX(k, 0);
+    report->top = g_array_new(FALSE, FALSE, sizeof(ReportEntry));
+    report->bottom = g_array_new(FALSE, FALSE, sizeof(ReportEntry));
+}
+
+/* Profiles may be saved with different cycle lengths, so the weekly trend
+ * grows to the longest one seen. */
+static void report_grow_weeks(TrackerReport *report, int week_count)
+{
+    if (week_count <= report->week_count)
+        return;
+
+    report->week_checked = g_renew(gint64, report->week_checked, week_count);
+    report->week_cells = g_renew(gint64, report->week_cells, week_count);
+    for (int w = report->week_count; w < week_count; w++) {
+        report->week_checked[w] = 0;
+        report->week_cells[w] = 0;
+    }
+    report->week_count = week_count;
+}
+
+static void report_add_tracker(TrackerReport *report, const char *profile, const HabitTracker *tracker)
+{
+    int day_count = tracker->day_count;
+    gint64 cells = (gint64)tracker->habit_count * day_count;
+    int checked = tracker_count_checked(tracker);
+
+    report->profiles++;
+    report->checked += checked;
+    report->cells += cells;
+    report->percent_sum += (cells > 0) ? (100.0 * checked) / cells : 0.0;
+
+    report_grow_weeks(report, tracker_week_count(tracker));
+    for (int w = 0; w < tracker_week_count(tracker); w++) {
+        int start_day, end_day;
+        tracker_week_bounds(tracker, w, &start_day, &end_day);
+        report->week_checked[w] += tracker_count_checked_in_week(tracker, w);
+        report->week_cells[w] += (gint64)tracker->habit_count * (end_day - start_day + 1);
+    }
+
+    for (int i = 0; i < tracker->habit_count && day_count > 0; i++) {
+        ReportEntry entry;
+        entry.profile = (char *)profile;
+        entry.habit = i;
+        g_strlcpy(entry.name, tracker->names[i], NAME_LEN);
+        entry.checked = tracker_count_checked_for_habit(tracker, i);
+        entry.days = day_count;
+        heap_offer(report->top, report->k, &entry, 1);
+        heap_offer(report->bottom, report->k, &entry, -1);
+    }
+}
+
+static void report_merge(TrackerReport *dest, const TrackerReport *src)
+{
+    dest->profiles += src->profiles;
+    dest->unreadable += src->unreadable;
+    dest->checked += src->checked;
+    dest->cells += src->cells;
+    dest->percent_sum += src->percent_sum;
+    report_grow_weeks(dest, src->week_count);
+    for (int w = 0; w < src->week_count; w++) {
+        dest->week_checked[w] += src->week_checked[w];
+        dest->week_cells[w] += src->week_cells[w];
+    }
+    for (guint i = 0; i < src->top->len; i++)
+        heap_offer(dest->top, dest->k, &g_array_index(src->top, ReportEntry, i), 1);
+    for (guint i = 0; i < src->bottom->len; i++)
+        heap_offer(dest->bottom, dest->k, &g_array_index(src->bottom, ReportEntry, i), -1);
+}
+
+static gboolean report_load(const ReportRun *run, const char *profile, HabitTracker *tracker)
+{
+    gchar *dir = g_build_filename(run->root, profile, NULL);
+    /* tracker_read_disk grows it to the layout the profile was saved with. */
+    tracker_init(tracker, dir, 1, 1);
+    g_free(dir);
+
+    gchar *lock_path = g_build_filename(tracker->data_dir, LOCK_FILE_NAME, NULL);
+    int lock = data_lock_acquire(lock_path, FALSE);
+    g_free(lock_path);
+    gboolean ok = tracker_read_disk(tracker);
+    data_lock_release(lock);
+    if (ok) {
+        tracker_reload_window(tracker);
+        tracker_roll_to_today(tracker);
+    }
+    return ok;
+}
+
+/* Takes the next profile from this worker's range, or steals the back half
+ * of another worker's range once its own is empty. */
+static gboolean report_next(ReportWorker *worker, guint *item)
+{
+    ReportRange *own = &worker->range;
+    g_mutex_lock(&own->lock);
+    gboolean found = own->next < own->end;
+    if (found)
+        *item = own->next++;
+    g_mutex_unlock(&own->lock);
+    if (found)
+        return TRUE;
+
+    ReportRun *run = worker->run;
+    for (int i = 1; i < run->worker_count; i++) {
+        ReportRange *victim = &run->workers[(worker->index + i) % run->worker_count].range;
+        g_mutex_lock(&victim->lock);
+        guint take = (victim->end - victim->next + 1) / 2;
+        victim->end -= take;
+        guint start = victim->end;
+        g_mutex_unlock(&victim->lock);
+        if (take == 0)
+            continue;
+
+        g_mutex_lock(&own->lock);
+        own->next = start + 1;
+        own->end = start + take;
+        g_mutex_unlock(&own->lock);
+        *item = start;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static gpointer report_worker_main(gpointer user_data)
+{
+    ReportWorker *worker = user_data;
+    const ReportRun *run = worker->run;
+    guint item;
+
+    trace_name_thread("report");
+    while (report_next(worker, &item)) {
+        const char *profile = g_ptr_array_index(run->profiles, item);
+        gint64 span = trace_begin();
+        HabitTracker tracker;
+        if (report_load(run, profile, &tracker))
+            report_add_tracker(&worker->partial, profile, &tracker);
+        else
+            worker->partial.unreadable++;
+        tracker_free(&tracker);
+        trace_end("report_profile", span);
+    }
+    return NULL;
+}
+
+/* Collects every folder under `root` (relative to it) that holds a
+ * tracker.dat. Symlinked folders are not followed. */
+static void scan_profiles(const char *root, const char *relative, GPtrArray *profiles)
+{
+    gchar *dir = g_build_filename(root, relative, NULL);
+    GDir *listing = g_dir_open(dir, 0, NULL);
+    if (!listing) {
+        g_free(dir);
+        return;
+    }
+
+    gchar *tracker_path = g_build_filename(dir, TRACKER_FILE_NAME, NULL);
+    if (g_file_test(tracker_path, G_FILE_TEST_IS_REGULAR))
+        g_ptr_array_add(profiles, g_strdup(relative));
+    g_free(tracker_path);
+
+    const gchar *name;
+    while ((name = g_dir_read_name(listing))) {
+        gchar *child = g_build_filename(dir, name, NULL);
+        if (g_file_test(child, G_FILE_TEST_IS_DIR) && !g_file_test(child, G_FILE_TEST_IS_SYMLINK)) {
+            gchar *child_relative = g_str_equal(relative, ".") ? g_strdup(name)
+                                                               : g_build_filename(relative, name, NULL);
+            scan_profiles(root, child_relative, profiles);
+            g_free(child_relative);
+        }
+        g_free(child);
+    }
+    g_dir_close(listing);
+    g_free(dir);
+}
+
+static gint compare_paths(gconstpointer a, gconstpointer b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+/* Rolls up every profile under `root` with the statistics panel's
+ * definitions, keeping the `k` most and least complete habits. Profiles are
+ * loaded one at a time per thread; `threads` <= 0 uses every core. */
+gboolean tracker_report_run(TrackerReport *report, const char *root, int k, int threads)
+{
+    report_init(report, k);
+    if (!g_file_test(root, G_FILE_TEST_IS_DIR)) {
+        g_warning("%s is not a folder", root);
+        return FALSE;
+    }
+
+    gint64 span = trace_begin();
+    GPtrArray *profiles = g_ptr_array_new_with_free_func(g_free);
+    scan_profiles(root, ".", profiles);
+    g_ptr_array_sort(profiles, compare_paths);
+    trace_end("report_scan", span);
+
+    ReportRun run = { root, profiles, NULL, 0 };
+    if (threads <= 0)
+        threads = (int)g_get_num_processors();
+    run.worker_count = CLAMP(threads, 1, (int)MAX(profiles->len, 1));
+    run.workers = g_new0(ReportWorker, run.worker_count);
+
+    span = trace_begin();
+    for (int i = 0; i < run.worker_count; i++) {
+        ReportWorker *worker = &run.workers[i];
+        worker->run = &run;
+        worker->index = i;
+        g_mutex_init(&worker->range.lock);
+        worker->range.next = (guint)((guint64)profiles->len * i / run.worker_count);
+        worker->range.end = (guint)((guint64)profiles->len * (i + 1) / run.worker_count);
+        report_init(&worker->partial, k);
+    }
+    for (int i = 1; i < run.worker_count; i++)
+        run.workers[i].thread = g_thread_new("report", report_worker_main, &run.workers[i]);
+    report_worker_main(&run.workers[0]);
+
+    for (int i = 0; i < run.worker_count; i++) {
+        ReportWorker *worker = &run.workers[i];
+        if (worker->thread)
+            g_thread_join(worker->thread);
+        report_merge(report, &worker->partial);
+        tracker_report_free(&worker->partial);
+        g_mutex_clear(&worker->range.lock);
+    }
+    trace_end("report_profiles", span);
+
+    g_array_sort(report->top, entry_rank_desc);
+    g_array_sort(report->bottom, entry_rank_asc);
+    g_free(run.workers);
+    g_ptr_array_free(profiles, TRUE);
+    return TRUE;
+}
+
+void tracker_report_free(TrackerReport *report)
+{
+    for (guint i = 0; report->top && i < report->top->len; i++)
+        g_free(g_array_index(report->top, ReportEntry, i).profile);
+    for (guint i = 0; report->bottom && i < report->bottom->len; i++)
+        g_free(g_array_index(report->bottom, ReportEntry, i).profile);
+    if (report->top)
+        g_array_free(report->top, TRUE);
+    if (report->bottom)
+        g_array_free(report->bottom, TRUE);
+    g_free(report->week_checked);
+    g_free(report->week_cells);
+    memset(report, 0, sizeof(*report));
+}
+
+static void format_entries(GString *out, const char *title, const GArray *entries)
+{
+    g_string_append_printf(out, "\n%s:\n", title);
+    for (guint i = 0; i < entries->len; i++) {
+        const ReportEntry *entry = &g_array_index(entries, ReportEntry, i);
+        g_string_append_printf(out, "%u. %s: %s %d/%d (%d%%)\n", i + 1, entry->profile, entry->name,
+                               entry->checked, entry->days, (entry->checked * 100) / entry->days);
+    }
+}
+
+gchar *tracker_report_format(const TrackerReport *report)
+{
+    GString *out = g_string_new("");
+    gint64 percent = (report->cells > 0) ? (report->checked * 100) / report->cells : 0;
+    double average = (report->profiles > 0) ? report->percent_sum / (double)report->profiles : 0.0;
+
+    g_string_append_printf(out, "Profiles: %" G_GINT64_FORMAT, report->profiles);
+    if (report->unreadable > 0)
+        g_string_append_printf(out, " (%" G_GINT64_FORMAT " unreadable)", report->unreadable);
+    g_string_append_printf(out, "\nTotal complete: %" G_GINT64_FORMAT " / %" G_GINT64_FORMAT " (%" G_GINT64_FORMAT "%%)\n",
+                           report->checked, report->cells, percent);
+    g_string_append_printf(out, "Average completion per profile: %.1f%%\n", average);
+
+    format_entries(out, "Most complete habits", report->top);
+    format_entries(out, "Least complete habits", report->bottom);
+
+    g_string_append(out, "\nWeekly trend:\n");
+    for (int w = 0; w < report->week_count && report->week_cells[w] > 0; w++) {
+        g_string_append_printf(out, "W%d: %" G_GINT64_FORMAT "/%" G_GINT64_FORMAT " (%" G_GINT64_FORMAT "%%)\n",
+                               w + 1, report->week_checked[w], report->week_cells[w],
+                               (report->week_checked[w] * 100) / report->week_cells[w]);
+    }
+    return g_string_free(out, FALSE);
+}
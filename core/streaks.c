@@ -0,0 +1,177 @@
+#include "habit_core.h"
+
+void habit_streaks_init(HabitStreaks *streaks, int habit_count)
+{
+    streaks->habit_count = habit_count;
+    streaks->runs = g_new0(GArray *, habit_count);
+    streaks->longest = g_new0(int, habit_count);
+}
+
+void habit_streaks_free(HabitStreaks *streaks)
+{
+    if (!streaks->runs)
+        return;
+
+    habit_streaks_reset(streaks, -1);
+    g_free(streaks->runs);
+    g_free(streaks->longest);
+    streaks->runs = NULL;
+    streaks->longest = NULL;
+}
+
+static void streaks_update_longest(HabitStreaks *streaks, int habit)
+{
+    const GArray *runs = streaks->runs[habit];
+    int longest = 0;
+    for (guint i = 0; i < runs->len; i++)
+        longest = MAX(longest, g_array_index(runs, StreakRun, i).length);
+    streaks->longest[habit] = longest;
+}
+
+/* Walks each history word a run at a time: trailing zeros give the gap to
+ * the next check-in, trailing ones of the inverse give the run length. */
+static void streaks_scan(GArray *runs, const HistoryStore *hist, int habit)
+{
+    g_array_set_size(runs, 0);
+    for (guint i = 0; i < hist->segments->len; i++) {
+        const HistorySegment *seg = &g_array_index(hist->segments, HistorySegment, i);
+        guint64 word = seg->words[habit];
+        int base = (int)(seg->index * HISTORY_SEGMENT_DAYS);
+        int bit = 0;
+
+        while (word) {
+            int gap = lowest_bit64(word);
+            word >>= gap;
+            bit += gap;
+            int length = (~word == 0) ? HISTORY_SEGMENT_DAYS - bit : lowest_bit64(~word);
+
+            StreakRun *last = runs->len ? &g_array_index(runs, StreakRun, runs->len - 1) : NULL;
+            if (last && last->start + last->length == base + bit) {
+                last->length += length;
+            } else {
+                StreakRun run = { base + bit, length };
+                g_array_append_val(runs, run);
+            }
+
+            bit += length;
+            word = (length == HISTORY_SEGMENT_DAYS) ? 0 : word >> length;
+        }
+    }
+}
+
+/* Drops one habit's runs, or every habit's when `habit` < 0. Runs are only
+ * scanned from the history when first asked for, so loading or replacing a
+ * long history does not walk it for every habit up front. */
+void habit_streaks_reset(HabitStreaks *streaks, int habit)
+{
+    int first = habit < 0 ? 0 : habit;
+    int last = habit < 0 ? streaks->habit_count : habit + 1;
+
+    for (int h = first; h < last; h++) {
+        if (streaks->runs[h])
+            g_array_free(streaks->runs[h], TRUE);
+        streaks->runs[h] = NULL;
+    }
+}
+
+static const GArray *streaks_runs(HabitStreaks *streaks, const HistoryStore *hist, int habit)
+{
+    if (!streaks->runs[habit]) {
+        streaks->runs[habit] = g_array_new(FALSE, FALSE, sizeof(StreakRun));
+        if (habit < hist->habit_count)
+            streaks_scan(streaks->runs[habit], hist, habit);
+        streaks_update_longest(streaks, habit);
+    }
+    return streaks->runs[habit];
+}
+
+/* Index of the first run starting after `day`. */
+static guint streaks_upper_bound(const GArray *runs, int day)
+{
+    guint lo = 0;
+    guint hi = runs->len;
+
+    while (lo < hi) {
+        guint mid = lo + (hi - lo) / 2;
+        if (g_array_index(runs, StreakRun, mid).start <= day)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Folds a single flipped cell (absolute `day`) into the runs: a check-in
+ * extends or joins its neighbours, an uncheck shortens or splits its run. */
+void habit_streaks_apply(HabitStreaks *streaks, int habit, int day, gboolean value)
+{
+    GArray *runs = streaks->runs[habit];
+    if (!runs)
+        return;
+
+    guint next = streaks_upper_bound(runs, day);
+    StreakRun *prev = next > 0 ? &g_array_index(runs, StreakRun, next - 1) : NULL;
+
+    if (value) {
+        gboolean joins_prev = prev && prev->start + prev->length == day;
+        gboolean joins_next = next < runs->len && g_array_index(runs, StreakRun, next).start == day + 1;
+        int length;
+
+        if (joins_prev && joins_next) {
+            prev->length += 1 + g_array_index(runs, StreakRun, next).length;
+            length = prev->length;
+            g_array_remove_index(runs, next);
+        } else if (joins_prev) {
+            length = ++prev->length;
+        } else if (joins_next) {
+            StreakRun *run = &g_array_index(runs, StreakRun, next);
+            run->start--;
+            length = ++run->length;
+        } else {
+            StreakRun run = { day, 1 };
+            g_array_insert_val(runs, next, run);
+            length = 1;
+        }
+        streaks->longest[habit] = MAX(streaks->longest[habit], length);
+        return;
+    }
+
+    if (!prev || prev->start + prev->length <= day)
+        return;
+
+    int old_length = prev->length;
+    int head = day - prev->start;
+    int tail = old_length - head - 1;
+    if (head == 0 && tail == 0) {
+        g_array_remove_index(runs, next - 1);
+    } else if (head == 0) {
+        prev->start++;
+        prev->length--;
+    } else {
+        prev->length = head;
+        if (tail > 0) {
+            StreakRun run = { day + 1, tail };
+            g_array_insert_val(runs, next, run);
+        }
+    }
+    if (old_length == streaks->longest[habit])
+        streaks_update_longest(streaks, habit);
+}
+
+/* The run covering absolute `day`, or NULL when the day is not checked. */
+const StreakRun *habit_streaks_find(HabitStreaks *streaks, const HistoryStore *hist, int habit, int day)
+{
+    const GArray *runs = streaks_runs(streaks, hist, habit);
+    guint next = streaks_upper_bound(runs, day);
+    if (next == 0)
+        return NULL;
+
+    const StreakRun *run = &g_array_index(runs, StreakRun, next - 1);
+    return run->start + run->length > day ? run : NULL;
+}
+
+int habit_streaks_longest(HabitStreaks *streaks, const HistoryStore *hist, int habit)
+{
+    streaks_runs(streaks, hist, habit);
+    return streaks->longest[habit];
+}
@@ -0,0 +1,134 @@
+#include "habit_core.h"
+
+typedef struct {
+    const char *name;
+    gint64 start;
+    gint64 duration;
+} TraceEvent;
+
+typedef struct {
+    int tid;
+    const char *thread_name;
+    gint count;
+    int dropped;
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+} TraceBuffer;
+
+gint trace_active;
+
+static char *trace_path;
+static gint64 trace_epoch;
+static GMutex trace_lock;
+static GSList *trace_buffers;
+static int trace_next_tid = 1;
+static GPrivate trace_local;
+
+static TraceBuffer *trace_buffer(void)
+{
+    TraceBuffer *buffer = g_private_get(&trace_local);
+    if (buffer)
+        return buffer;
+
+    buffer = g_new0(TraceBuffer, 1);
+    g_mutex_lock(&trace_lock);
+    buffer->tid = trace_next_tid++;
+    trace_buffers = g_slist_prepend(trace_buffers, buffer);
+    g_mutex_unlock(&trace_lock);
+    g_private_set(&trace_local, buffer);
+    return buffer;
+}
+
+void trace_init(void)
+{
+    const char *path = g_getenv(TRACE_ENV);
+    if (!path || path[0] == '\0' || trace_path)
+        return;
+
+    trace_path = g_strdup(path);
+    trace_epoch = g_get_monotonic_time();
+    g_atomic_int_set(&trace_active, 1);
+    trace_name_thread("main");
+}
+
+void trace_name_thread(const char *name)
+{
+    if (g_atomic_int_get(&trace_active))
+        trace_buffer()->thread_name = name;
+}
+
+void trace_record(const char *name, gint64 start)
+{
+    gint64 end = g_get_monotonic_time();
+    TraceBuffer *buffer = trace_buffer();
+    int count = buffer->count;
+
+    if (count >= TRACE_BUFFER_EVENTS) {
+        buffer->dropped++;
+        return;
+    }
+
+    buffer->events[count].name = name;
+    buffer->events[count].start = start;
+    buffer->events[count].duration = end - start;
+    g_atomic_int_set(&buffer->count, count + 1);
+}
+
+static void trace_write_buffer(GString *json, const TraceBuffer *buffer, gboolean *first)
+{
+    if (buffer->thread_name) {
+        g_string_append_printf(json,
+                               "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                               "\"args\":{\"name\":\"%s\"}}",
+                               *first ? "" : ",", buffer->tid, buffer->thread_name);
+        *first = FALSE;
+    }
+
+    int count = g_atomic_int_get(&buffer->count);
+    for (int i = 0; i < count; i++) {
+        const TraceEvent *event = &buffer->events[i];
+        g_string_append_printf(json,
+                               "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                               "\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT "}",
+                               *first ? "" : ",", event->name, buffer->tid,
+                               event->start - trace_epoch, event->duration);
+        *first = FALSE;
+    }
+}
+
+void trace_shutdown(void)
+{
+    if (!trace_path)
+        return;
+
+    g_atomic_int_set(&trace_active, 0);
+
+    GString *json = g_string_new("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    gboolean first = TRUE;
+    int dropped = 0;
+
+    g_mutex_lock(&trace_lock);
+    for (GSList *l = trace_buffers; l; l = l->next) {
+        TraceBuffer *buffer = l->data;
+        trace_write_buffer(json, buffer, &first);
+        dropped += buffer->dropped;
+        g_free(buffer);
+    }
+    g_slist_free(trace_buffers);
+    trace_buffers = NULL;
+    g_mutex_unlock(&trace_lock);
+    g_private_set(&trace_local, NULL);
+
+    g_string_append(json, "\n]}\n");
+
+    GError *error = NULL;
+    if (!g_file_set_contents(trace_path, json->str, (gssize)json->len, &error)) {
+        g_warning("could not write trace to %s: %s", trace_path, error->message);
+        g_error_free(error);
+    }
+    if (dropped > 0)
+        g_warning("trace buffers were full, dropped %d spans", dropped);
+
+    g_string_free(json, TRUE);
+    g_free(trace_path);
+    trace_path = NULL;
+}
@@ -0,0 +1,570 @@
+#include "habit_core.h"
+#include <string.h>
+
+void tracker_reset_names(HabitTracker *tracker)
+{
+    tracker->names = tracker->name_storage;
+    for (int i = 0; i < tracker->habit_count; i++)
+        g_snprintf(tracker->names[i], NAME_LEN, "Habit %d", i + 1);
+}
+
+void tracker_init(HabitTracker *tracker, const char *data_dir, int habit_count, int day_capacity)
+{
+    memset(tracker, 0, sizeof(*tracker));
+    tracker->data_dir = g_strdup(data_dir);
+    tracker->tracker_path = g_build_filename(data_dir, TRACKER_FILE_NAME, NULL);
+    tracker->journal_path = g_build_filename(data_dir, JOURNAL_FILE_NAME, NULL);
+    tracker->habit_count = habit_count;
+    tracker->day_capacity = day_capacity;
+    tracker->day_count = MIN(DEFAULT_DAY_COUNT, day_capacity);
+    tracker->name_storage = g_malloc0((gsize)habit_count * NAME_LEN);
+    tracker_reset_names(tracker);
+
+    history_store_init(&tracker->history, habit_count, day_capacity, today_day_number());
+    habit_store_init(&tracker->store, habit_count, day_capacity);
+    habit_stats_init(&tracker->stats, habit_count, day_capacity);
+    habit_stats_rebuild(&tracker->stats, &tracker->store, tracker->day_count);
+    habit_streaks_init(&tracker->streaks, habit_count);
+}
+
+void tracker_free(HabitTracker *tracker)
+{
+    tracker_stop_persistence(tracker);
+    habit_stats_free(&tracker->stats);
+    habit_streaks_free(&tracker->streaks);
+    habit_store_free(&tracker->store);
+    history_store_free(&tracker->history);
+    g_free(tracker->name_storage);
+    g_free(tracker->data_dir);
+    g_free(tracker->tracker_path);
+    g_free(tracker->journal_path);
+    tracker->names = NULL;
+    tracker->name_storage = NULL;
+}
+
+/* Grows the tracker to at least `habit_count` habits and `day_capacity`
+ * days; it never shrinks, so nothing saved is dropped. */
+void tracker_resize(HabitTracker *tracker, int habit_count, int day_capacity)
+{
+    habit_count = MAX(habit_count, tracker->habit_count);
+    day_capacity = MAX(day_capacity, tracker->day_capacity);
+    if (habit_count == tracker->habit_count && day_capacity == tracker->day_capacity)
+        return;
+
+    char (*names)[NAME_LEN] = g_malloc0((gsize)habit_count * NAME_LEN);
+    memcpy(names, tracker->names, (gsize)tracker->habit_count * NAME_LEN);
+    for (int i = tracker->habit_count; i < habit_count; i++)
+        g_snprintf(names[i], NAME_LEN, "Habit %d", i + 1);
+    g_free(tracker->name_storage);
+    tracker->name_storage = names;
+    tracker->names = names;
+
+    history_store_resize(&tracker->history, habit_count, day_capacity);
+    tracker->habit_count = habit_count;
+    tracker->day_capacity = day_capacity;
+    habit_stats_free(&tracker->stats);
+    habit_streaks_free(&tracker->streaks);
+    habit_store_free(&tracker->store);
+    habit_store_init(&tracker->store, habit_count, day_capacity);
+    habit_stats_init(&tracker->stats, habit_count, day_capacity);
+    habit_streaks_init(&tracker->streaks, habit_count);
+    tracker_reload_window(tracker);
+}
+
+static int count_check_ins(const HabitTracker *tracker, int start_day, int end_day)
+{
+    int count = 0;
+    for (int i = 0; i < tracker->habit_count; i++)
+        count += history_count_range(&tracker->history, i, start_day, end_day);
+    return count;
+}
+
+/* Check-ins before the current cycle. Counting them walks the whole
+ * history, so it waits until something asks and is then kept up to date. */
+int tracker_archived_check_ins(const HabitTracker *tracker)
+{
+    if (tracker->archived_check_ins < 0)
+        ((HabitTracker *)tracker)->archived_check_ins = count_check_ins(tracker, 0, tracker->history.cycle_start);
+    return tracker->archived_check_ins;
+}
+
+static void load_legacy_states(HabitTracker *tracker)
+{
+    gchar *path = g_build_filename(tracker->data_dir, LEGACY_STATES_FILE_NAME, NULL);
+    FILE *f = fopen(path, "rb");
+    g_free(path);
+    if (!f)
+        return;
+
+    size_t expected = ITEM_COUNT * MAX_DAY_COUNT;
+    gboolean *legacy = g_new0(gboolean, expected);
+    size_t read_count = fread(legacy, sizeof(gboolean), expected, f);
+    fclose(f);
+
+    for (size_t idx = 0; idx < read_count; idx++) {
+        int habit = (int)(idx / MAX_DAY_COUNT);
+        int day = (int)(idx % MAX_DAY_COUNT);
+        if (legacy[idx] && habit < tracker->habit_count && day < tracker->day_capacity)
+            history_set(&tracker->history, habit, tracker->history.cycle_start + day, TRUE);
+    }
+    g_free(legacy);
+}
+
+static void load_legacy_habit_names(HabitTracker *tracker)
+{
+    gchar *path = g_build_filename(tracker->data_dir, LEGACY_HABITS_FILE_NAME, NULL);
+    FILE *f = fopen(path, "rb");
+    g_free(path);
+    if (!f)
+        return;
+
+    char legacy[ITEM_COUNT][NAME_LEN];
+    size_t read_count = fread(legacy, sizeof(legacy[0][0]), ITEM_COUNT * NAME_LEN, f);
+    fclose(f);
+
+    if (read_count != (size_t)(ITEM_COUNT * NAME_LEN))
+        return;
+
+    for (int i = 0; i < ITEM_COUNT && i < tracker->habit_count; i++) {
+        legacy[i][NAME_LEN - 1] = '\0';
+        if (legacy[i][0] != '\0')
+            g_strlcpy(tracker->names[i], legacy[i], NAME_LEN);
+    }
+}
+
+static void load_legacy_settings(HabitTracker *tracker)
+{
+    gchar *path = g_build_filename(tracker->data_dir, LEGACY_SETTINGS_FILE_NAME, NULL);
+    FILE *f = fopen(path, "rb");
+    g_free(path);
+    if (!f)
+        return;
+
+    int loaded = DEFAULT_DAY_COUNT;
+    if (fread(&loaded, sizeof(loaded), 1, f) == 1 && loaded >= 1 && loaded <= tracker->day_capacity)
+        tracker->day_count = loaded;
+    fclose(f);
+}
+
+void tracker_reload_window(HabitTracker *tracker)
+{
+    history_read_window(&tracker->history, &tracker->store);
+    habit_stats_rebuild(&tracker->stats, &tracker->store, tracker->day_count);
+    habit_streaks_reset(&tracker->streaks, -1);
+    tracker->archived_check_ins = -1;
+}
+
+gboolean tracker_read_disk(HabitTracker *tracker)
+{
+    GMappedFile *mapping = g_mapped_file_new(tracker->tracker_path, TRUE, NULL);
+    if (!mapping)
+        return FALSE;
+
+    gboolean ok = tracker_file_load(tracker, mapping, TRUE);
+    g_mapped_file_unref(mapping);
+    if (ok)
+        replay_journal(tracker->journal_path, &tracker->history);
+    return ok;
+}
+
+gboolean tracker_load(HabitTracker *tracker)
+{
+    gint64 load_span = trace_begin();
+    gboolean needs_snapshot = FALSE;
+    GError *error = NULL;
+    gchar *lock_path = g_build_filename(tracker->data_dir, LOCK_FILE_NAME, NULL);
+    int lock = data_lock_acquire(lock_path, FALSE);
+    g_free(lock_path);
+    GMappedFile *mapping = g_mapped_file_new(tracker->tracker_path, TRUE, &error);
+
+    if (mapping) {
+        gint64 span = trace_begin();
+        gboolean loaded = tracker_file_load(tracker, mapping, FALSE);
+        trace_end("tracker_file_load", span);
+        tracker->history_unverified = loaded;
+        g_mapped_file_unref(mapping);
+
+        if (!loaded) {
+            gchar *corrupt_path = g_strdup_printf("%s.corrupt", tracker->tracker_path);
+            g_warning("%s is unreadable, keeping a copy at %s", tracker->tracker_path, corrupt_path);
+            remove(corrupt_path);
+            rename(tracker->tracker_path, corrupt_path);
+            g_free(corrupt_path);
+
+            tracker_reset_names(tracker);
+            history_store_free(&tracker->history);
+            history_store_init(&tracker->history, tracker->habit_count, tracker->day_capacity, today_day_number());
+            needs_snapshot = TRUE;
+        }
+    } else if (g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+        gint64 span = trace_begin();
+        gchar *legacy_journal = g_build_filename(tracker->data_dir, LEGACY_JOURNAL_FILE_NAME, NULL);
+        load_legacy_states(tracker);
+        load_legacy_habit_names(tracker);
+        load_legacy_settings(tracker);
+        replay_journal(legacy_journal, &tracker->history);
+        g_free(legacy_journal);
+        trace_end("legacy_import", span);
+        needs_snapshot = TRUE;
+    } else {
+        g_warning("could not map %s: %s", tracker->tracker_path, error->message);
+        g_error_free(error);
+        data_lock_release(lock);
+        trace_end("tracker_load", load_span);
+        return FALSE;
+    }
+    g_clear_error(&error);
+
+    gint64 span = trace_begin();
+    if (!replay_journal(tracker->journal_path, &tracker->history))
+        needs_snapshot = TRUE;
+    trace_end("replay_journal", span);
+    data_stamp_read(&tracker->disk_stamp, tracker->tracker_path, tracker->journal_path);
+    data_lock_release(lock);
+
+    span = trace_begin();
+    tracker_reload_window(tracker);
+    trace_end("rebuild_stats", span);
+
+    trace_end("tracker_load", load_span);
+    return needs_snapshot;
+}
+
+void tracker_start_persistence(HabitTracker *tracker, gboolean snapshot_now)
+{
+    persist_worker_start(&tracker->persist, tracker, snapshot_now);
+}
+
+void tracker_stop_persistence(HabitTracker *tracker)
+{
+    persist_worker_stop(&tracker->persist);
+}
+
+gboolean tracker_get_cell(const HabitTracker *tracker, int habit, int day)
+{
+    return habit_store_get(&tracker->store, habit, day);
+}
+
+void tracker_set_cell(HabitTracker *tracker, int habit, int day, gboolean value)
+{
+    if (!habit_store_set(&tracker->store, habit, day, value))
+        return;
+
+    gint64 span = trace_begin();
+    habit_stats_apply(&tracker->stats, habit, day, value ? 1 : -1);
+    history_set(&tracker->history, habit, tracker->history.cycle_start + day, value);
+    habit_streaks_apply(&tracker->streaks, habit, tracker->history.cycle_start + day, value);
+    persist_journal(&tracker->persist, JOURNAL_SET_CELL, habit, day, value);
+    trace_end("tracker_set_cell", span);
+}
+
+/* Brings stats, history and streaks up to date with window cells that were
+ * already written to the store, then journals them in one go. */
+static void tracker_commit_cells(HabitTracker *tracker, const GArray *cells)
+{
+    if (cells->len == 0)
+        return;
+
+    gint64 span = trace_begin();
+    int start = tracker->history.cycle_start;
+    GByteArray *records = g_byte_array_sized_new(cells->len * JOURNAL_RECORD_SIZE);
+    guint8 record[JOURNAL_RECORD_SIZE];
+
+    for (guint i = 0; i < cells->len; i++) {
+        const CellChange *cell = &g_array_index(cells, CellChange, i);
+        habit_stats_apply(&tracker->stats, cell->habit, cell->day, cell->value ? 1 : -1);
+        history_set(&tracker->history, cell->habit, start + cell->day, cell->value);
+        habit_streaks_apply(&tracker->streaks, cell->habit, start + cell->day, cell->value);
+        journal_encode(record, JOURNAL_SET_CELL, cell->habit, cell->day, cell->value);
+        g_byte_array_append(records, record, JOURNAL_RECORD_SIZE);
+    }
+    persist_journal_records(&tracker->persist, records->data, records->len);
+    g_byte_array_free(records, TRUE);
+    trace_end("tracker_commit_cells", span);
+}
+
+/* Applies a list of window cell writes as one transaction. On return `cells`
+ * holds only the writes that changed something; returns how many. */
+guint tracker_apply_cells(HabitTracker *tracker, GArray *cells)
+{
+    guint kept = 0;
+    for (guint i = 0; i < cells->len; i++) {
+        CellChange cell = g_array_index(cells, CellChange, i);
+        if (cell.habit < 0 || cell.habit >= tracker->habit_count || cell.day < 0 || cell.day >= tracker->day_capacity)
+            continue;
+        if (habit_store_set(&tracker->store, cell.habit, cell.day, cell.value))
+            g_array_index(cells, CellChange, kept++) = cell;
+    }
+    g_array_set_size(cells, kept);
+    tracker_commit_cells(tracker, cells);
+    return kept;
+}
+
+/* Sets every cell of the inclusive habits x days rectangle to `value`. The
+ * cells that flipped are appended to `changed` when it is not NULL. */
+guint tracker_set_range(HabitTracker *tracker, int first_habit, int last_habit, int first_day, int last_day,
+                        gboolean value, GArray *changed)
+{
+    GArray *cells = g_array_new(FALSE, FALSE, sizeof(CellChange));
+    first_habit = MAX(first_habit, 0);
+    last_habit = MIN(last_habit, tracker->habit_count - 1);
+    for (int i = first_habit; i <= last_habit; i++)
+        habit_store_fill_range(&tracker->store, i, first_day, last_day + 1, value, cells);
+
+    tracker_commit_cells(tracker, cells);
+    guint count = cells->len;
+    if (changed)
+        g_array_append_vals(changed, cells->data, cells->len);
+    g_array_free(cells, TRUE);
+    return count;
+}
+
+void tracker_clear_habit(HabitTracker *tracker, int habit)
+{
+    const HabitStore *store = &tracker->store;
+    const guint64 *row = habit_store_row(store, habit);
+    for (int w = 0; w < store->words_per_habit; w++) {
+        guint64 word = row[w];
+        while (word) {
+            int day = w * 64 + lowest_bit64(word) - store->head;
+            habit_stats_apply(&tracker->stats, habit, day < 0 ? day + store->ring_days : day, -1);
+            word &= word - 1;
+        }
+    }
+
+    int start = tracker->history.cycle_start;
+    habit_store_clear_habit(&tracker->store, habit);
+    history_clear_range(&tracker->history, habit, start, start + tracker->day_capacity);
+    habit_streaks_reset(&tracker->streaks, habit);
+    persist_journal(&tracker->persist, JOURNAL_CLEAR_HABIT, habit, 0, FALSE);
+}
+
+void tracker_start_new_cycle(HabitTracker *tracker)
+{
+    int start = tracker->history.cycle_start;
+    int next_start = start + tracker->day_count;
+
+    if (tracker->archived_check_ins >= 0)
+        tracker->archived_check_ins += count_check_ins(tracker, start, next_start);
+    tracker->history.cycle_start = next_start;
+    history_clear_range(&tracker->history, -1, next_start, next_start + tracker->day_capacity);
+    habit_streaks_reset(&tracker->streaks, -1);
+    habit_store_clear(&tracker->store);
+    habit_stats_rebuild(&tracker->stats, &tracker->store, tracker->day_count);
+    persist_journal(&tracker->persist, JOURNAL_NEW_CYCLE, 0, next_start, FALSE);
+}
+
+/* Slides the window forward one day: the oldest day is archived and the
+ * newest is read from the history, touching one slot per habit. */
+static void tracker_advance_day(HabitTracker *tracker)
+{
+    HabitStore *store = &tracker->store;
+    int last = tracker->day_capacity - 1;
+
+    for (int i = 0; i < tracker->habit_count; i++) {
+        if (habit_store_set(store, i, 0, FALSE)) {
+            habit_stats_apply(&tracker->stats, i, 0, -1);
+            if (tracker->archived_check_ins >= 0)
+                tracker->archived_check_ins++;
+        }
+    }
+    habit_store_advance(store);
+    habit_stats_advance(&tracker->stats, store);
+
+    int day = ++tracker->history.cycle_start + last;
+    for (int i = 0; i < tracker->habit_count; i++) {
+        if (history_get(&tracker->history, i, day)) {
+            habit_store_set(store, i, last, TRUE);
+            habit_stats_apply(&tracker->stats, i, last, 1);
+        }
+    }
+}
+
+static void tracker_move_window(HabitTracker *tracker, int start)
+{
+    int delta = start - tracker->history.cycle_start;
+    if (delta > 0 && delta < tracker->day_capacity) {
+        while (delta-- > 0)
+            tracker_advance_day(tracker);
+        return;
+    }
+
+    tracker->history.cycle_start = start;
+    tracker_reload_window(tracker);
+}
+
+/* In rolling mode the window always ends today. Moving it only writes a
+ * journal record; the cells themselves stay where they are in the history.
+ * Returns TRUE if the window moved. */
+gboolean tracker_roll_to_today(HabitTracker *tracker)
+{
+    if (!tracker->history.rolling)
+        return FALSE;
+
+    int start = today_day_number() - tracker->day_count + 1;
+    if (start == tracker->history.cycle_start)
+        return FALSE;
+
+    tracker_move_window(tracker, start);
+    persist_journal(&tracker->persist, JOURNAL_MOVE_WINDOW, 0, start, TRUE);
+    return TRUE;
+}
+
+void tracker_set_rolling(HabitTracker *tracker, gboolean rolling)
+{
+    if (rolling == tracker->history.rolling)
+        return;
+
+    tracker->history.rolling = rolling;
+    if (!tracker_roll_to_today(tracker))
+        persist_journal(&tracker->persist, JOURNAL_MOVE_WINDOW, 0, tracker->history.cycle_start, rolling);
+}
+
+void tracker_set_day_count(HabitTracker *tracker, int day_count)
+{
+    if (day_count < 1 || day_count > tracker->day_capacity || day_count == tracker->day_count)
+        return;
+
+    tracker->day_count = day_count;
+    habit_stats_set_day_count(&tracker->stats, &tracker->store, day_count);
+    persist_settings(&tracker->persist, day_count);
+    tracker_roll_to_today(tracker);
+}
+
+void tracker_rename_habit(HabitTracker *tracker, int habit, const char *name)
+{
+    g_strlcpy(tracker->names[habit], name, NAME_LEN);
+    persist_names(&tracker->persist, (const char *)tracker->names, tracker->habit_count);
+}
+
+/* Appends a habit with no check-ins; returns its index, or -1 once the
+ * tracker holds MAX_HABIT_COUNT habits. */
+int tracker_add_habit(HabitTracker *tracker, const char *name)
+{
+    if (tracker->habit_count >= MAX_HABIT_COUNT)
+        return -1;
+
+    int habit = tracker->habit_count;
+    tracker_resize(tracker, habit + 1, 0);
+    if (name && name[0] != '\0')
+        g_strlcpy(tracker->names[habit], name, NAME_LEN);
+    persist_history(&tracker->persist, &tracker->history);
+    persist_names(&tracker->persist, (const char *)tracker->names, tracker->habit_count);
+    return habit;
+}
+
+/* Names loaded in place live in the history's file mapping; copy them out
+ * before that mapping can be released. */
+static void tracker_own_names(HabitTracker *tracker)
+{
+    if (tracker->names == tracker->name_storage)
+        return;
+    memcpy(tracker->name_storage, tracker->names, (gsize)tracker->habit_count * NAME_LEN);
+    tracker->names = tracker->name_storage;
+}
+
+/* Folds in check-ins saved by another instance, touching only the cells that
+ * differ. On return change->cells holds the window cells that flipped. */
+guint tracker_apply_change(HabitTracker *tracker, TrackerChange *change)
+{
+    guint flags = 0;
+
+    if (change->habit_count > tracker->habit_count) {
+        tracker_resize(tracker, change->habit_count, 0);
+        flags |= TRACKER_CHANGED_NAMES | TRACKER_CHANGED_LAYOUT;
+    }
+    if (change->history) {
+        tracker_own_names(tracker);
+        history_store_free(&tracker->history);
+        history_store_copy(&tracker->history, change->history);
+        history_store_resize(&tracker->history, tracker->habit_count, tracker->day_capacity);
+        tracker_reload_window(tracker);
+        g_array_set_size(change->cells, 0);
+        flags |= TRACKER_CHANGED_CELLS | TRACKER_CHANGED_LAYOUT;
+    }
+
+    int start = tracker->history.cycle_start;
+    guint kept = 0;
+    for (guint i = 0; i < change->cells->len; i++) {
+        CellChange cell = g_array_index(change->cells, CellChange, i);
+        if (cell.habit >= tracker->habit_count || !history_set(&tracker->history, cell.habit, cell.day, cell.value))
+            continue;
+        habit_streaks_apply(&tracker->streaks, cell.habit, cell.day, cell.value);
+
+        int day = cell.day - start;
+        if (day < 0) {
+            if (tracker->archived_check_ins >= 0)
+                tracker->archived_check_ins += cell.value ? 1 : -1;
+        } else if (day < tracker->day_capacity && habit_store_set(&tracker->store, cell.habit, day, cell.value)) {
+            habit_stats_apply(&tracker->stats, cell.habit, day, cell.value ? 1 : -1);
+            cell.day = day;
+            g_array_index(change->cells, CellChange, kept++) = cell;
+        }
+    }
+    g_array_set_size(change->cells, kept);
+    if (kept > 0)
+        flags |= TRACKER_CHANGED_CELLS;
+
+    if (change->names) {
+        for (int i = 0; i < MIN(tracker->habit_count, change->habit_count); i++) {
+            const char *name = change->names + (size_t)i * NAME_LEN;
+            if (strcmp(tracker->names[i], name) != 0) {
+                g_strlcpy(tracker->names[i], name, NAME_LEN);
+                flags |= TRACKER_CHANGED_NAMES;
+            }
+        }
+    }
+
+    if (change->day_count >= 1 && change->day_count <= tracker->day_capacity &&
+        change->day_count != tracker->day_count) {
+        tracker->day_count = change->day_count;
+        habit_stats_set_day_count(&tracker->stats, &tracker->store, change->day_count);
+        flags |= TRACKER_CHANGED_LAYOUT;
+    }
+    return flags;
+}
+
+/* Copies the names and shares the history copy-on-write, which is cheap
+ * enough for the main thread. The window, stats and streaks stay empty until
+ * tracker_snapshot_rebuild, which may run on another thread. */
+void tracker_snapshot(HabitTracker *dest, const HabitTracker *src)
+{
+    memset(dest, 0, sizeof(*dest));
+    dest->habit_count = src->habit_count;
+    dest->day_capacity = src->day_capacity;
+    dest->day_count = src->day_count;
+    dest->archived_check_ins = src->archived_check_ins;
+    dest->name_storage = g_memdup2(src->names, (gsize)src->habit_count * NAME_LEN);
+    dest->names = dest->name_storage;
+
+    history_store_copy(&dest->history, &src->history);
+}
+
+void tracker_snapshot_rebuild(HabitTracker *snapshot)
+{
+    habit_store_init(&snapshot->store, snapshot->habit_count, snapshot->day_capacity);
+    habit_stats_init(&snapshot->stats, snapshot->habit_count, snapshot->day_capacity);
+    habit_streaks_init(&snapshot->streaks, snapshot->habit_count);
+    tracker_reload_window(snapshot);
+}
+
+static gsize history_memory_size(const HistoryStore *hist)
+{
+    return hist->segments->len * (sizeof(HistorySegment) + (gsize)hist->habit_count * sizeof(guint64));
+}
+
+/* Approximate heap (and mapped) footprint, for cache budgets. */
+gsize tracker_memory_size(const HabitTracker *tracker)
+{
+    gsize habits = (gsize)tracker->habit_count;
+    gsize size = sizeof(*tracker) + habits * NAME_LEN;
+
+    size += habits * (gsize)tracker->store.words_per_habit * sizeof(guint64);
+    size += (habits + 2 * (gsize)tracker->stats.ring_days + 1) * sizeof(int);
+    size += history_memory_size(&tracker->history);
+    for (int h = 0; tracker->streaks.runs && h < tracker->streaks.habit_count; h++)
+        size += tracker->streaks.runs[h] ? tracker->streaks.runs[h]->len * sizeof(StreakRun) : 0;
+    if (tracker->persist.mirror.segments)
+        size += history_memory_size(&tracker->persist.mirror) + habits * NAME_LEN;
+    return size;
+}
@@ -0,0 +1,584 @@
+#include "habit_core.h"
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/file.h>
+#endif
+
+#define TRACKER_MAGIC "HABITDB\0"
+#define TRACKER_VERSION 2
+#define TRACKER_BYTE_ORDER_MARK 0x01020304u
+#define TRACKER_ALIGN 64
+#define TRACKER_SECTION_COUNT 3
+#define SETTINGS_ROLLING 1u
+
+enum {
+    SECTION_SETTINGS = 1,
+    SECTION_NAMES = 2,
+    SECTION_HISTORY = 4
+};
+
+typedef struct {
+    char magic[8];
+    guint32 version;
+    guint32 byte_order;
+    guint32 section_count;
+    guint32 table_checksum;
+    guint64 write_id;
+    guint8 reserved[32];
+} TrackerHeader;
+
+typedef struct {
+    guint32 type;
+    guint32 checksum;
+    guint64 offset;
+    guint64 size;
+    guint64 reserved;
+} TrackerSection;
+
+typedef struct {
+    guint32 day_count;
+    guint32 habit_count;
+    guint32 day_capacity;
+    guint32 name_len;
+    guint32 cycle_start;
+    guint32 flags;
+    guint32 reserved[2];
+} TrackerSettings;
+
+typedef struct {
+    guint32 segment_count;
+    guint32 habit_count;
+    guint32 segment_days;
+    guint32 reserved;
+} TrackerHistoryHeader;
+
+gboolean flush_to_disk(FILE *f)
+{
+    if (fflush(f) != 0)
+        return FALSE;
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+gboolean write_atomic_binary(const char *file_path, const void *data, size_t item_size, size_t item_count)
+{
+    gchar *tmp_path = g_strdup_printf("%s.tmp", file_path);
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) {
+        g_warning("could not open %s for writing: %s", tmp_path, g_strerror(errno));
+        g_free(tmp_path);
+        return FALSE;
+    }
+
+    size_t written = fwrite(data, item_size, item_count, f);
+    gboolean ok = (written == item_count);
+
+    if (ok && !flush_to_disk(f))
+        ok = FALSE;
+    if (fclose(f) != 0)
+        ok = FALSE;
+
+    if (!ok) {
+        g_warning("failed writing %s safely", file_path);
+        remove(tmp_path);
+        g_free(tmp_path);
+        return FALSE;
+    }
+
+    if (rename(tmp_path, file_path) != 0) {
+        g_warning("failed replacing %s atomically: %s", file_path, g_strerror(errno));
+        remove(tmp_path);
+        g_free(tmp_path);
+        return FALSE;
+    }
+
+    g_free(tmp_path);
+    return TRUE;
+}
+
+static guint8 journal_checksum(const guint8 *record)
+{
+    guint8 sum = 0xA5;
+    for (int i = 0; i < JOURNAL_RECORD_SIZE - 1; i++)
+        sum = (guint8)((sum << 1 | sum >> 7) ^ record[i]);
+    return sum;
+}
+
+void journal_encode(guint8 *record, JournalOp op, int habit, int day, gboolean value)
+{
+    record[0] = (guint8)op;
+    record[1] = value ? 1 : 0;
+    record[2] = (guint8)(habit & 0xff);
+    record[3] = (guint8)((habit >> 8) & 0xff);
+    record[4] = (guint8)(day & 0xff);
+    record[5] = (guint8)((day >> 8) & 0xff);
+    record[6] = (guint8)((day >> 16) & 0xff);
+    record[7] = journal_checksum(record);
+}
+
+gboolean journal_decode(const guint8 *record, JournalOp *op, int *habit, int *day, gboolean *value)
+{
+    if (record[7] != journal_checksum(record))
+        return FALSE;
+
+    *op = (JournalOp)record[0];
+    *value = record[1] != 0;
+    *habit = record[2] | (record[3] << 8);
+    *day = record[4] | (record[5] << 8) | (record[6] << 16);
+    return TRUE;
+}
+
+gboolean journal_apply(HistoryStore *hist, const guint8 *record)
+{
+    JournalOp op;
+    int habit, day;
+    gboolean value;
+    if (!journal_decode(record, &op, &habit, &day, &value))
+        return FALSE;
+
+    int start = hist->cycle_start;
+
+    switch (op) {
+    case JOURNAL_SET_CELL:
+        if (habit < hist->habit_count && day < hist->window_days)
+            history_set(hist, habit, start + day, value);
+        return TRUE;
+    case JOURNAL_CLEAR_HABIT:
+        if (habit < hist->habit_count)
+            history_clear_range(hist, habit, start, start + hist->window_days);
+        return TRUE;
+    case JOURNAL_CLEAR_ALL:
+        history_clear_range(hist, -1, start, start + hist->window_days);
+        return TRUE;
+    case JOURNAL_NEW_CYCLE:
+        hist->cycle_start = day;
+        history_clear_range(hist, -1, day, day + hist->window_days);
+        return TRUE;
+    case JOURNAL_MOVE_WINDOW:
+        hist->cycle_start = day;
+        hist->rolling = value;
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+gboolean replay_journal(const char *path, HistoryStore *hist)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return TRUE;
+
+    gboolean clean = TRUE;
+    char magic[JOURNAL_HEADER_SIZE];
+    if (fread(magic, 1, JOURNAL_HEADER_SIZE, f) != JOURNAL_HEADER_SIZE ||
+        memcmp(magic, JOURNAL_MAGIC, JOURNAL_HEADER_SIZE) != 0) {
+        fclose(f);
+        return FALSE;
+    }
+
+    guint8 record[JOURNAL_RECORD_SIZE];
+    size_t got;
+    while ((got = fread(record, 1, JOURNAL_RECORD_SIZE, f)) == JOURNAL_RECORD_SIZE) {
+        if (!journal_apply(hist, record)) {
+            clean = FALSE;
+            break;
+        }
+    }
+    if (got != 0 && got != JOURNAL_RECORD_SIZE)
+        clean = FALSE;
+
+    fclose(f);
+    if (!clean)
+        g_warning("ignoring torn or corrupt tail of %s", path);
+    return clean;
+}
+
+static guint32 crc32_update(guint32 crc, const void *data, size_t len)
+{
+    static guint32 table[256];
+    static gsize table_ready = 0;
+
+    if (g_once_init_enter(&table_ready)) {
+        for (guint32 i = 0; i < 256; i++) {
+            guint32 c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        g_once_init_leave(&table_ready, 1);
+    }
+
+    const guint8 *bytes = data;
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++)
+        crc = table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static size_t tracker_align(size_t offset)
+{
+    return (offset + TRACKER_ALIGN - 1) & ~(size_t)(TRACKER_ALIGN - 1);
+}
+
+static gboolean history_segment_is_empty(const HistoryStore *hist, const HistorySegment *seg)
+{
+    for (int h = 0; h < hist->habit_count; h++) {
+        if (seg->words[h])
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static size_t history_section_size(const HistoryStore *hist, guint32 *segment_count)
+{
+    guint32 count = 0;
+    for (guint i = 0; i < hist->segments->len; i++) {
+        if (!history_segment_is_empty(hist, &g_array_index(hist->segments, HistorySegment, i)))
+            count++;
+    }
+
+    *segment_count = count;
+    return sizeof(TrackerHistoryHeader) + (size_t)count * sizeof(guint64) * (1 + hist->habit_count);
+}
+
+static void write_history_section(guint8 *dest, const HistoryStore *hist, guint32 segment_count)
+{
+    TrackerHistoryHeader header;
+    memset(&header, 0, sizeof(header));
+    header.segment_count = GUINT32_TO_LE(segment_count);
+    header.habit_count = GUINT32_TO_LE((guint32)hist->habit_count);
+    header.segment_days = GUINT32_TO_LE(HISTORY_SEGMENT_DAYS);
+    memcpy(dest, &header, sizeof(header));
+
+    guint64 *indices = (guint64 *)(dest + sizeof(header));
+    guint64 *words = indices + segment_count;
+    for (guint i = 0; i < hist->segments->len; i++) {
+        const HistorySegment *seg = &g_array_index(hist->segments, HistorySegment, i);
+        if (history_segment_is_empty(hist, seg))
+            continue;
+
+        *indices++ = GUINT64_TO_LE((guint64)seg->index);
+        for (int h = 0; h < hist->habit_count; h++)
+            *words++ = GUINT64_TO_LE(seg->words[h]);
+    }
+}
+
+gboolean tracker_file_write(const char *path, const HistoryStore *hist, const char *names, int day_count)
+{
+    TrackerSettings settings;
+    memset(&settings, 0, sizeof(settings));
+    settings.day_count = GUINT32_TO_LE((guint32)day_count);
+    settings.habit_count = GUINT32_TO_LE((guint32)hist->habit_count);
+    settings.day_capacity = GUINT32_TO_LE((guint32)hist->window_days);
+    settings.name_len = GUINT32_TO_LE(NAME_LEN);
+    settings.cycle_start = GUINT32_TO_LE((guint32)hist->cycle_start);
+    settings.flags = GUINT32_TO_LE(hist->rolling ? SETTINGS_ROLLING : 0);
+
+    guint32 segment_count;
+    const void *payloads[TRACKER_SECTION_COUNT] = { &settings, names, NULL };
+    size_t sizes[TRACKER_SECTION_COUNT] = {
+        sizeof(settings),
+        (size_t)hist->habit_count * NAME_LEN,
+        history_section_size(hist, &segment_count),
+    };
+    guint32 types[TRACKER_SECTION_COUNT] = { SECTION_SETTINGS, SECTION_NAMES, SECTION_HISTORY };
+
+    size_t offset = tracker_align(sizeof(TrackerHeader) + TRACKER_SECTION_COUNT * sizeof(TrackerSection));
+    TrackerSection sections[TRACKER_SECTION_COUNT];
+    memset(sections, 0, sizeof(sections));
+    for (int i = 0; i < TRACKER_SECTION_COUNT; i++) {
+        sections[i].type = GUINT32_TO_LE(types[i]);
+        sections[i].offset = GUINT64_TO_LE((guint64)offset);
+        sections[i].size = GUINT64_TO_LE((guint64)sizes[i]);
+        offset = tracker_align(offset + sizes[i]);
+    }
+
+    guint8 *buffer = g_malloc0(offset);
+    for (int i = 0; i < TRACKER_SECTION_COUNT; i++) {
+        guint8 *dest = buffer + GUINT64_FROM_LE(sections[i].offset);
+        if (types[i] == SECTION_HISTORY)
+            write_history_section(dest, hist, segment_count);
+        else
+            memcpy(dest, payloads[i], sizes[i]);
+        sections[i].checksum = GUINT32_TO_LE(crc32_update(0, dest, sizes[i]));
+    }
+
+    TrackerHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACKER_MAGIC, sizeof(header.magic));
+    header.version = GUINT32_TO_LE(TRACKER_VERSION);
+    header.byte_order = GUINT32_TO_LE(TRACKER_BYTE_ORDER_MARK);
+    header.section_count = GUINT32_TO_LE(TRACKER_SECTION_COUNT);
+    header.write_id = GUINT64_TO_LE(((guint64)g_random_int() << 32) | g_random_int());
+    guint32 table_crc = crc32_update(0, &header, sizeof(header));
+    table_crc = crc32_update(table_crc, sections, sizeof(sections));
+    header.table_checksum = GUINT32_TO_LE(table_crc);
+
+    memcpy(buffer, &header, sizeof(header));
+    memcpy(buffer + sizeof(header), sections, sizeof(sections));
+
+    gboolean ok = write_atomic_binary(path, buffer, 1, offset);
+    g_free(buffer);
+    return ok;
+}
+
+static const guint8 *tracker_find_section(const char *path, const guint8 *base, size_t length,
+                                          const TrackerHeader *header, guint32 type, gboolean verify, size_t *size)
+{
+    const TrackerSection *sections = (const TrackerSection *)(base + sizeof(TrackerHeader));
+    guint32 count = GUINT32_FROM_LE(header->section_count);
+
+    for (guint32 i = 0; i < count; i++) {
+        if (GUINT32_FROM_LE(sections[i].type) != type)
+            continue;
+
+        guint64 offset = GUINT64_FROM_LE(sections[i].offset);
+        guint64 section_size = GUINT64_FROM_LE(sections[i].size);
+        if (offset > length || section_size > length - offset) {
+            g_warning("%s: section %u lies outside the file", path, type);
+            return NULL;
+        }
+        if (verify && crc32_update(0, base + offset, section_size) != GUINT32_FROM_LE(sections[i].checksum)) {
+            g_warning("%s: checksum mismatch in section %u", path, type);
+            return NULL;
+        }
+
+        *size = section_size;
+        return base + offset;
+    }
+
+    g_warning("%s: missing section %u", path, type);
+    return NULL;
+}
+
+static gboolean load_history_section(HabitTracker *tracker, const guint8 *data, size_t size, gboolean in_place)
+{
+    TrackerHistoryHeader header;
+    if (size < sizeof(header))
+        return FALSE;
+
+    memcpy(&header, data, sizeof(header));
+    guint32 segment_count = GUINT32_FROM_LE(header.segment_count);
+    int habit_count = (int)GUINT32_FROM_LE(header.habit_count);
+    if (GUINT32_FROM_LE(header.segment_days) != HISTORY_SEGMENT_DAYS || habit_count <= 0 ||
+        (size - sizeof(header)) / sizeof(guint64) / (1 + (size_t)habit_count) < segment_count) {
+        g_warning("%s: inconsistent history section", tracker->tracker_path);
+        return FALSE;
+    }
+
+    const guint8 *indices = data + sizeof(header);
+    const guint8 *words = indices + (size_t)segment_count * sizeof(guint64);
+    in_place = in_place && habit_count == tracker->habit_count;
+
+    gint64 previous = -1;
+    for (guint32 i = 0; i < segment_count; i++) {
+        guint64 raw;
+        memcpy(&raw, indices + (size_t)i * sizeof(guint64), sizeof(raw));
+        gint64 index = (gint64)GUINT64_FROM_LE(raw);
+        if (index <= previous || index > G_MAXINT / HISTORY_SEGMENT_DAYS - 1) {
+            g_warning("%s: history segments out of order", tracker->tracker_path);
+            return FALSE;
+        }
+        previous = index;
+
+        const guint8 *segment_data = words + (size_t)i * habit_count * sizeof(guint64);
+        HistorySegment seg = { index, (guint64 *)segment_data, NULL };
+        if (!in_place) {
+            seg.block = history_block_new(tracker->habit_count);
+            seg.words = seg.block->words;
+            for (int h = 0; h < habit_count && h < tracker->habit_count; h++) {
+                memcpy(&raw, segment_data + (size_t)h * sizeof(guint64), sizeof(raw));
+                seg.words[h] = GUINT64_FROM_LE(raw);
+            }
+        }
+        g_array_append_val(tracker->history.segments, seg);
+    }
+    return TRUE;
+}
+
+static gboolean tracker_read_header(const char *path, const guint8 *base, size_t length, TrackerHeader *header)
+{
+    if (length < sizeof(TrackerHeader))
+        return FALSE;
+
+    memcpy(header, base, sizeof(*header));
+    guint32 section_count = GUINT32_FROM_LE(header->section_count);
+    if (memcmp(header->magic, TRACKER_MAGIC, sizeof(header->magic)) != 0 ||
+        GUINT32_FROM_LE(header->version) != TRACKER_VERSION ||
+        GUINT32_FROM_LE(header->byte_order) != TRACKER_BYTE_ORDER_MARK ||
+        section_count > 64 ||
+        length < sizeof(TrackerHeader) + section_count * sizeof(TrackerSection)) {
+        g_warning("%s: unrecognised header", path);
+        return FALSE;
+    }
+
+    TrackerHeader check = *header;
+    check.table_checksum = 0;
+    guint32 table_crc = crc32_update(0, &check, sizeof(check));
+    table_crc = crc32_update(table_crc, base + sizeof(TrackerHeader), section_count * sizeof(TrackerSection));
+    if (table_crc != GUINT32_FROM_LE(header->table_checksum)) {
+        g_warning("%s: header checksum mismatch", path);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* The history section's checksum covers the whole history, so callers on
+ * the startup path may skip it and check later with tracker_file_verify. */
+gboolean tracker_file_load(HabitTracker *tracker, GMappedFile *mapping, gboolean verify_history)
+{
+    const guint8 *base = (const guint8 *)g_mapped_file_get_contents(mapping);
+    size_t length = g_mapped_file_get_length(mapping);
+
+    TrackerHeader header;
+    if (!tracker_read_header(tracker->tracker_path, base, length, &header))
+        return FALSE;
+
+    size_t settings_size, names_size, data_size;
+    const guint8 *settings_data = tracker_find_section(tracker->tracker_path, base, length, &header, SECTION_SETTINGS, TRUE, &settings_size);
+    const guint8 *names_data = tracker_find_section(tracker->tracker_path, base, length, &header, SECTION_NAMES, TRUE, &names_size);
+    const guint8 *data = tracker_find_section(tracker->tracker_path, base, length, &header, SECTION_HISTORY, verify_history, &data_size);
+    if (!settings_data || !names_data || !data || settings_size < G_STRUCT_OFFSET(TrackerSettings, cycle_start))
+        return FALSE;
+
+    TrackerSettings settings;
+    memset(&settings, 0, sizeof(settings));
+    memcpy(&settings, settings_data, MIN(settings_size, sizeof(settings)));
+    int habit_count = (int)GUINT32_FROM_LE(settings.habit_count);
+    int day_capacity = (int)GUINT32_FROM_LE(settings.day_capacity);
+    int name_len = (int)GUINT32_FROM_LE(settings.name_len);
+    if (habit_count <= 0 || habit_count > MAX_HABIT_COUNT || day_capacity <= 0 ||
+        day_capacity > MAX_DAY_CAPACITY || name_len <= 0 ||
+        names_size < (size_t)habit_count * name_len) {
+        g_warning("%s: inconsistent section sizes", tracker->tracker_path);
+        return FALSE;
+    }
+    tracker_resize(tracker, habit_count, day_capacity);
+
+    int day_count = (int)GUINT32_FROM_LE(settings.day_count);
+    if (day_count >= 1 && day_count <= tracker->day_capacity)
+        tracker->day_count = day_count;
+    int cycle_start = (int)GUINT32_FROM_LE(settings.cycle_start);
+    if (cycle_start > 0 && cycle_start <= G_MAXINT - tracker->day_capacity)
+        tracker->history.cycle_start = cycle_start;
+    tracker->history.rolling = (GUINT32_FROM_LE(settings.flags) & SETTINGS_ROLLING) != 0;
+
+    gboolean in_place = TRUE;
+#if G_BYTE_ORDER != G_LITTLE_ENDIAN || defined(G_OS_WIN32)
+    in_place = FALSE;
+#endif
+    if (in_place)
+        tracker->history.mapping = g_mapped_file_ref(mapping);
+
+    if (in_place && habit_count == tracker->habit_count && name_len == NAME_LEN) {
+        tracker->names = (char (*)[NAME_LEN])names_data;
+    } else {
+        for (int i = 0; i < habit_count && i < tracker->habit_count; i++)
+            g_strlcpy(tracker->names[i], (const char *)names_data + (size_t)i * name_len, MIN(name_len, NAME_LEN));
+    }
+    for (int i = 0; i < tracker->habit_count; i++) {
+        if (tracker->names[i][NAME_LEN - 1] != '\0')
+            tracker->names[i][NAME_LEN - 1] = '\0';
+        if (tracker->names[i][0] == '\0')
+            g_snprintf(tracker->names[i], NAME_LEN, "Habit %d", i + 1);
+    }
+
+    return load_history_section(tracker, data, data_size, in_place);
+}
+
+/* Checks every section of the snapshot with id `write_id`. A file that has
+ * since been replaced or removed passes: it is no longer the one loaded. */
+gboolean tracker_file_verify(const char *path, guint64 write_id)
+{
+    GMappedFile *mapping = g_mapped_file_new(path, FALSE, NULL);
+    if (!mapping)
+        return TRUE;
+
+    const guint8 *base = (const guint8 *)g_mapped_file_get_contents(mapping);
+    size_t length = g_mapped_file_get_length(mapping);
+    TrackerHeader header;
+    gboolean ok = TRUE;
+    if (length >= sizeof(header)) {
+        memcpy(&header, base, sizeof(header));
+        if (GUINT64_FROM_LE(header.write_id) == write_id) {
+            size_t size;
+            ok = tracker_read_header(path, base, length, &header) &&
+                 tracker_find_section(path, base, length, &header, SECTION_SETTINGS, TRUE, &size) &&
+                 tracker_find_section(path, base, length, &header, SECTION_NAMES, TRUE, &size) &&
+                 tracker_find_section(path, base, length, &header, SECTION_HISTORY, TRUE, &size);
+        }
+    }
+    g_mapped_file_unref(mapping);
+    return ok;
+}
+
+/* Identifies what is on disk: a new id per snapshot, and the journal length since. */
+void data_stamp_read(DataStamp *stamp, const char *tracker_path, const char *journal_path)
+{
+    TrackerHeader header;
+    FILE *f = fopen(tracker_path, "rb");
+
+    stamp->write_id = 0;
+    if (f) {
+        if (fread(&header, sizeof(header), 1, f) == 1)
+            stamp->write_id = GUINT64_FROM_LE(header.write_id);
+        fclose(f);
+    }
+
+    GStatBuf st;
+    stamp->journal_size = g_stat(journal_path, &st) == 0 ? (gint64)st.st_size : -1;
+}
+
+/* Blocks until the advisory lock is held. Returns -1 (and carries on
+ * unlocked) when the lock file cannot be opened. flock() belongs to the open
+ * file, so the persist worker and the main thread exclude each other too. */
+int data_lock_acquire(const char *path, gboolean exclusive)
+{
+    static gboolean warned;
+    int fd = g_open(path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        if (!warned)
+            g_warning("could not open %s, saving without a lock: %s", path, g_strerror(errno));
+        warned = TRUE;
+        return -1;
+    }
+
+#ifdef _WIN32
+    OVERLAPPED overlapped = { 0 };
+    gboolean locked = LockFileEx((HANDLE)_get_osfhandle(fd), exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0,
+                                 0, 1, 0, &overlapped);
+#else
+    int rc;
+    while ((rc = flock(fd, exclusive ? LOCK_EX : LOCK_SH)) != 0 && errno == EINTR)
+        ;
+    gboolean locked = rc == 0;
+#endif
+    if (!locked && !warned) {
+        g_warning("could not lock %s, saving without a lock", path);
+        warned = TRUE;
+    }
+    return fd;
+}
+
+void data_lock_release(int fd)
+{
+    if (fd < 0)
+        return;
+#ifdef _WIN32
+    OVERLAPPED overlapped = { 0 };
+    UnlockFileEx((HANDLE)_get_osfhandle(fd), 0, 1, 0, &overlapped);
+#endif
+    close(fd);
+}
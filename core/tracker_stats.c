@@ -0,0 +1,162 @@
+#include "habit_core.h"
+
+int tracker_count_checked(const HabitTracker *tracker)
+{
+    return tracker->stats.total;
+}
+
+int tracker_count_checked_for_habit(const HabitTracker *tracker, int habit)
+{
+    return tracker->stats.per_habit[habit];
+}
+
+int tracker_week_count(const HabitTracker *tracker)
+{
+    return (tracker->day_count + 6) / 7;
+}
+
+void tracker_week_bounds(const HabitTracker *tracker, int week, int *start_day, int *end_day)
+{
+    *start_day = (week * 7) + 1;
+    *end_day = *start_day + 6;
+    if (*end_day > tracker->day_count)
+        *end_day = tracker->day_count;
+}
+
+int tracker_count_checked_in_week(const HabitTracker *tracker, int week)
+{
+    int start_day, end_day;
+    tracker_week_bounds(tracker, week, &start_day, &end_day);
+    return habit_stats_prefix(&tracker->stats, end_day - 1) - habit_stats_prefix(&tracker->stats, start_day - 2);
+}
+
+double tracker_day_completion_percent(const HabitTracker *tracker, int day)
+{
+    if (day < 0 || day >= tracker->day_count)
+        return 0.0;
+
+    return (100.0 * habit_stats_day(&tracker->stats, day)) / tracker->habit_count;
+}
+
+double tracker_running_average_percent(const HabitTracker *tracker, int day)
+{
+    if (day < 0 || day >= tracker->day_count)
+        return 0.0;
+
+    return (100.0 * habit_stats_prefix(&tracker->stats, day)) / ((double)tracker->habit_count * (day + 1));
+}
+
+int tracker_count_range(const HabitTracker *tracker, int habit, int start_day, int end_day)
+{
+    return history_count_range(&tracker->history, habit, start_day, end_day);
+}
+
+const char *day_unit(int days)
+{
+    return days == 1 ? "day" : "days";
+}
+
+/* Days in a row up to today. A streak that ran through yesterday still
+ * counts while today has not been checked yet. */
+int tracker_current_streak(const HabitTracker *tracker, int habit)
+{
+    /* Streak runs are a cache filled on first use, not part of the tracker's value. */
+    HabitStreaks *streaks = (HabitStreaks *)&tracker->streaks;
+    int today = today_day_number();
+    const StreakRun *run = habit_streaks_find(streaks, &tracker->history, habit, today);
+    if (!run)
+        run = habit_streaks_find(streaks, &tracker->history, habit, today - 1);
+    return run ? MIN(run->start + run->length - 1, today) - run->start + 1 : 0;
+}
+
+int tracker_longest_streak(const HabitTracker *tracker, int habit)
+{
+    return habit_streaks_longest((HabitStreaks *)&tracker->streaks, &tracker->history, habit);
+}
+
+gchar *tracker_format_summary(const HabitTracker *tracker)
+{
+    int day_count = tracker->day_count;
+    int total = tracker->habit_count * day_count;
+    int checked = tracker_count_checked(tracker);
+    int percent = (total > 0) ? (checked * 100) / total : 0;
+
+    int best_idx = 0;
+    int worst_idx = 0;
+    int best_percent = -1;
+    int worst_percent = 101;
+    int current_idx = 0;
+    int current_streak = -1;
+    int longest_idx = 0;
+    int longest_streak = -1;
+
+    for (int i = 0; i < tracker->habit_count; i++) {
+        int habit_percent = (day_count > 0)
+            ? (tracker_count_checked_for_habit(tracker, i) * 100) / day_count
+            : 0;
+        if (habit_percent > best_percent) {
+            best_percent = habit_percent;
+            best_idx = i;
+        }
+        if (habit_percent < worst_percent) {
+            worst_percent = habit_percent;
+            worst_idx = i;
+        }
+
+        int current = tracker_current_streak(tracker, i);
+        if (current > current_streak) {
+            current_streak = current;
+            current_idx = i;
+        }
+        int longest = tracker_longest_streak(tracker, i);
+        if (longest > longest_streak) {
+            longest_streak = longest;
+            longest_idx = i;
+        }
+    }
+
+    double average_per_habit = (double)checked / tracker->habit_count;
+
+    return g_strdup_printf(
+        "• Total complete: %d / %d (%d%%)\n"
+        "• Average per habit: %.1f / %d days\n"
+        "• Best habit: %s (%d%%)\n"
+        "• Needs focus: %s (%d%%)\n"
+        "• Current streak: %s (%d %s)\n"
+        "• Longest streak: %s (%d %s)\n"
+        "• Earlier cycles: %d check-ins",
+        checked, total, percent,
+        average_per_habit, day_count,
+        tracker->names[best_idx], best_percent,
+        tracker->names[worst_idx], worst_percent,
+        tracker->names[current_idx], current_streak, day_unit(current_streak),
+        tracker->names[longest_idx], longest_streak, day_unit(longest_streak),
+        tracker_archived_check_ins(tracker));
+}
+
+gchar *tracker_format_weekly(const HabitTracker *tracker)
+{
+    int week_count = tracker_week_count(tracker);
+    GString *weekly = g_string_new("");
+    for (int w = 0; w < week_count; w++) {
+        int start_day, end_day;
+        tracker_week_bounds(tracker, w, &start_day, &end_day);
+
+        int week_total = tracker->habit_count * (end_day - start_day + 1);
+        int week_checked = tracker_count_checked_in_week(tracker, w);
+        int week_percent = (week_total > 0) ? (week_checked * 100) / week_total : 0;
+
+        char first[40], last[40];
+        format_day_label(tracker->history.cycle_start + start_day - 1, first, sizeof(first));
+        format_day_label(tracker->history.cycle_start + end_day - 1, last, sizeof(last));
+        g_string_append_printf(weekly, "W%d (%s-%s): %d%%", w + 1, first, last, week_percent);
+        if (w < week_count - 1) {
+            if ((w + 1) % 3 == 0)
+                g_string_append(weekly, "\n");
+            else
+                g_string_append(weekly, "    ");
+        }
+    }
+
+    return g_string_free(weekly, FALSE);
+}
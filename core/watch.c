@@ -0,0 +1,97 @@
+#include "habit_core.h"
+#include <gio/gio.h>
+
+/* Saves arrive as a burst of events (temp file, rename, journal append). */
+#define WATCH_SETTLE_MS 100
+
+struct _TrackerWatch {
+    HabitTracker *tracker;
+    GFileMonitor *monitor;
+    guint settle_source;
+    TrackerChangedFunc changed;
+    gpointer user_data;
+};
+
+static gboolean is_data_file(GFile *file)
+{
+    if (!file)
+        return FALSE;
+
+    gchar *name = g_file_get_basename(file);
+    gboolean match = g_str_equal(name, TRACKER_FILE_NAME) || g_str_equal(name, JOURNAL_FILE_NAME);
+    g_free(name);
+    return match;
+}
+
+static gboolean on_settled(gpointer user_data)
+{
+    TrackerWatch *watch = user_data;
+    watch->settle_source = 0;
+    persist_sync(&watch->tracker->persist);
+    return G_SOURCE_REMOVE;
+}
+
+static void on_data_dir_changed(GFileMonitor *monitor, GFile *file, GFile *other_file,
+                                GFileMonitorEvent event, gpointer user_data)
+{
+    TrackerWatch *watch = user_data;
+    (void)monitor;
+
+    if (event == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED || (!is_data_file(file) && !is_data_file(other_file)))
+        return;
+    if (!watch->settle_source)
+        watch->settle_source = g_timeout_add(WATCH_SETTLE_MS, on_settled, watch);
+}
+
+static gboolean on_change_ready(gpointer user_data)
+{
+    TrackerWatch *watch = user_data;
+    TrackerChange *change = persist_take_change(&watch->tracker->persist);
+    if (!change)
+        return G_SOURCE_REMOVE;
+
+    gint64 span = trace_begin();
+    guint flags = tracker_apply_change(watch->tracker, change);
+    trace_end("apply_external_change", span);
+    if (flags && watch->changed)
+        watch->changed(change->cells, flags, watch->user_data);
+    tracker_change_free(change);
+    return G_SOURCE_REMOVE;
+}
+
+/* Watches the data folder for saves from other instances (including a synced
+ * copy) and folds them into `tracker` once persistence is running. */
+TrackerWatch *tracker_watch_new(HabitTracker *tracker, TrackerChangedFunc changed, gpointer user_data)
+{
+    GError *error = NULL;
+    GFile *dir = g_file_new_for_path(tracker->data_dir);
+    GFileMonitor *monitor = g_file_monitor_directory(dir, G_FILE_MONITOR_WATCH_MOVES, NULL, &error);
+    g_object_unref(dir);
+    if (!monitor) {
+        g_warning("could not watch %s for changes: %s", tracker->data_dir, error->message);
+        g_error_free(error);
+        return NULL;
+    }
+
+    TrackerWatch *watch = g_new0(TrackerWatch, 1);
+    watch->tracker = tracker;
+    watch->monitor = monitor;
+    watch->changed = changed;
+    watch->user_data = user_data;
+    g_signal_connect(monitor, "changed", G_CALLBACK(on_data_dir_changed), watch);
+    persist_watch(&tracker->persist, on_change_ready, watch);
+    return watch;
+}
+
+void tracker_watch_free(TrackerWatch *watch)
+{
+    if (!watch)
+        return;
+
+    persist_watch(&watch->tracker->persist, NULL, NULL);
+    if (watch->settle_source)
+        g_source_remove(watch->settle_source);
+    g_file_monitor_cancel(watch->monitor);
+    g_object_unref(watch->monitor);
+    g_free(watch);
+}